@@ -0,0 +1,30 @@
+# Find LuaJIT libraries
+# LUAJIT_INCLUDE_DIR - Where to find the LuaJIT header files (directory)
+# LUAJIT_LIBRARIES - LuaJIT libraries
+# LUAJIT_FOUND - Set to TRUE if we found everything (library and includes)
+
+IF( LUAJIT_INCLUDE_DIR AND LUAJIT_LIBRARIES )
+    SET(LuaJIT_FIND_QUIETLY TRUE)
+ENDIF()
+
+FIND_PATH( LUAJIT_INCLUDE_DIR luajit.h
+    PATH_SUFFIXES luajit-2.1 luajit-2.0 luajit )
+
+FIND_LIBRARY( LUAJIT_LIBRARIES NAMES luajit-5.1 luajit )
+
+IF( LUAJIT_INCLUDE_DIR AND LUAJIT_LIBRARIES )
+    SET( LUAJIT_FOUND TRUE )
+ENDIF()
+
+IF( LUAJIT_FOUND )
+    IF( NOT LuaJIT_FIND_QUIETLY )
+        MESSAGE( STATUS "Found LuaJIT header file in ${LUAJIT_INCLUDE_DIR}")
+        MESSAGE( STATUS "Found LuaJIT libraries: ${LUAJIT_LIBRARIES}")
+    ENDIF()
+ELSE()
+    IF( LuaJIT_FIND_REQUIRED)
+        MESSAGE( FATAL_ERROR "Could not find LuaJIT" )
+    ELSE()
+        MESSAGE( STATUS "Optional package LuaJIT was not found" )
+    ENDIF()
+ENDIF(LUAJIT_FOUND)
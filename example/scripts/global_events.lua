@@ -66,11 +66,8 @@ end
 -- be useful for various handling of offline processing mechanics.
 local function on_chr_logout(ch)
     -- notifies nearby players of logout
-    local around = get_beings_in_circle(posX(ch), posY(ch), 1000)
     local msg = being_get_name(ch).." left the game."
-    for b in pairs(around) do
-        if being_type(b) == TYPE_CHARACTER then
-            chat_message(0, b, msg)
-        end
+    for b in beings_in_circle(ch, 1000, TYPE_CHARACTER) do
+        chat_message(b, msg)
     end
 end
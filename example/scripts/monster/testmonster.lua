@@ -25,5 +25,5 @@ local function strike(mob, victim, hit)
 end
 
 local maggot = get_monster_class("maggot")
-maggot:on_update(update)
+maggot:on_update(update, true)  -- batched, called after the map update
 maggot:on("strike", strike)
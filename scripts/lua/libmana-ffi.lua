@@ -0,0 +1,100 @@
+-------------------------------------------------------------
+-- Mana Support Library: LuaJIT FFI bindings               --
+--                                                         --
+-- Loaded by the "luajit" script engine after libmana.lua. --
+-- Replaces some of the most frequently called read-only   --
+-- bindings by functions going through the FFI, which the  --
+-- JIT compiler can call directly from compiled traces.    --
+--                                                         --
+----------------------------------------------------------------------------------
+--  Copyright 2012 The Mana Developers                                          --
+--                                                                              --
+--  This file is part of The Mana Server.                                       --
+--                                                                              --
+--  The Mana Server is free software; you can redistribute  it and/or modify it --
+--  under the terms of the GNU General  Public License as published by the Free --
+--  Software Foundation; either version 2 of the License, or any later version. --
+----------------------------------------------------------------------------------
+
+local ffi = require "ffi"
+
+-- Keep in sync with src/scripting/luajitscript.cpp
+ffi.cdef[[
+int manaserv_being_get_position(const void *handle, int *x, int *y);
+int manaserv_being_get_modified_attribute(const void *handle, int attr,
+                                          int *value);
+]]
+
+local C = ffi.C
+local out = ffi.new("int[2]")
+
+-- The FFI passes a userdata as a pointer to its contents, which only makes
+-- sense for entities. They are recognized by their metatables.
+local entity_metatables = {}
+do
+    local registry = debug.getregistry()
+    for _, name in ipairs { "Entity", "Being", "Character", "Monster", "NPC" } do
+        entity_metatables[registry[name]] = true
+    end
+end
+
+local function is_entity(value)
+    return type(value) == "userdata" and entity_metatables[getmetatable(value)]
+end
+
+-- The original bindings are still used for reporting invalid arguments
+local lua_posX = posX
+local lua_posY = posY
+local lua_being_get_modified_attribute = being_get_modified_attribute
+local lua_being_get_position = being_get_position
+
+function posX(being)
+    if is_entity(being) and
+       C.manaserv_being_get_position(being, out, out + 1) ~= 0 then
+        return out[0]
+    end
+    return lua_posX(being)
+end
+
+function posY(being)
+    if is_entity(being) and
+       C.manaserv_being_get_position(being, out, out + 1) ~= 0 then
+        return out[1]
+    end
+    return lua_posY(being)
+end
+
+function being_get_modified_attribute(being, attr)
+    if is_entity(being) and type(attr) == "number" and
+       C.manaserv_being_get_modified_attribute(being, attr, out) ~= 0 then
+        return out[0]
+    end
+    return lua_being_get_modified_attribute(being, attr)
+end
+
+function being_get_position(being)
+    if is_entity(being) and
+       C.manaserv_being_get_position(being, out, out + 1) ~= 0 then
+        return out[0], out[1]
+    end
+    return lua_being_get_position(being)
+end
+
+-- The method tables of the entity types have their own copies of the bindings
+for _, name in ipairs { "Being", "Character", "Monster", "NPC" } do
+    local methods = _G[name]
+    methods.get_modified_attribute = being_get_modified_attribute
+    methods.get_position = being_get_position
+end
+
+-- The result table has to hold the usual being handles, which cdata cannot be
+-- turned into, so only the lookup of the center being goes through the FFI.
+local lua_get_beings_in_circle = get_beings_in_circle
+
+function get_beings_in_circle(x, y, r)
+    if is_entity(x) and
+       C.manaserv_being_get_position(x, out, out + 1) ~= 0 then
+        return lua_get_beings_in_circle(out[0], out[1], y)
+    end
+    return lua_get_beings_in_circle(x, y, r)
+end
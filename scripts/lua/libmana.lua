@@ -247,6 +247,25 @@ local function remove_notification(being)
   end
 end
 
+-- Registered as the function making the calls of batched callbacks. Calls
+-- funct once for each queued entity, with the arguments it was queued with.
+-- An error in one call does not prevent the other calls.
+local function batch_dispatch(funct, count, entities, targets, values)
+  local ok, err
+  for i = 1, count do
+    if targets then
+      ok, err = pcall(funct, entities[i], targets[i], values[i])
+    elseif values then
+      ok, err = pcall(funct, entities[i], values[i])
+    else
+      ok, err = pcall(funct, entities[i])
+    end
+    if not ok then
+      WARN("Error in batched callback: " .. tostring(err))
+    end
+  end
+end
+
 
 -- Below are some convenience methods added to the engine API
 chr_money_change = function(ch, amount)
@@ -263,6 +282,7 @@ end
 -- Register callbacks
 on_update(update)
 on_mapupdate(mapupdate)
+on_batch_dispatch(batch_dispatch)
 
 on_create_npc_delayed(create_npc_delayed)
 on_map_initialize(map_initialize)
@@ -45,6 +45,8 @@
 
 using namespace ManaServ;
 
+static Configuration::IntOption maxClientsOption("net_maxClients", 1000);
+
 class AccountHandler : public ConnectionHandler
 {
 public:
@@ -369,8 +371,7 @@ void AccountHandler::handleLoginMessage(AccountClient &client, MessageIn &msg)
         return;
     }
 
-    const unsigned maxClients =
-            (unsigned) Configuration::getValue("net_maxClients", 1000);
+    const unsigned maxClients = (unsigned) maxClientsOption;
 
     if (getClientCount() >= maxClients)
     {
@@ -39,6 +39,31 @@ Character::Character(const std::string &name, int id):
 {
 }
 
+Character::Character(const Character &other):
+    mPossessions(other.mPossessions),
+    mName(other.mName),
+    mDatabaseID(other.mDatabaseID),
+    mCharacterSlot(other.mCharacterSlot),
+    mAccountID(other.mAccountID),
+    mAccount(other.mAccount),
+    mPos(other.mPos),
+    mAttributes(other.mAttributes),
+    mExperience(other.mExperience),
+    mStatusEffects(other.mStatusEffects),
+    mKillCount(other.mKillCount),
+    mSpecials(other.mSpecials),
+    mMapId(other.mMapId),
+    mGender(other.mGender),
+    mHairStyle(other.mHairStyle),
+    mHairColor(other.mHairColor),
+    mLevel(other.mLevel),
+    mCharacterPoints(other.mCharacterPoints),
+    mCorrectionPoints(other.mCorrectionPoints),
+    mAccountLevel(other.mAccountLevel),
+    mGuilds(other.mGuilds)
+{
+}
+
 void Character::setAccount(Account *acc)
 {
     mAccount = acc;
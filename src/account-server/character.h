@@ -59,6 +59,9 @@ struct SpecialValue
         : currentMana(currentMana)
     {}
 
+    unsigned int getCurrentMana() const
+    { return currentMana; }
+
     unsigned int currentMana;
 };
 
@@ -178,8 +181,8 @@ class Character
         void applyStatusEffect(int id, int time)
         { mStatusEffects[id] = time; }
 
-        int getStatusEffectSize() const
-        { return mStatusEffects.size(); }
+        const std::map<int, int> &getStatusEffects() const
+        { return mStatusEffects; }
 
         const std::map<int, int>::const_iterator getStatusEffectBegin() const
         { return mStatusEffects.begin(); }
@@ -266,6 +269,10 @@ class Character
 
     private:
 
+        /**
+         * Copies a character, used by the Storage to hand out copies of its
+         * cached characters.
+         */
         Character(const Character &);
         Character &operator=(const Character &);
 
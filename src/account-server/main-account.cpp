@@ -193,6 +193,8 @@ static void dumpStatistics(std::string accountAddress, int accountClientPort,
     os << "<accountserver address=\"" << accountAddress << "\" clientport=\""
     << accountClientPort << "\" gameport=\"" << accountGamePort
     << "\" chatclientport=\"" << chatClientPort << "\" />\n";
+    // Add the storage caches and write-behind buffer information
+    storage->dumpStatistics(os);
     // Add game servers information
     GameServerHandler::dumpStatistics(os);
     os << "</statistics>\n";
@@ -361,9 +363,14 @@ int main(int argc, char *argv[])
     utils::Timer statTimer(10000);
     // Check for expired bans every 30 seconds
     utils::Timer banTimer(30000);
+    // Write buffered character changes, world state variables and
+    // transactions at the configured interval
+    utils::Timer syncTimer(storage->getSyncFlushInterval() * 1000);
 
     statTimer.start();
     banTimer.start();
+    if (storage->getSyncFlushInterval())
+        syncTimer.start();
 
     // -------------------------------------------------------------------------
     // FIXME: for testing purposes only...
@@ -379,6 +386,8 @@ int main(int argc, char *argv[])
                               Storage::SystemMap);
     // -------------------------------------------------------------------------
 
+    Configuration::logUsedOptions();
+
     while (running)
     {
         AccountClientHandler::process();
@@ -391,6 +400,13 @@ int main(int argc, char *argv[])
 
         if (banTimer.poll())
             storage->checkBannedAccounts();
+
+        if (syncTimer.poll())
+        {
+            storage->flushPendingSync();
+            storage->flushWorldStateVars();
+            storage->flushTransactions();
+        }
     }
 
     LOG_INFO("Received: Quit signal, closing down...");
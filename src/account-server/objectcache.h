@@ -0,0 +1,229 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBJECTCACHE_H
+#define OBJECTCACHE_H
+
+#include <list>
+#include <map>
+#include <string>
+
+/**
+ * A bounded least-recently-used cache of objects loaded from the database,
+ * indexed by their database id and by their name. The cache owns the objects
+ * it holds and deletes them when they are evicted or erased.
+ *
+ * A capacity of 0 disables the cache.
+ */
+template <class T>
+class ObjectCache
+{
+    public:
+        ObjectCache():
+            mCapacity(0),
+            mHits(0),
+            mMisses(0),
+            mEvictions(0)
+        {}
+
+        ~ObjectCache()
+        { clear(); }
+
+        /**
+         * Sets the maximum number of cached objects, evicting the least
+         * recently used ones when needed.
+         */
+        void setCapacity(unsigned capacity)
+        {
+            mCapacity = capacity;
+            while (mEntries.size() > mCapacity)
+                evictOne();
+        }
+
+        /**
+         * Returns the object with the given id, or 0 when it is not cached.
+         * Counts as a use of the object.
+         */
+        T *find(int id)
+        {
+            typename Entries::iterator it = mEntries.find(id);
+            if (it == mEntries.end())
+            {
+                if (mCapacity)
+                    ++mMisses;
+                return 0;
+            }
+
+            ++mHits;
+            mLru.splice(mLru.begin(), mLru, it->second.lru);
+            return it->second.object;
+        }
+
+        /**
+         * Returns the object with the given name, or 0 when it is not cached.
+         * Counts as a use of the object.
+         */
+        T *find(const std::string &name)
+        {
+            Names::const_iterator it = mNames.find(name);
+            if (it == mNames.end())
+            {
+                if (mCapacity)
+                    ++mMisses;
+                return 0;
+            }
+            return find(it->second);
+        }
+
+        /**
+         * Returns the object with the given id without counting it as a use,
+         * for updating it in place.
+         */
+        T *peek(int id) const
+        {
+            typename Entries::const_iterator it = mEntries.find(id);
+            return it == mEntries.end() ? 0 : it->second.object;
+        }
+
+        /**
+         * Adds an object to the cache, replacing any object with the same id.
+         * The cache takes ownership of the object, which is deleted right
+         * away when the cache is disabled.
+         */
+        void insert(int id, const std::string &name, T *object)
+        {
+            if (!mCapacity)
+            {
+                delete object;
+                return;
+            }
+
+            erase(id);
+            while (mEntries.size() >= mCapacity)
+                evictOne();
+
+            mLru.push_front(id);
+            Entry &entry = mEntries[id];
+            entry.object = object;
+            entry.name = name;
+            entry.lru = mLru.begin();
+            mNames[name] = id;
+        }
+
+        /**
+         * Removes the object with the given id, if it is cached.
+         */
+        void erase(int id)
+        {
+            typename Entries::iterator it = mEntries.find(id);
+            if (it != mEntries.end())
+                erase(it);
+        }
+
+        /**
+         * Removes all the objects matching the given predicate, which is
+         * called with a const reference to each cached object.
+         */
+        template <class Predicate>
+        void eraseIf(Predicate predicate)
+        {
+            typename Entries::iterator it = mEntries.begin();
+            while (it != mEntries.end())
+            {
+                if (predicate(static_cast<const T &>(*it->second.object)))
+                    erase(it++);
+                else
+                    ++it;
+            }
+        }
+
+        /**
+         * Removes all the objects.
+         */
+        void clear()
+        {
+            for (typename Entries::iterator it = mEntries.begin(),
+                 it_end = mEntries.end(); it != it_end; ++it)
+            {
+                delete it->second.object;
+            }
+            mEntries.clear();
+            mNames.clear();
+            mLru.clear();
+        }
+
+        unsigned size() const
+        { return mEntries.size(); }
+
+        unsigned getCapacity() const
+        { return mCapacity; }
+
+        unsigned long getHits() const
+        { return mHits; }
+
+        unsigned long getMisses() const
+        { return mMisses; }
+
+        unsigned long getEvictions() const
+        { return mEvictions; }
+
+    private:
+        struct Entry
+        {
+            T *object;
+            std::string name;
+            std::list<int>::iterator lru;
+        };
+
+        typedef std::map<int, Entry> Entries;
+        typedef std::map<std::string, int> Names;
+
+        void erase(typename Entries::iterator it)
+        {
+            // The name may have been taken over by a newer object
+            Names::iterator name = mNames.find(it->second.name);
+            if (name != mNames.end() && name->second == it->first)
+                mNames.erase(name);
+
+            mLru.erase(it->second.lru);
+            delete it->second.object;
+            mEntries.erase(it);
+        }
+
+        void evictOne()
+        {
+            erase(mEntries.find(mLru.back()));
+            ++mEvictions;
+        }
+
+        ObjectCache(const ObjectCache &);
+        ObjectCache &operator=(const ObjectCache &);
+
+        Entries mEntries;
+        Names mNames;
+        std::list<int> mLru;    /**< Ids, most recently used first. */
+
+        unsigned mCapacity;
+        unsigned long mHits;
+        unsigned long mMisses;
+        unsigned long mEvictions;
+};
+
+#endif // OBJECTCACHE_H
@@ -385,7 +385,7 @@ void ServerHandler::processMessage(NetComputer *comp, MessageIn &msg)
         {
             std::string name = msg.readString();
             std::string value = msg.readString();
-            // save the new value to the database
+            // store the new value, it is written to the database later
             storage->setWorldStateVar(name, value, Storage::WorldMap);
             // relay the new value to all gameservers
             for (ServerHandler::NetComputers::iterator i = clients.begin();
@@ -680,7 +680,7 @@ void GameServerHandler::syncDatabase(MessageIn &msg)
                 int charId = msg.readInt32();
                 int charPoints = msg.readInt32();
                 int corrPoints = msg.readInt32();
-                storage->updateCharacterPoints(charId, charPoints, corrPoints);
+                storage->queueCharacterPoints(charId, charPoints, corrPoints);
             } break;
 
             case SYNC_CHARACTER_ATTRIBUTE:
@@ -690,7 +690,7 @@ void GameServerHandler::syncDatabase(MessageIn &msg)
                 int    attrId = msg.readInt32();
                 double base   = msg.readDouble();
                 double mod    = msg.readDouble();
-                storage->updateAttribute(charId, attrId, base, mod);
+                storage->queueAttribute(charId, attrId, base, mod);
             } break;
 
             case SYNC_CHARACTER_SKILL:
@@ -699,7 +699,7 @@ void GameServerHandler::syncDatabase(MessageIn &msg)
                 int charId = msg.readInt32();
                 int skillId = msg.readInt8();
                 int skillValue = msg.readInt32();
-                storage->updateExperience(charId, skillId, skillValue);
+                storage->queueExperience(charId, skillId, skillValue);
             } break;
 
             case SYNC_ONLINE_STATUS:
@@ -707,6 +707,9 @@ void GameServerHandler::syncDatabase(MessageIn &msg)
                 LOG_DEBUG("received SYNC_ONLINE_STATUS");
                 int charId = msg.readInt32();
                 bool online = (msg.readInt8() == 1);
+                // Write the changes of a leaving character right away
+                if (!online)
+                    storage->flushPendingSync(charId);
                 storage->setOnlineStatus(charId, online);
             }
         }
@@ -68,7 +68,8 @@ namespace GameServerHandler
 
     /**
      * Takes a GAMSG_PLAYER_SYNC from the gameserver and stores all changes in
-     * the database.
+     * the database. Attribute, skill and point changes are queued in the
+     * storage's write-behind buffer.
      */
     void syncDatabase(MessageIn &msg);
 }
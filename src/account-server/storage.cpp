@@ -18,7 +18,9 @@
  *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
 #include <time.h>
 
 #include "account-server/storage.h"
@@ -31,10 +33,12 @@
 #include "chat-server/post.h"
 #include "common/configuration.h"
 #include "common/manaserv_protocol.h"
+#include "common/resourcemanager.h"
 #include "dal/dalexcept.h"
 #include "dal/dataproviderfactory.h"
 #include "utils/functors.h"
 #include "utils/point.h"
+#include "utils/sha256.h"
 #include "utils/string.h"
 #include "utils/throwerror.h"
 #include "utils/xml.h"
@@ -43,9 +47,30 @@
 
 static const char *DEFAULT_ITEM_FILE = "items.xml";
 
+// Default sizes of the account and character caches
+static const int DEFAULT_CACHED_ACCOUNTS = 500;
+static const int DEFAULT_CACHED_CHARACTERS = 1500;
+
+// Defaults of the write-behind buffer for GAMSG_PLAYER_SYNC records
+static const int DEFAULT_SYNC_FLUSH_INTERVAL = 5;
+static const int DEFAULT_SYNC_MAX_PENDING = 1000;
+
+// Defaults of the transaction log buffer
+static const int DEFAULT_TRANSACTION_MAX_PENDING = 500;
+
+// Maximum number of transactions written by a single statement
+static const unsigned int TRANSACTION_BATCH_SIZE = 100;
+
 // Defines the supported db version
 static const char *DB_VERSION_PARAMETER = "database_version";
 
+// Hash and version of the item file at the last item database sync
+static const char *ITEM_DB_HASH_PARAMETER = "item_database_hash";
+static const char *ITEM_DB_VERSION_PARAMETER = "item_database_version";
+
+// Maximum number of items added to the database by a single statement
+static const unsigned int ITEM_SYNC_BATCH_SIZE = 100;
+
 /*
  * MySQL specificities:
  *     - TINYINT is an integer (1 byte) type defined as an extension to
@@ -94,9 +119,55 @@ static const char *ONLINE_USERS_TBL_NAME        =   "mana_online_list";
 static const char *TRANSACTION_TBL_NAME         =   "mana_transactions";
 static const char *FLOOR_ITEMS_TBL_NAME         =   "mana_floor_items";
 
+/**
+ * Matches the cached characters that belong to the given account.
+ */
+struct CharacterOwnedBy
+{
+    CharacterOwnedBy(int accountId): accountId(accountId) {}
+
+    bool operator()(const Character &character) const
+    { return character.getAccountID() == accountId; }
+
+    int accountId;
+};
+
+/**
+ * Matches the cached accounts that contain the given character.
+ */
+struct AccountHasCharacter
+{
+    AccountHasCharacter(int charId): charId(charId) {}
+
+    template <class CachedAccount>
+    bool operator()(const CachedAccount &cached) const
+    { return cached.hasCharacter(charId); }
+
+    int charId;
+};
+
+Storage::CachedAccount::~CachedAccount()
+{
+    delete account;
+}
+
+bool Storage::CachedAccount::hasCharacter(int charId) const
+{
+    for (std::vector<int>::const_iterator it = characterIds.begin(),
+         it_end = characterIds.end(); it != it_end; ++it)
+    {
+        if (*it == charId)
+            return true;
+    }
+    return false;
+}
+
 Storage::Storage()
         : mDb(dal::DataProviderFactory::createDataProvider()),
-          mItemDbVersion(0)
+          mItemDbVersion(0),
+          mSyncFlushInterval(0),
+          mSyncMaxPending(0),
+          mTransactionMaxPending(0)
 {
 }
 
@@ -121,6 +192,9 @@ void Storage::open()
         // Open a connection to the database.
         mDb->connect();
 
+        // Keep all the world state variables in memory
+        loadWorldStateVars();
+
         // Check database version here
         int dbversion = utils::stringToInt(
                     getWorldStateVar(DB_VERSION_PARAMETER, SystemMap));
@@ -150,6 +224,73 @@ void Storage::open()
             sql << "DELETE FROM " << FLOOR_ITEMS_TBL_NAME;
             mDb->execSql(sql.str());
         }
+
+        // Character changes received from the game servers are buffered and
+        // written at this interval. Everything received since the last flush
+        // is lost on a crash, so 0 restores the immediate writes.
+        int flushInterval = Configuration::getValue(
+                    "account_syncFlushInterval", DEFAULT_SYNC_FLUSH_INTERVAL);
+        int maxPending = Configuration::getValue(
+                    "account_syncMaxPending", DEFAULT_SYNC_MAX_PENDING);
+        mSyncFlushInterval = flushInterval > 0 ? flushInterval : 0;
+        mSyncMaxPending = maxPending > 0 ? maxPending : 1;
+
+        if (mSyncFlushInterval)
+        {
+            LOG_INFO("Buffering character changes for up to "
+                     << mSyncFlushInterval << " seconds.");
+        }
+
+        // Logged transactions are buffered as well, and optionally journaled
+        // to a local file so that they survive a crash.
+        int transactionMaxPending = Configuration::getValue(
+                    "account_transactionMaxPending",
+                    DEFAULT_TRANSACTION_MAX_PENDING);
+        mTransactionMaxPending =
+                transactionMaxPending > 0 ? transactionMaxPending : 1;
+
+        const std::string journal =
+                Configuration::getValue("account_transactionJournal",
+                                        std::string());
+        if (!journal.empty())
+        {
+            int journalSync = Configuration::getValue(
+                        "account_transactionJournalSync",
+                        TransactionLog::SYNC_ON_FLUSH);
+            if (journalSync < TransactionLog::SYNC_NEVER
+                || journalSync > TransactionLog::SYNC_ALWAYS)
+            {
+                LOG_ERROR("Invalid account_transactionJournalSync "
+                          << journalSync << ", syncing on flush.");
+                journalSync = TransactionLog::SYNC_ON_FLUSH;
+            }
+            mTransactionLog.setSyncPolicy(
+                        (TransactionLog::SyncPolicy) journalSync);
+
+            // A journal left by a previous run is replayed even when the
+            // transactions are no longer buffered.
+            if (unsigned recovered = mTransactionLog.openJournal(journal))
+            {
+                LOG_INFO("Recovered " << recovered << " transactions from "
+                         << journal << '.');
+                flushTransactions();
+            }
+
+            // Unbuffered transactions are written right away, the journal
+            // is only kept until the recovered ones are in the database.
+            if (!mSyncFlushInterval && mTransactionLog.empty())
+                mTransactionLog.closeJournal();
+        }
+
+        // Recently loaded accounts and characters are kept in memory, so
+        // that reconnects and server changes do not need to load them again.
+        int cachedAccounts = Configuration::getValue(
+                    "account_cachedAccounts", DEFAULT_CACHED_ACCOUNTS);
+        int cachedCharacters = Configuration::getValue(
+                    "account_cachedCharacters", DEFAULT_CACHED_CHARACTERS);
+        mAccountCache.setCapacity(cachedAccounts > 0 ? cachedAccounts : 0);
+        mCharacterCache.setCapacity(cachedCharacters > 0 ?
+                                    cachedCharacters : 0);
     }
     catch (const DbConnectionFailure& e)
     {
@@ -160,9 +301,105 @@ void Storage::open()
 
 void Storage::close()
 {
+    // Make sure no buffered change is lost on shutdown
+    if (mDb->isConnected())
+    {
+        flushPendingSync();
+        flushWorldStateVars();
+        flushTransactions();
+    }
+    mTransactionLog.closeJournal();
+
+    mWorldStateVars.clear();
+    mDirtyWorldStateVars.clear();
+
+    mAccountCache.clear();
+    mCharacterCache.clear();
+
     mDb->disconnect();
 }
 
+Account *Storage::getCachedAccount(const CachedAccount *cached)
+{
+    const Account *source = cached->account;
+    Account *account = new Account(source->getID());
+    account->setName(source->getName());
+    account->setPassword(source->getPassword());
+    account->setEmail(source->getEmail());
+    account->setLevel(source->getLevel());
+    account->setRegistrationDate(source->getRegistrationDate());
+    account->setLastLogin(source->getLastLogin());
+
+    // Loading the characters may evict the cached account, so copy the ids.
+    const std::vector<int> characterIds = cached->characterIds;
+
+    Characters characters;
+    for (std::vector<int>::const_iterator it = characterIds.begin(),
+         it_end = characterIds.end(); it != it_end; ++it)
+    {
+        if (Character *ptr = getCharacter(*it, account))
+        {
+            characters[ptr->getCharacterSlot()] = ptr;
+        }
+        else
+        {
+            LOG_ERROR("Failed to get character " << *it
+                      << " for account " << account->getID() << '.');
+        }
+    }
+    account->setCharacters(characters);
+
+    return account;
+}
+
+Character *Storage::getCachedCharacter(const Character *cached,
+                                       Account *owner) const
+{
+    Character *character = new Character(*cached);
+    if (owner)
+        character->setAccount(owner);
+    return character;
+}
+
+void Storage::invalidateAccount(int accountId)
+{
+    mAccountCache.erase(accountId);
+    mCharacterCache.eraseIf(CharacterOwnedBy(accountId));
+}
+
+void Storage::invalidateCharacter(int charId, bool ownerChanged)
+{
+    if (ownerChanged)
+    {
+        const Character *cached = mCharacterCache.peek(charId);
+        if (cached)
+            mAccountCache.erase(cached->getAccountID());
+        else
+            mAccountCache.eraseIf(AccountHasCharacter(charId));
+    }
+
+    mCharacterCache.erase(charId);
+}
+
+void Storage::dumpStatistics(std::ostream &os) const
+{
+    os << "<storagecache accounts=\"" << mAccountCache.size()
+       << "\" account_hits=\"" << mAccountCache.getHits()
+       << "\" account_misses=\"" << mAccountCache.getMisses()
+       << "\" characters=\"" << mCharacterCache.size()
+       << "\" character_hits=\"" << mCharacterCache.getHits()
+       << "\" character_misses=\"" << mCharacterCache.getMisses()
+       << "\" />\n";
+    os << "<worldstate maps=\"" << mWorldStateVars.size()
+       << "\" pending=\"" << mDirtyWorldStateVars.size() << "\" />\n";
+    os << "<transactionlog pending=\"" << mTransactionLog.size()
+       << "\" appended=\"" << mTransactionLog.getAppendedCount()
+       << "\" journal=\"" << mTransactionLog.hasJournal() << "\" />\n";
+    os << "<syncbuffer pending=\"" << mSyncBuffer.size()
+       << "\" received=\"" << mSyncBuffer.getReceivedCount()
+       << "\" coalesced=\"" << mSyncBuffer.getCoalescedCount() << "\" />\n";
+}
+
 Account *Storage::getAccountBySQL()
 {
     try
@@ -194,7 +431,8 @@ Account *Storage::getAccountBySQL()
             || time(0) <= (int) toUint(accountInfo(0, 5)))
         {
             account->setLevel(AL_BANNED);
-            // It is, so skip character loading.
+            // It is, so skip character loading. Banned accounts are not
+            // cached, as their ban may expire at any time.
             return account;
         }
         account->setLevel(level);
@@ -203,6 +441,9 @@ Account *Storage::getAccountBySQL()
         // NOTE: Will be deprecated and removed at some point.
         fixCharactersSlot(id);
 
+        // Ids of the loaded characters, for the cached copy of the account
+        std::vector<int> cachedIds;
+
         // Load the characters associated with the account.
         std::ostringstream sql;
         sql << "select id from " << CHARACTERS_TBL_NAME << " where user_id = '"
@@ -228,6 +469,7 @@ Account *Storage::getAccountBySQL()
                 if (Character *ptr = getCharacter(characterIDs[k], account))
                 {
                     characters[ptr->getCharacterSlot()] = ptr;
+                    cachedIds.push_back(ptr->getDatabaseID());
                 }
                 else
                 {
@@ -239,6 +481,17 @@ Account *Storage::getAccountBySQL()
             account->setCharacters(characters);
         }
 
+        Account *cachedAccount = new Account(id);
+        cachedAccount->setName(account->getName());
+        cachedAccount->setPassword(account->getPassword());
+        cachedAccount->setEmail(account->getEmail());
+        cachedAccount->setLevel(level);
+        cachedAccount->setRegistrationDate(account->getRegistrationDate());
+        cachedAccount->setLastLogin(account->getLastLogin());
+        CachedAccount *cached = new CachedAccount(cachedAccount);
+        cached->characterIds.swap(cachedIds);
+        mAccountCache.insert(id, account->getName(), cached);
+
         return account;
     }
     catch (const dal::DbSqlQueryExecFailure &e)
@@ -307,6 +560,7 @@ void Storage::fixCharactersSlot(int accountId)
                     << " SET slot = " << i->second
                     << " where id = " << i->first;
                 mDb->execSql(sql.str());
+                invalidateCharacter(i->first);
             }
 
             transaction.commit();
@@ -321,6 +575,9 @@ void Storage::fixCharactersSlot(int accountId)
 
 Account *Storage::getAccount(const std::string &userName)
 {
+    if (const CachedAccount *cached = mAccountCache.find(userName))
+        return getCachedAccount(cached);
+
     std::ostringstream sql;
     sql << "SELECT * FROM " << ACCOUNTS_TBL_NAME << " WHERE username = ?";
     if (mDb->prepareSql(sql.str()))
@@ -333,6 +590,9 @@ Account *Storage::getAccount(const std::string &userName)
 
 Account *Storage::getAccount(int accountID)
 {
+    if (const CachedAccount *cached = mAccountCache.find(accountID))
+        return getCachedAccount(cached);
+
     std::ostringstream sql;
     sql << "SELECT * FROM " << ACCOUNTS_TBL_NAME << " WHERE id = ?";
     if (mDb->prepareSql(sql.str()))
@@ -564,11 +824,23 @@ Character *Storage::getCharacterBySQL(Account *owner)
                           e);
     }
 
+    // The cached copy must not refer to the possibly temporary owner
+    Character *cachedCharacter = new Character(*character);
+    cachedCharacter->mAccount = 0;
+    mCharacterCache.insert(character->getDatabaseID(), character->getName(),
+                           cachedCharacter);
+
     return character;
 }
 
 Character *Storage::getCharacter(int id, Account *owner)
 {
+    // Pending changes need to be in the database before we read it
+    flushPendingSync(id);
+
+    if (const Character *cached = mCharacterCache.find(id))
+        return getCachedCharacter(cached, owner);
+
     std::ostringstream sql;
     sql << "SELECT * FROM " << CHARACTERS_TBL_NAME << " WHERE id = ?";
     if (mDb->prepareSql(sql.str()))
@@ -581,6 +853,17 @@ Character *Storage::getCharacter(int id, Account *owner)
 
 Character *Storage::getCharacter(const std::string &name)
 {
+    // Pending changes need to be in the database before we read it. The id
+    // of the character only needs to be queried when it is not cached.
+    if (const Character *cached = mCharacterCache.find(name))
+    {
+        flushPendingSync(cached->getDatabaseID());
+        return getCachedCharacter(cached, 0);
+    }
+
+    if (!mSyncBuffer.empty())
+        flushPendingSync(getCharacterId(name));
+
     std::ostringstream sql;
     sql << "SELECT * FROM " << CHARACTERS_TBL_NAME << " WHERE name = ?";
     if (mDb->prepareSql(sql.str()))
@@ -718,6 +1001,10 @@ bool Storage::doesCharacterNameExist(const std::string& name)
 
 bool Storage::updateCharacter(Character *character)
 {
+    // The complete character data supersedes any change still pending
+    mSyncBuffer.discard(character->getDatabaseID());
+    invalidateCharacter(character->getDatabaseID());
+
     dal::PerformTransaction transaction(mDb);
 
     try
@@ -988,6 +1275,9 @@ void Storage::flush(Account *account)
 
     using namespace dal;
 
+    // Characters may be added or removed, so the cached account gets stale
+    invalidateAccount(account->getID());
+
     try
     {
         PerformTransaction transaction(mDb);
@@ -1155,6 +1445,9 @@ void Storage::delAccount(Account *account)
 
 void Storage::updateLastLogin(const Account *account)
 {
+    if (CachedAccount *cached = mAccountCache.peek(account->getID()))
+        cached->account->setLastLogin(account->getLastLogin());
+
     try
     {
         std::ostringstream sql;
@@ -1173,12 +1466,14 @@ void Storage::updateLastLogin(const Account *account)
 void Storage::updateCharacterPoints(int charId,
                                     int charPoints, int corrPoints)
 {
+    invalidateCharacter(charId);
+
     try
     {
         std::ostringstream sql;
         sql << "UPDATE " << CHARACTERS_TBL_NAME
             << " SET char_pts = " << charPoints << ", "
-            << " correct_pts = " << corrPoints << ", "
+            << " correct_pts = " << corrPoints
             << " WHERE id = " << charId;
 
         mDb->execSql(sql.str());
@@ -1193,6 +1488,8 @@ void Storage::updateCharacterPoints(int charId,
 
 void Storage::updateExperience(int charId, int skillId, int skillValue)
 {
+    invalidateCharacter(charId);
+
     try
     {
         std::ostringstream sql;
@@ -1239,6 +1536,8 @@ void Storage::updateExperience(int charId, int skillId, int skillValue)
 void Storage::updateAttribute(int charId, unsigned int attrId,
                               double base, double mod)
 {
+    invalidateCharacter(charId);
+
     try
     {
         std::ostringstream sql;
@@ -1272,6 +1571,8 @@ void Storage::updateAttribute(int charId, unsigned int attrId,
 
 void Storage::updateKillCount(int charId, int monsterId, int kills)
 {
+    invalidateCharacter(charId);
+
     try
     {
         // Try to update the kill count
@@ -1304,6 +1605,8 @@ void Storage::updateKillCount(int charId, int monsterId, int kills)
 
 void Storage::insertStatusEffect(int charId, int statusId, int time)
 {
+    invalidateCharacter(charId);
+
     try
     {
         std::ostringstream sql;
@@ -1322,6 +1625,104 @@ void Storage::insertStatusEffect(int charId, int statusId, int time)
     }
 }
 
+void Storage::queueCharacterPoints(int charId,
+                                   int charPoints, int corrPoints)
+{
+    if (!mSyncFlushInterval)
+    {
+        updateCharacterPoints(charId, charPoints, corrPoints);
+        return;
+    }
+
+    mSyncBuffer.setCharacterPoints(charId, charPoints, corrPoints);
+    if (mSyncBuffer.size() >= mSyncMaxPending)
+        flushPendingSync();
+}
+
+void Storage::queueAttribute(int charId, unsigned int attrId,
+                             double base, double mod)
+{
+    if (!mSyncFlushInterval)
+    {
+        updateAttribute(charId, attrId, base, mod);
+        return;
+    }
+
+    mSyncBuffer.setAttribute(charId, attrId, base, mod);
+    if (mSyncBuffer.size() >= mSyncMaxPending)
+        flushPendingSync();
+}
+
+void Storage::queueExperience(int charId, int skillId, int skillValue)
+{
+    if (!mSyncFlushInterval)
+    {
+        updateExperience(charId, skillId, skillValue);
+        return;
+    }
+
+    mSyncBuffer.setExperience(charId, skillId, skillValue);
+    if (mSyncBuffer.size() >= mSyncMaxPending)
+        flushPendingSync();
+}
+
+void Storage::flushPendingSync(int charId)
+{
+    SyncBuffer::Records records;
+    mSyncBuffer.take(records, charId);
+    if (records.empty())
+        return;
+
+    try
+    {
+        dal::PerformTransaction transaction(mDb);
+
+        for (SyncBuffer::Records::const_iterator it = records.begin(),
+             it_end = records.end(); it != it_end; ++it)
+        {
+            const SyncBuffer::Key &key = it->first;
+            const SyncBuffer::Value &value = it->second;
+            switch (key.type)
+            {
+                case SyncBuffer::FIELD_POINTS:
+                    updateCharacterPoints(key.charId, (int) value.first,
+                                          (int) value.second);
+                    break;
+                case SyncBuffer::FIELD_ATTRIBUTE:
+                    updateAttribute(key.charId, key.id,
+                                    value.first, value.second);
+                    break;
+                case SyncBuffer::FIELD_SKILL:
+                    updateExperience(key.charId, key.id, (int) value.first);
+                    break;
+            }
+        }
+
+        transaction.commit();
+    }
+    catch (const std::string &)
+    {
+        // The error was logged already. Keep the records so that the next
+        // flush can try again.
+        mSyncBuffer.restore(records);
+        LOG_WARN("Keeping " << records.size()
+                 << " character changes for a later flush.");
+        return;
+    }
+    catch (const std::exception &e)
+    {
+        // Failing to commit, for instance when the database is busy
+        mSyncBuffer.restore(records);
+        LOG_WARN("Keeping " << records.size()
+                 << " character changes for a later flush: " << e.what());
+        return;
+    }
+
+    LOG_DEBUG("Flushed " << records.size() << " character changes ("
+              << mSyncBuffer.getCoalescedCount()
+              << " writes saved so far).");
+}
+
 void Storage::addGuild(Guild *guild)
 {
     try
@@ -1608,99 +2009,121 @@ std::string Storage::getQuestVar(int id, const std::string &name)
     return std::string();
 }
 
-std::string Storage::getWorldStateVar(const std::string &name, int mapId)
+void Storage::loadWorldStateVars()
 {
+    mWorldStateVars.clear();
+    mDirtyWorldStateVars.clear();
+
     try
     {
         std::ostringstream query;
-        query << "SELECT `value` "
-              << "FROM " << WORLD_STATES_TBL_NAME
-              << " WHERE `state_name` = ?";
-
-        // Add map filter if map_id is given
-        if (mapId >= 0)
-            query << " AND `map_id` = ?";
+        query << "SELECT state_name, map_id, value FROM "
+              << WORLD_STATES_TBL_NAME;
+        const dal::RecordSet &results = mDb->execSql(query.str(), true);
 
-        //query << ";"; <-- No ';' at the end of prepared statements.
-
-        if (mDb->prepareSql(query.str()))
+        for (unsigned int i = 0; i < results.rows(); ++i)
         {
-            mDb->bindValue(1, name);
-            if (mapId >= 0)
-                mDb->bindValue(2, mapId);
-            const dal::RecordSet &info = mDb->processSql();
-
-            if (!info.isEmpty())
-                return info(0, 0);
-        }
-        else
-        {
-            utils::throwError("(DALStorage:getWorldStateVar) "
-                              "SQL query preparation failure.");
+            int mapId = utils::stringToInt(results(i, 1));
+            mWorldStateVars[mapId][results(i, 0)] = results(i, 2);
         }
+
+        LOG_INFO("Loaded " << results.rows() << " world state variables.");
     }
     catch (const dal::DbSqlQueryExecFailure &e)
     {
-        utils::throwError("(DALStorage::getWorldStateVar) SQL query failure: ",
-                          e);
+        utils::throwError("(DALStorage::loadWorldStateVars) "
+                          "SQL query failure: ", e);
     }
+}
 
-    return std::string();
+std::string Storage::getWorldStateVar(const std::string &name, int mapId)
+{
+    std::map<int, WorldStateVars>::const_iterator map =
+            mWorldStateVars.find(mapId);
+    if (map == mWorldStateVars.end())
+        return std::string();
+
+    WorldStateVars::const_iterator it = map->second.find(name);
+    return it != map->second.end() ? it->second : std::string();
 }
 
 std::map<std::string, std::string> Storage::getAllWorldStateVars(int mapId)
 {
-    std::map<std::string, std::string> variables;
-
-    // Avoid a crash because prepared statements must have at least one binding.
     if (mapId < 0)
     {
         LOG_ERROR("getAllWorldStateVars was called with a negative map Id: "
                   << mapId);
-        return variables;
+        return WorldStateVars();
     }
 
-    try
+    std::map<int, WorldStateVars>::const_iterator map =
+            mWorldStateVars.find(mapId);
+    if (map == mWorldStateVars.end())
+        return WorldStateVars();
+
+    return map->second;
+}
+
+void Storage::setWorldStateVar(const std::string &name,
+                               const std::string &value,
+                               int mapId)
+{
+    if (value.empty())
+        mWorldStateVars[mapId].erase(name);
+    else
+        mWorldStateVars[mapId][name] = value;
+
+    if (!mSyncFlushInterval)
     {
-        std::ostringstream query;
-        query << "SELECT `state_name`, `value` "
-              << "FROM " << WORLD_STATES_TBL_NAME;
+        writeWorldStateVar(name, value, mapId);
+        return;
+    }
 
-        // Add map filter if map_id is given
-        if (mapId >= 0)
-            query << " WHERE `map_id` = ?";
+    mDirtyWorldStateVars.insert(WorldStateKey(mapId, name));
+    if (mDirtyWorldStateVars.size() >= mSyncMaxPending)
+        flushWorldStateVars();
+}
 
-        //query << ";"; <-- No ';' at the end of prepared statements.
+void Storage::flushWorldStateVars()
+{
+    if (mDirtyWorldStateVars.empty())
+        return;
 
-        if (mDb->prepareSql(query.str()))
-        {
-            if (mapId >= 0)
-                mDb->bindValue(1, mapId);
-            const dal::RecordSet &results = mDb->processSql();
+    std::set<WorldStateKey> dirty;
+    dirty.swap(mDirtyWorldStateVars);
 
-            for (unsigned int i = 0; i < results.rows(); ++i)
-            {
-                variables[results(i, 0)] = results(i, 1);
-            }
-        }
-        else
+    try
+    {
+        dal::PerformTransaction transaction(mDb);
+
+        for (std::set<WorldStateKey>::const_iterator it = dirty.begin(),
+             it_end = dirty.end(); it != it_end; ++it)
         {
-            utils::throwError("(DALStorage:getAllWorldStateVar) "
-                              "SQL query preparation failure.");
+            writeWorldStateVar(it->second,
+                               getWorldStateVar(it->second, it->first),
+                               it->first);
         }
+
+        transaction.commit();
     }
-    catch (const dal::DbSqlQueryExecFailure &e)
+    catch (const std::string &error)
     {
-        utils::throwError("(DALStorage::getWorldStateVar) SQL query failure: ",
-                          e);
+        // The current values are written by the next flush
+        mDirtyWorldStateVars.insert(dirty.begin(), dirty.end());
+        LOG_WARN("Failed to write " << dirty.size()
+                 << " world state variables, retrying later: " << error);
+    }
+    catch (const std::exception &e)
+    {
+        mDirtyWorldStateVars.insert(dirty.begin(), dirty.end());
+        LOG_WARN("Failed to write " << dirty.size()
+                 << " world state variables, retrying later: " << e.what());
     }
-
-    return variables;
 }
 
-void Storage::setWorldStateVar(const std::string &name,
-                               const std::string &value,
-                               int mapId)
+void Storage::writeWorldStateVar(const std::string &name,
+                                 const std::string &value,
+                                 int mapId)
 {
     try
     {
@@ -1740,8 +2163,8 @@ void Storage::setWorldStateVar(const std::string &name,
     }
     catch (const dal::DbSqlQueryExecFailure &e)
     {
-        utils::throwError("(DALStorage::setWorldStateVar) SQL query failure: ",
-                          e);
+        utils::throwError("(DALStorage::writeWorldStateVar) "
+                          "SQL query failure: ", e);
     }
 }
 
@@ -1786,6 +2209,8 @@ void Storage::banCharacter(int id, int duration)
             return;
         }
 
+        invalidateAccount(utils::stringToInt(info(0, 0)));
+
         uint64_t bantime = (uint64_t)time(0) + (uint64_t)duration * 60u;
         // ban the character
         std::ostringstream sql;
@@ -1801,8 +2226,11 @@ void Storage::banCharacter(int id, int duration)
     }
 }
 
-void Storage::delCharacter(int charId) const
+void Storage::delCharacter(int charId)
 {
+    mSyncBuffer.discard(charId);
+    invalidateCharacter(charId, true);
+
     try
     {
         dal::PerformTransaction transaction(mDb);
@@ -1863,7 +2291,7 @@ void Storage::delCharacter(int charId) const
     }
 }
 
-void Storage::delCharacter(Character *character) const
+void Storage::delCharacter(Character *character)
 {
     delCharacter(character->getDatabaseID());
 }
@@ -1879,6 +2307,13 @@ void Storage::checkBannedAccounts()
         << " where level = " << AL_BANNED
         << " AND banned <= " << time(0) << ";";
         mDb->execSql(sql.str());
+
+        // Lifted bans change the level of accounts and their characters
+        if (mDb->getModifiedRows() > 0)
+        {
+            mAccountCache.clear();
+            mCharacterCache.clear();
+        }
     }
     catch (const dal::DbSqlQueryExecFailure &e)
     {
@@ -1889,6 +2324,8 @@ void Storage::checkBannedAccounts()
 
 void Storage::setAccountLevel(int id, int level)
 {
+    invalidateAccount(id);
+
     try
     {
         std::ostringstream sql;
@@ -1906,6 +2343,8 @@ void Storage::setAccountLevel(int id, int level)
 
 void Storage::setPlayerLevel(int id, int level)
 {
+    invalidateCharacter(id);
+
     try
     {
         std::ostringstream sql;
@@ -2072,8 +2511,59 @@ void Storage::deletePost(Letter *letter)
     }
 }
 
+/**
+ * An item definition as stored in the items table.
+ */
+struct ItemDefinition
+{
+    ItemDefinition(): weight(0) {}
+
+    std::string name;
+    std::string description;
+    std::string image;
+    int weight;
+    std::string type;
+    std::string effect;
+    std::string dye;
+};
+
+/**
+ * Returns a fingerprint of the item definition, used to find out whether the
+ * stored row of an item is outdated.
+ */
+static std::string itemFingerprint(const ItemDefinition &item)
+{
+    std::ostringstream fields;
+    fields << item.name << '\n' << item.description << '\n'
+           << item.image << '\n' << item.weight << '\n'
+           << item.type << '\n' << item.effect << '\n' << item.dye;
+    return sha256(fields.str());
+}
+
 void Storage::syncDatabase()
 {
+    // Nothing needs to be synchronized when the item file did not change
+    // since the last run.
+    int fileSize;
+    char *fileData = ResourceManager::loadFile(DEFAULT_ITEM_FILE, fileSize);
+    if (!fileData)
+    {
+        LOG_ERROR("Item Manager: Could not read the item database ("
+                  << DEFAULT_ITEM_FILE << ")!");
+        return;
+    }
+    const std::string fileHash = sha256(std::string(fileData, fileSize));
+    free(fileData);
+
+    if (fileHash == getWorldStateVar(ITEM_DB_HASH_PARAMETER, SystemMap))
+    {
+        mItemDbVersion = utils::stringToInt(
+                    getWorldStateVar(ITEM_DB_VERSION_PARAMETER, SystemMap));
+        LOG_INFO("Item database version " << mItemDbVersion
+                 << " is up to date.");
+        return;
+    }
+
     XML::Document doc(DEFAULT_ITEM_FILE);
     xmlNodePtr rootNode = doc.rootNode();
 
@@ -2086,8 +2576,7 @@ void Storage::syncDatabase()
         return;
     }
 
-    dal::PerformTransaction transaction(mDb);
-    int itemCount = 0;
+    std::map<int, ItemDefinition> items;
     for_each_xml_child_node(node, rootNode)
     {
         // Try to load the version of the item database.
@@ -2107,80 +2596,151 @@ void Storage::syncDatabase()
         if (id < 1)
             continue;
 
-        int weight = XML::getProperty(node, "weight", 0);
-        std::string type = XML::getProperty(node, "type", std::string());
-        std::string name = XML::getProperty(node, "name", std::string());
-        std::string desc = XML::getProperty(node, "description",
+        ItemDefinition &item = items[id];
+        item.weight = XML::getProperty(node, "weight", 0);
+        item.type = XML::getProperty(node, "type", std::string());
+        item.name = XML::getProperty(node, "name", std::string());
+        item.description = XML::getProperty(node, "description",
                                             std::string());
-        std::string eff  = XML::getProperty(node, "effect", std::string());
-        std::string image = XML::getProperty(node, "image", std::string());
-        std::string dye;
+        item.effect = XML::getProperty(node, "effect", std::string());
+        item.image = XML::getProperty(node, "image", std::string());
+        item.dye.clear();
 
         // Split image name and dye string
-        size_t pipe = image.find("|");
+        size_t pipe = item.image.find("|");
         if (pipe != std::string::npos)
         {
-            dye = image.substr(pipe + 1);
-            image = image.substr(0, pipe);
+            item.dye = item.image.substr(pipe + 1);
+            item.image = item.image.substr(0, pipe);
         }
+    }
 
-        try
+    try
+    {
+        // Compare the definitions with the fingerprints of the stored rows
+        string_to< unsigned > toUint;
+        std::map<int, std::string> storedFingerprints;
+        std::ostringstream sql;
+        sql << "SELECT id, name, description, image, weight, itemtype, "
+            << "effect, dyestring FROM " << ITEMS_TBL_NAME;
+        const dal::RecordSet &itemInfo = mDb->execSql(sql.str(), true);
+        for (unsigned int row = 0; row < itemInfo.rows(); ++row)
+        {
+            ItemDefinition stored;
+            stored.name = itemInfo(row, 1);
+            stored.description = itemInfo(row, 2);
+            stored.image = itemInfo(row, 3);
+            stored.weight = toUint(itemInfo(row, 4));
+            stored.type = itemInfo(row, 5);
+            stored.effect = itemInfo(row, 6);
+            stored.dye = itemInfo(row, 7);
+            storedFingerprints[toUint(itemInfo(row, 0))] =
+                    itemFingerprint(stored);
+        }
+
+        std::vector<int> addedItems;
+        std::vector<int> changedItems;
+        for (std::map<int, ItemDefinition>::const_iterator it = items.begin(),
+             it_end = items.end(); it != it_end; ++it)
+        {
+            std::map<int, std::string>::const_iterator stored =
+                    storedFingerprints.find(it->first);
+            if (stored == storedFingerprints.end())
+                addedItems.push_back(it->first);
+            else if (stored->second != itemFingerprint(it->second))
+                changedItems.push_back(it->first);
+        }
+
+        dal::PerformTransaction transaction(mDb);
+
+        for (std::vector<int>::const_iterator it = changedItems.begin(),
+             it_end = changedItems.end(); it != it_end; ++it)
         {
-            std::ostringstream sql;
+            const ItemDefinition &item = items[*it];
+
+            sql.clear();
+            sql.str("");
             sql << "UPDATE " << ITEMS_TBL_NAME
                 << " SET name = ?, "
                 << "     description = ?, "
-                << "     image = '" << image << "', "
-                << "     weight = " << weight << ", "
-                << "     itemtype = '" << type << "', "
+                << "     image = ?, "
+                << "     weight = " << item.weight << ", "
+                << "     itemtype = ?, "
                 << "     effect = ?, "
-                << "     dyestring = '" << dye << "' "
-                << " WHERE id = " << id;
+                << "     dyestring = ? "
+                << " WHERE id = " << *it;
 
-            if (mDb->prepareSql(sql.str()))
-            {
-                mDb->bindValue(1, name);
-                mDb->bindValue(2, desc);
-                mDb->bindValue(3, eff);
-
-                mDb->processSql();
-                if (mDb->getModifiedRows() == 0)
-                {
-                    sql.clear();
-                    sql.str("");
-                    sql << "INSERT INTO " << ITEMS_TBL_NAME
-                        << "  VALUES ( " << id << ", ?, ?, '"
-                        << image << "', " << weight << ", '"
-                        << type << "', ?, '" << dye << "' )";
-                    if (mDb->prepareSql(sql.str()))
-                    {
-                        mDb->bindValue(1, name);
-                        mDb->bindValue(2, desc);
-                        mDb->bindValue(3, eff);
-                        mDb->processSql();
-                    }
-                    else
-                    {
-                        utils::throwError("(DALStorage::SyncDatabase) "
-                                          "SQL query preparation failure #2.");
-                    }
-                }
-            }
-            else
+            if (!mDb->prepareSql(sql.str()))
             {
                 utils::throwError("(DALStorage::SyncDatabase) "
                                   "SQL query preparation failure #1.");
             }
-            itemCount++;
+
+            mDb->bindValue(1, item.name);
+            mDb->bindValue(2, item.description);
+            mDb->bindValue(3, item.image);
+            mDb->bindValue(4, item.type);
+            mDb->bindValue(5, item.effect);
+            mDb->bindValue(6, item.dye);
+            mDb->processSql();
         }
-        catch (const dal::DbSqlQueryExecFailure &e)
+
+        // New items are inserted with multi-row statements
+        for (unsigned int first = 0; first < addedItems.size();
+             first += ITEM_SYNC_BATCH_SIZE)
         {
-            utils::throwError("(DALStorage::SyncDatabase) "
-                              "SQL query failure: ", e);
+            const unsigned int last = std::min<unsigned int>(
+                        first + ITEM_SYNC_BATCH_SIZE, addedItems.size());
+
+            sql.clear();
+            sql.str("");
+            sql << "INSERT INTO " << ITEMS_TBL_NAME << " VALUES ";
+            for (unsigned int i = first; i < last; ++i)
+            {
+                if (i != first)
+                    sql << ", ";
+                sql << "(" << addedItems[i] << ", ?, ?, ?, "
+                    << items[addedItems[i]].weight << ", ?, ?, ?)";
+            }
+
+            if (!mDb->prepareSql(sql.str()))
+            {
+                utils::throwError("(DALStorage::SyncDatabase) "
+                                  "SQL query preparation failure #2.");
+            }
+
+            int place = 1;
+            for (unsigned int i = first; i < last; ++i)
+            {
+                const ItemDefinition &item = items[addedItems[i]];
+                mDb->bindValue(place++, item.name);
+                mDb->bindValue(place++, item.description);
+                mDb->bindValue(place++, item.image);
+                mDb->bindValue(place++, item.type);
+                mDb->bindValue(place++, item.effect);
+                mDb->bindValue(place++, item.dye);
+            }
+            mDb->processSql();
         }
-    }
 
-    transaction.commit();
+        transaction.commit();
+
+        // Only remember the file once its items are in the database
+        std::ostringstream version;
+        version << mItemDbVersion;
+        setWorldStateVar(ITEM_DB_VERSION_PARAMETER, version.str(), SystemMap);
+        setWorldStateVar(ITEM_DB_HASH_PARAMETER, fileHash, SystemMap);
+
+        LOG_INFO("Item database synchronized: " << addedItems.size()
+                 << " added, " << changedItems.size() << " changed, "
+                 << items.size() - addedItems.size() - changedItems.size()
+                 << " unchanged.");
+    }
+    catch (const dal::DbSqlQueryExecFailure &e)
+    {
+        utils::throwError("(DALStorage::SyncDatabase) "
+                          "SQL query failure: ", e);
+    }
 }
 
 void Storage::setOnlineStatus(int charId, bool online)
@@ -2223,30 +2783,74 @@ void Storage::setOnlineStatus(int charId, bool online)
 
 void Storage::addTransaction(const Transaction &trans)
 {
+    mTransactionLog.append(trans, time(0));
+
+    if (!mSyncFlushInterval
+        || mTransactionLog.size() >= mTransactionMaxPending)
+    {
+        flushTransactions();
+    }
+}
+
+void Storage::flushTransactions()
+{
+    if (mTransactionLog.empty())
+        return;
+
     try
     {
-        std::stringstream sql;
-        sql << "INSERT INTO " << TRANSACTION_TBL_NAME
-            << " VALUES (NULL, " << trans.mCharacterId << ", "
-            << trans.mAction << ", "
-            << "?, "
-            << time(0) << ")";
-        if (mDb->prepareSql(sql.str()))
+        dal::PerformTransaction transaction(mDb);
+
+        for (unsigned int first = 0; first < mTransactionLog.size();
+             first += TRANSACTION_BATCH_SIZE)
         {
-            mDb->bindValue(1, trans.mMessage);
+            const unsigned int last = std::min<unsigned int>(
+                        first + TRANSACTION_BATCH_SIZE, mTransactionLog.size());
+
+            std::ostringstream sql;
+            sql << "INSERT INTO " << TRANSACTION_TBL_NAME
+                << " (char_id, action, message, time) VALUES ";
+            for (unsigned int i = first; i < last; ++i)
+            {
+                const TransactionLog::Entry &entry = mTransactionLog.at(i);
+                if (i != first)
+                    sql << ", ";
+                sql << "(" << entry.transaction.mCharacterId << ", "
+                    << entry.transaction.mAction << ", ?, "
+                    << entry.time << ")";
+            }
+
+            if (!mDb->prepareSql(sql.str()))
+            {
+                utils::throwError("(DALStorage::flushTransactions) "
+                                  "SQL query preparation failure.");
+            }
+
+            for (unsigned int i = first; i < last; ++i)
+            {
+                mDb->bindValue(i - first + 1,
+                               mTransactionLog.at(i).transaction.mMessage);
+            }
             mDb->processSql();
         }
-        else
-        {
-            utils::throwError("(DALStorage::SyncDatabase) "
-                              "SQL query preparation failure.");
-        }
+
+        transaction.commit();
+        mTransactionLog.clear();
     }
-    catch (const dal::DbSqlQueryExecFailure &e)
+    catch (const std::exception &e)
     {
-        utils::throwError("(DALStorage::addTransaction) SQL query failure: ",
-                          e);
+        // Includes the query failures and failing commits
+        LOG_WARN("Failed to write " << mTransactionLog.size()
+                 << " transactions, retrying later: " << e.what());
     }
+    catch (const std::string &error)
+    {
+        LOG_WARN("Failed to write " << mTransactionLog.size()
+                 << " transactions, retrying later: " << error);
+    }
+
+    // The transactions that could not be written stay in the journal
+    mTransactionLog.syncJournal();
 }
 
 std::vector<Transaction> Storage::getTransactions(unsigned int num)
@@ -2254,14 +2858,17 @@ std::vector<Transaction> Storage::getTransactions(unsigned int num)
     std::vector<Transaction> transactions;
     string_to<unsigned int> toUint;
 
+    // The newest transactions may still be waiting to be written
+    const unsigned int pending = std::min(num, mTransactionLog.size());
+
     try
     {
         std::stringstream sql;
         sql << "SELECT * FROM " << TRANSACTION_TBL_NAME;
-        const dal::RecordSet &rec = mDb->execSql(sql.str());
+        const dal::RecordSet &rec = mDb->execSql(sql.str(), true);
 
         int size = rec.rows();
-        int start = size - num;
+        int start = std::max(size - (int) (num - pending), 0);
         // Get the last <num> records and store them in transactions
         for (int i = start; i < size; ++i)
         {
@@ -2278,6 +2885,12 @@ std::vector<Transaction> Storage::getTransactions(unsigned int num)
                           e);
     }
 
+    for (unsigned int i = mTransactionLog.size() - pending;
+         i < mTransactionLog.size(); ++i)
+    {
+        transactions.push_back(mTransactionLog.at(i).transaction);
+    }
+
     return transactions;
 }
 
@@ -2291,7 +2904,7 @@ std::vector<Transaction> Storage::getTransactions(time_t date)
         std::stringstream sql;
         sql << "SELECT * FROM " << TRANSACTION_TBL_NAME << " WHERE time > "
             << date;
-        const dal::RecordSet &rec = mDb->execSql(sql.str());
+        const dal::RecordSet &rec = mDb->execSql(sql.str(), true);
 
         for (unsigned int i = 0; i < rec.rows(); ++i)
         {
@@ -2308,5 +2921,12 @@ std::vector<Transaction> Storage::getTransactions(time_t date)
                           e);
     }
 
+    for (unsigned int i = 0; i < mTransactionLog.size(); ++i)
+    {
+        const TransactionLog::Entry &entry = mTransactionLog.at(i);
+        if (entry.time > date)
+            transactions.push_back(entry.transaction);
+    }
+
     return transactions;
 }
@@ -21,12 +21,18 @@
 #ifndef STORAGE_H
 #define STORAGE_H
 
+#include <iosfwd>
 #include <list>
 #include <map>
+#include <set>
 #include <vector>
 
 #include "dal/dataprovider.h"
 
+#include "account-server/objectcache.h"
+#include "account-server/syncbuffer.h"
+#include "account-server/transactionlog.h"
+
 #include "common/transaction.h"
 
 class Account;
@@ -173,6 +179,60 @@ class Storage
          */
         void insertStatusEffect(int charId, int statusId, int time);
 
+        /**
+         * Queues a change of character points received from a game server.
+         * Like the other queue methods, the change is written immediately
+         * when write-behind is disabled (account_syncFlushInterval = 0).
+         *
+         * @see updateCharacterPoints
+         */
+        void queueCharacterPoints(int charId, int charPoints, int corrPoints);
+
+        /**
+         * Queues a change of a character attribute.
+         *
+         * @see updateAttribute
+         */
+        void queueAttribute(int charId, unsigned int attrId,
+                            double base, double mod);
+
+        /**
+         * Queues a change of character experience.
+         *
+         * @see updateExperience
+         */
+        void queueExperience(int charId, int skillId, int skillValue);
+
+        /**
+         * Writes the queued character changes to the database in one
+         * transaction. When the write fails, the changes are kept for the
+         * next flush.
+         *
+         * @param charId the character to flush, or -1 to flush all of them.
+         */
+        void flushPendingSync(int charId = -1);
+
+        /**
+         * Returns the buffer holding the queued character changes.
+         */
+        const SyncBuffer &getSyncBuffer() const
+        { return mSyncBuffer; }
+
+        /**
+         * Returns the interval in seconds at which the queued character
+         * changes, world state variables and transactions should be flushed,
+         * or 0 when write-behind is disabled.
+         */
+        unsigned int getSyncFlushInterval() const
+        { return mSyncFlushInterval; }
+
+        /**
+         * Dumps the statistics of the account and character caches, of the
+         * write-behind buffers and of the world state variables into the
+         * given stream.
+         */
+        void dumpStatistics(std::ostream &os) const;
+
         /**
          * Sets a ban on an account (hence on all its characters).
          *
@@ -186,7 +246,7 @@ class Storage
          *
          * @param charId character identifier.
          */
-        void delCharacter(int charId) const;
+        void delCharacter(int charId);
 
         /**
          * Delete a character in the database. The object itself is not touched
@@ -194,7 +254,7 @@ class Storage
          *
          * @param character character object.
          */
-        void delCharacter(Character *character) const;
+        void delCharacter(Character *character);
 
         /**
          * Removes expired bans from accounts
@@ -362,6 +422,9 @@ class Storage
          * Gets the string value of a world state variable. The \a mapId should
          * be a valid map ID or either WorldMap or SystemMap.
          *
+         * The variables are all loaded when the storage is opened, so this
+         * does not access the database.
+         *
          * @param name  Name of the requested world variable.
          * @param mapId ID of the specific map.
          */
@@ -369,7 +432,11 @@ class Storage
 
         /**
          * Sets the value of a world state variable. The \a mapId should be a
-         * valid map ID or either WorldMap or SystemMap.
+         * valid map ID or either WorldMap or SystemMap. An empty value deletes
+         * the variable.
+         *
+         * The new value is written to the database on the next call to
+         * flushWorldStateVars(), unless write-behind is disabled.
          *
          * @param name  Name of the world vairable.
          * @param value New value of the world variable.
@@ -386,6 +453,13 @@ class Storage
          */
         std::map<std::string, std::string> getAllWorldStateVars(int mapId);
 
+        /**
+         * Writes the changed world state variables to the database in one
+         * transaction. When the write fails, the changes are kept for the
+         * next flush.
+         */
+        void flushWorldStateVars();
+
         /**
          * Set the level on an account.
          *
@@ -439,21 +513,31 @@ class Storage
         void setOnlineStatus(int charId, bool online);
 
         /**
-         * Store a transaction.
+         * Store a transaction. Unless write-behind is disabled, the
+         * transaction is buffered and written by flushTransactions().
          *
          * @param trans The transaction to add in the logs.
          */
         void addTransaction(const Transaction &trans);
 
         /**
-         * Retrieve the last \a num transactions that were stored.
+         * Writes the buffered transactions to the database in one
+         * transaction. When the write fails, they are kept for the next
+         * flush.
+         */
+        void flushTransactions();
+
+        /**
+         * Retrieve the last \a num transactions that were stored, including
+         * the buffered ones.
          *
          * @return a vector of transactions.
          */
         std::vector<Transaction> getTransactions(unsigned int num);
 
         /**
-         * Retrieve all transactions since the given \a date.
+         * Retrieve all transactions since the given \a date, including the
+         * buffered ones.
          *
          * @return a vector of transactions.
          */
@@ -472,6 +556,52 @@ class Storage
         Storage(const Storage &rhs);
         Storage &operator=(const Storage &rhs);
 
+        /**
+         * An account as kept in the account cache. Its characters are cached
+         * separately, only their ids are stored here.
+         */
+        struct CachedAccount
+        {
+            CachedAccount(Account *account): account(account) {}
+            ~CachedAccount();
+
+            bool hasCharacter(int charId) const;
+
+            Account *account;
+            std::vector<int> characterIds;
+
+            private:
+                CachedAccount(const CachedAccount &);
+                CachedAccount &operator=(const CachedAccount &);
+        };
+
+        /**
+         * Returns a new account from a cached one, along with its characters.
+         */
+        Account *getCachedAccount(const CachedAccount *cached);
+
+        /**
+         * Returns a new character from a cached one.
+         *
+         * @param owner the account the character is in, if known.
+         */
+        Character *getCachedCharacter(const Character *cached,
+                                      Account *owner) const;
+
+        /**
+         * Removes an account and its characters from the caches.
+         */
+        void invalidateAccount(int accountId);
+
+        /**
+         * Removes a character from the cache.
+         *
+         * @param ownerChanged whether the character was added to or removed
+         *                     from its account, which invalidates the
+         *                     account as well.
+         */
+        void invalidateCharacter(int charId, bool ownerChanged = false);
+
         /**
          * Gets an account from a prepared SQL statement
          *
@@ -500,6 +630,9 @@ class Storage
         /**
          * Synchronizes the base data in the connected SQL database with the xml
          * files like items.xml.
+         * Only the items whose stored row differs from their definition are
+         * written, and nothing is done when the file did not change since the
+         * last synchronization.
          * This method is called once after initialization of DALStorage.
          * Probably this function should be called if a gm requests an online
          * reload of the xml files to load new items or monsters without server
@@ -507,8 +640,39 @@ class Storage
          */
         void syncDatabase();
 
+        /**
+         * Loads all the world state variables into memory.
+         */
+        void loadWorldStateVars();
+
+        /**
+         * Writes the value of a world state variable to the database, or
+         * deletes it when the value is empty.
+         */
+        void writeWorldStateVar(const std::string &name,
+                                const std::string &value,
+                                int mapId);
+
+        typedef std::map<std::string, std::string> WorldStateVars;
+        typedef std::pair<int, std::string> WorldStateKey;
+
         dal::DataProvider *mDb;         /**< the data provider */
         unsigned int mItemDbVersion;    /**< Version of the item database. */
+
+        ObjectCache<CachedAccount> mAccountCache;
+        ObjectCache<Character> mCharacterCache;
+
+        SyncBuffer mSyncBuffer;         /**< Queued character changes. */
+        unsigned int mSyncFlushInterval;/**< Seconds between two flushes. */
+        unsigned int mSyncMaxPending;   /**< Queue size forcing a flush. */
+
+        TransactionLog mTransactionLog; /**< Buffered transactions. */
+        unsigned int mTransactionMaxPending; /**< Log size forcing a flush. */
+
+        /** World state variables, by map id. */
+        std::map<int, WorldStateVars> mWorldStateVars;
+        /** World state variables changed since the last flush. */
+        std::set<WorldStateKey> mDirtyWorldStateVars;
 };
 
 extern Storage *storage;
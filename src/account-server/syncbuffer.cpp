@@ -0,0 +1,98 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "account-server/syncbuffer.h"
+
+SyncBuffer::SyncBuffer():
+    mReceived(0),
+    mCoalesced(0)
+{
+}
+
+void SyncBuffer::set(const Key &key, const Value &value)
+{
+    ++mReceived;
+
+    std::pair<Pending::iterator, bool> result =
+            mPending.insert(std::make_pair(key, value));
+    if (!result.second)
+    {
+        result.first->second = value;
+        ++mCoalesced;
+    }
+}
+
+void SyncBuffer::setCharacterPoints(int charId, int charPoints, int corrPoints)
+{
+    set(Key(charId, FIELD_POINTS, 0), Value(charPoints, corrPoints));
+}
+
+void SyncBuffer::setAttribute(int charId, unsigned attrId,
+                              double base, double mod)
+{
+    set(Key(charId, FIELD_ATTRIBUTE, attrId), Value(base, mod));
+}
+
+void SyncBuffer::setExperience(int charId, int skillId, int experience)
+{
+    set(Key(charId, FIELD_SKILL, skillId), Value(experience, 0));
+}
+
+void SyncBuffer::take(Records &records, int charId)
+{
+    if (charId < 0)
+    {
+        records.insert(records.end(), mPending.begin(), mPending.end());
+        mPending.clear();
+        return;
+    }
+
+    Pending::iterator begin = mPending.lower_bound(Key(charId,
+                                                       FIELD_POINTS, 0));
+    Pending::iterator end = begin;
+    while (end != mPending.end() && end->first.charId == charId)
+        ++end;
+
+    records.insert(records.end(), begin, end);
+    mPending.erase(begin, end);
+}
+
+void SyncBuffer::restore(const Records &records)
+{
+    // insert() leaves newer values that arrived during the flush untouched
+    for (Records::const_iterator it = records.begin(),
+         it_end = records.end(); it != it_end; ++it)
+    {
+        mPending.insert(*it);
+    }
+}
+
+void SyncBuffer::discard(int charId)
+{
+    Records dropped;
+    take(dropped, charId);
+}
+
+bool SyncBuffer::hasPending(int charId) const
+{
+    Pending::const_iterator it = mPending.lower_bound(Key(charId,
+                                                          FIELD_POINTS, 0));
+    return it != mPending.end() && it->first.charId == charId;
+}
@@ -0,0 +1,140 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNCBUFFER_H
+#define SYNCBUFFER_H
+
+#include <map>
+#include <vector>
+
+/**
+ * Holds the character changes received through GAMSG_PLAYER_SYNC until they
+ * are written to the database. Only the latest value of each
+ * (character, field) pair is kept, so a value that changes many times between
+ * two flushes results in a single SQL write.
+ *
+ * The buffer only stores values, the writing itself is done by the Storage.
+ */
+class SyncBuffer
+{
+    public:
+        enum FieldType
+        {
+            FIELD_POINTS,
+            FIELD_ATTRIBUTE,
+            FIELD_SKILL
+        };
+
+        struct Key
+        {
+            Key(int charId, FieldType type, int id):
+                charId(charId), type(type), id(id)
+            {}
+
+            bool operator<(const Key &other) const
+            {
+                if (charId != other.charId)
+                    return charId < other.charId;
+                if (type != other.type)
+                    return type < other.type;
+                return id < other.id;
+            }
+
+            int charId;
+            FieldType type;
+            int id;         /**< Attribute or skill id, 0 for points. */
+        };
+
+        /**
+         * The pending value of a field. Attributes use both members (base and
+         * modified value), skills only the first one (experience) and points
+         * both (character and correction points).
+         */
+        struct Value
+        {
+            Value(): first(0), second(0) {}
+            Value(double first, double second): first(first), second(second)
+            {}
+
+            double first;
+            double second;
+        };
+
+        typedef std::vector< std::pair<Key, Value> > Records;
+
+        SyncBuffer();
+
+        void setCharacterPoints(int charId, int charPoints, int corrPoints);
+
+        void setAttribute(int charId, unsigned attrId, double base, double mod);
+
+        void setExperience(int charId, int skillId, int experience);
+
+        /**
+         * Moves the pending records of the given character into \a records,
+         * or those of all characters when \a charId is negative. The records
+         * are sorted by character.
+         */
+        void take(Records &records, int charId = -1);
+
+        /**
+         * Puts records back into the buffer, for example after a failed
+         * flush. Records that were updated in the meantime are not
+         * overwritten.
+         */
+        void restore(const Records &records);
+
+        /**
+         * Drops the pending records of a character, e.g. when it gets deleted.
+         */
+        void discard(int charId);
+
+        bool hasPending(int charId) const;
+
+        unsigned size() const
+        { return mPending.size(); }
+
+        bool empty() const
+        { return mPending.empty(); }
+
+        /**
+         * Number of records received since creation.
+         */
+        unsigned long getReceivedCount() const
+        { return mReceived; }
+
+        /**
+         * Number of records that replaced a still pending value, and thus
+         * saved a database write.
+         */
+        unsigned long getCoalescedCount() const
+        { return mCoalesced; }
+
+    private:
+        typedef std::map<Key, Value> Pending;
+
+        void set(const Key &key, const Value &value);
+
+        Pending mPending;
+        unsigned long mReceived;
+        unsigned long mCoalesced;
+};
+
+#endif // SYNCBUFFER_H
@@ -0,0 +1,231 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "account-server/transactionlog.h"
+
+#include "utils/logger.h"
+
+#include <fstream>
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static const unsigned INITIAL_CAPACITY = 64;
+
+/*
+ * Each journal record holds the character id, the action, the time and the
+ * message length as little endian integers, followed by the message.
+ */
+static const unsigned RECORD_HEADER_SIZE = 4 + 4 + 8 + 4;
+
+/*
+ * Transaction messages are short texts, so a longer length can only come from
+ * a damaged record. Such records are not written, and end the recovery.
+ */
+static const uint64_t MAX_MESSAGE_LENGTH = 1024 * 1024;
+
+static void writeUint(std::string &buffer, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i)
+        buffer += (char) ((value >> (8 * i)) & 0xff);
+}
+
+static uint64_t readUint(const char *data, int bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i)
+        value |= (uint64_t) (unsigned char) data[i] << (8 * i);
+    return value;
+}
+
+TransactionLog::TransactionLog():
+    mAppended(0),
+    mJournal(0),
+    mSyncPolicy(SYNC_ON_FLUSH),
+    mUnsynced(false)
+{
+    mEntries.reserve(INITIAL_CAPACITY);
+}
+
+TransactionLog::~TransactionLog()
+{
+    closeJournal();
+}
+
+unsigned TransactionLog::openJournal(const std::string &path)
+{
+    closeJournal();
+    mJournalPath = path;
+
+    // Recover the entries left by a previous run. A record cut short by a
+    // crash is dropped, along with anything after a damaged one.
+    unsigned recovered = 0;
+    std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+    if (in.is_open())
+    {
+        char header[RECORD_HEADER_SIZE];
+        while (in.read(header, RECORD_HEADER_SIZE))
+        {
+            Entry entry;
+            entry.transaction.mCharacterId = readUint(header, 4);
+            entry.transaction.mAction = readUint(header + 4, 4);
+            entry.time = (time_t) readUint(header + 8, 8);
+            const uint64_t length = readUint(header + 16, 4);
+            if (length > MAX_MESSAGE_LENGTH)
+                break;
+
+            std::vector<char> message(length);
+            if (length && !in.read(&message[0], length))
+                break;
+            entry.transaction.mMessage.assign(message.begin(), message.end());
+
+            append(entry.transaction, entry.time);
+            ++recovered;
+        }
+        in.close();
+    }
+
+    // Start a clean journal holding the recovered entries. They are written
+    // to a new file first, which then replaces the old journal, so that they
+    // are still in one of them if the server stops meanwhile.
+    if (!mEntries.empty())
+    {
+        const std::string tempPath = path + ".tmp";
+        mJournal = fopen(tempPath.c_str(), "wb");
+        if (!mJournal)
+        {
+            LOG_ERROR("Could not open the transaction journal " << tempPath
+                      << '.');
+            return recovered;
+        }
+
+        for (unsigned i = 0; i < mEntries.size(); ++i)
+            writeToJournal(mEntries[i]);
+        syncJournal(true);
+        fclose(mJournal);
+        mJournal = 0;
+
+#ifdef _WIN32
+        // Windows does not rename over an existing file
+        remove(path.c_str());
+#endif
+        if (rename(tempPath.c_str(), path.c_str()) != 0)
+        {
+            LOG_ERROR("Could not replace the transaction journal " << path
+                      << " with " << tempPath << '.');
+            return recovered;
+        }
+    }
+
+    mJournal = fopen(path.c_str(), mEntries.empty() ? "wb" : "ab");
+    if (!mJournal)
+        LOG_ERROR("Could not open the transaction journal " << path << '.');
+
+    return recovered;
+}
+
+void TransactionLog::closeJournal()
+{
+    if (mJournal)
+    {
+        syncJournal();
+        fclose(mJournal);
+        mJournal = 0;
+    }
+}
+
+void TransactionLog::append(const Transaction &transaction, time_t time)
+{
+    Entry entry;
+    entry.transaction = transaction;
+    entry.time = time;
+    mEntries.push_back(entry);
+    ++mAppended;
+
+    if (mJournal)
+        writeToJournal(entry);
+}
+
+void TransactionLog::clear()
+{
+    mEntries.clear();
+
+    if (mJournal)
+    {
+        mUnsynced = false;
+        mJournal = freopen(mJournalPath.c_str(), "wb", mJournal);
+        if (!mJournal)
+        {
+            LOG_ERROR("Could not reopen the transaction journal "
+                      << mJournalPath << '.');
+        }
+    }
+}
+
+void TransactionLog::writeToJournal(const Entry &entry)
+{
+    const std::string &message = entry.transaction.mMessage;
+    if (message.size() > MAX_MESSAGE_LENGTH)
+    {
+        LOG_ERROR("Transaction message too long for the journal ("
+                  << message.size() << " bytes), not journaled.");
+        return;
+    }
+
+    std::string record;
+    record.reserve(RECORD_HEADER_SIZE + message.size());
+    writeUint(record, entry.transaction.mCharacterId, 4);
+    writeUint(record, entry.transaction.mAction, 4);
+    writeUint(record, (uint64_t) entry.time, 8);
+    writeUint(record, message.size(), 4);
+    record += message;
+
+    // Flushing hands the record to the system, so that it survives a crash
+    // of the server. Surviving a power loss needs a sync as well.
+    if (fwrite(record.data(), 1, record.size(), mJournal) != record.size()
+        || fflush(mJournal) != 0)
+    {
+        LOG_ERROR("Could not write to the transaction journal "
+                  << mJournalPath << '.');
+        return;
+    }
+
+    mUnsynced = true;
+    if (mSyncPolicy == SYNC_ALWAYS)
+        syncJournal();
+}
+
+void TransactionLog::syncJournal(bool force)
+{
+    if (!mJournal || !mUnsynced || (mSyncPolicy == SYNC_NEVER && !force))
+        return;
+
+#ifdef _WIN32
+    _commit(_fileno(mJournal));
+#else
+    fsync(fileno(mJournal));
+#endif
+    mUnsynced = false;
+}
@@ -0,0 +1,129 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRANSACTIONLOG_H
+#define TRANSACTIONLOG_H
+
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+#include <time.h>
+
+#include "common/transaction.h"
+
+/**
+ * Holds the logged transactions until they are written to the database, in
+ * the order they were added.
+ *
+ * Optionally, every entry is also appended to a local binary journal, so
+ * that the entries which were not yet written can be recovered after a
+ * crash. When the records are synced to the disk, so that the journal also
+ * survives a power loss, depends on the SyncPolicy. The journal is emptied
+ * once all its entries are in the database.
+ *
+ * The log only stores entries, the writing itself is done by the Storage.
+ */
+class TransactionLog
+{
+    public:
+        struct Entry
+        {
+            Transaction transaction;
+            time_t time;
+        };
+
+        /**
+         * When the journal records are synced to the disk. Until then, they
+         * only survive a crash of the server.
+         */
+        enum SyncPolicy
+        {
+            SYNC_NEVER = 0,
+            SYNC_ON_FLUSH,  /**< By syncJournal(), once per batch write. */
+            SYNC_ALWAYS     /**< Before append() returns. */
+        };
+
+        TransactionLog();
+
+        ~TransactionLog();
+
+        /**
+         * Opens the journal at the given path and loads the entries it still
+         * contains. Any previous journal is closed first.
+         *
+         * @return the number of recovered entries.
+         */
+        unsigned openJournal(const std::string &path);
+
+        void closeJournal();
+
+        bool hasJournal() const
+        { return mJournal != 0; }
+
+        void setSyncPolicy(SyncPolicy policy)
+        { mSyncPolicy = policy; }
+
+        /**
+         * Syncs the records appended since the last sync to the disk, unless
+         * the policy is SYNC_NEVER and the sync is not forced.
+         */
+        void syncJournal(bool force = false);
+
+        void append(const Transaction &transaction, time_t time);
+
+        /**
+         * Returns the pending entry at the given position, 0 being the
+         * oldest one.
+         */
+        const Entry &at(unsigned index) const
+        { return mEntries[index]; }
+
+        /**
+         * Removes all pending entries, after they have been written, and
+         * empties the journal.
+         */
+        void clear();
+
+        unsigned size() const
+        { return mEntries.size(); }
+
+        bool empty() const
+        { return mEntries.empty(); }
+
+        /**
+         * Number of entries appended since creation.
+         */
+        unsigned long getAppendedCount() const
+        { return mAppended; }
+
+    private:
+        void writeToJournal(const Entry &entry);
+
+        std::vector<Entry> mEntries;
+        unsigned long mAppended;
+
+        std::string mJournalPath;
+        FILE *mJournal;
+        SyncPolicy mSyncPolicy;
+        bool mUnsynced;         /**< Records were written since the sync. */
+};
+
+#endif // TRANSACTIONLOG_H
@@ -19,14 +19,17 @@
  *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cmath>
 #include <map>
 #include <set>
+#include <vector>
 #include <libxml/xmlreader.h>
 
 #include "common/configuration.h"
 
 #include "utils/logger.h"
+#include "utils/thread.h"
 #include "utils/xml.h"
 #include "utils/string.h"
 
@@ -37,6 +40,53 @@ static std::map< std::string, std::string > options;
 /**< Location of config file. */
 static std::string configPath;
 static std::set<std::string> processedFiles;
+/**< Whether the configuration file was read. */
+static bool loaded = false;
+
+/**< Value in use of the options read so far, and whether it is the default. */
+typedef std::map< std::string, std::pair<std::string, bool> > UsedOptions;
+static UsedOptions usedOptions;
+/**< Protects usedOptions, since maps are loaded on several threads. */
+static utils::Mutex usedOptionsMutex;
+/**< Whether options read are recorded, until logUsedOptions() ran. That one
+     does not run along with the map loading threads, so no lock is needed. */
+static bool recordUsedOptions = true;
+
+static std::vector<Configuration::Listener> listeners;
+
+/**
+ * The option handles. A function static, since the handles are static
+ * objects of other files which may be constructed before this one.
+ */
+static std::vector<Configuration::Option*> &optionHandles()
+{
+    static std::vector<Configuration::Option*> handles;
+    return handles;
+}
+
+static const std::string *findOption(const std::string &key)
+{
+    std::map<std::string, std::string>::iterator iter = options.find(key);
+    return iter == options.end() ? 0 : &iter->second;
+}
+
+static void markUsed(const std::string &key, const std::string &value,
+                     bool isDefault)
+{
+    if (!recordUsedOptions)
+        return;
+
+    utils::MutexLocker lock(&usedOptionsMutex);
+    usedOptions[key] = std::make_pair(value, isDefault);
+}
+
+static void updateHandle(Configuration::Option *option)
+{
+    const std::string *value = findOption(option->getKey());
+    option->update(value);
+    if (recordUsedOptions)
+        markUsed(option->getKey(), option->toString(), !value);
+}
 
 static bool readFile(const std::string &fileName)
 {
@@ -92,6 +142,14 @@ bool Configuration::initialize(const std::string &fileName)
         configPath = fileName;
 
     const bool success = readFile(configPath);
+    loaded = true;
+
+    std::vector<Option*> &handles = optionHandles();
+    for (std::vector<Option*>::iterator i = handles.begin(),
+         i_end = handles.end(); i != i_end; ++i)
+    {
+        updateHandle(*i);
+    }
 
     LOG_INFO("Using config file: " << configPath);
 
@@ -103,27 +161,183 @@ void Configuration::deinitialize()
     processedFiles.clear();
 }
 
+bool Configuration::reload()
+{
+    std::map< std::string, std::string > oldOptions;
+    oldOptions.swap(options);
+    processedFiles.clear();
+
+    if (!readFile(configPath))
+    {
+        LOG_ERROR("Could not reload config file: " << configPath);
+        options.swap(oldOptions);
+        return false;
+    }
+
+    // Collect the options that were added, removed or changed
+    std::set<std::string> changed;
+    for (std::map<std::string, std::string>::iterator i = options.begin(),
+         i_end = options.end(); i != i_end; ++i)
+    {
+        std::map<std::string, std::string>::iterator old =
+                oldOptions.find(i->first);
+        if (old == oldOptions.end() || old->second != i->second)
+            changed.insert(i->first);
+    }
+    for (std::map<std::string, std::string>::iterator i = oldOptions.begin(),
+         i_end = oldOptions.end(); i != i_end; ++i)
+    {
+        if (options.find(i->first) == options.end())
+            changed.insert(i->first);
+    }
+
+    std::vector<Option*> &handles = optionHandles();
+    for (std::vector<Option*>::iterator i = handles.begin(),
+         i_end = handles.end(); i != i_end; ++i)
+    {
+        if (changed.find((*i)->getKey()) != changed.end())
+            updateHandle(*i);
+    }
+
+    for (std::set<std::string>::iterator i = changed.begin(),
+         i_end = changed.end(); i != i_end; ++i)
+    {
+        LOG_INFO("Option " << *i << " changed.");
+
+        // Copied, since listeners may remove themselves
+        const std::vector<Listener> current = listeners;
+        for (std::vector<Listener>::const_iterator l = current.begin(),
+             l_end = current.end(); l != l_end; ++l)
+        {
+            (*l)(*i);
+        }
+    }
+
+    LOG_INFO("Reloaded config file: " << configPath << " ("
+             << changed.size() << " options changed)");
+    return true;
+}
+
+void Configuration::logUsedOptions()
+{
+    utils::MutexLocker lock(&usedOptionsMutex);
+    for (UsedOptions::iterator i = usedOptions.begin(),
+         i_end = usedOptions.end(); i != i_end; ++i)
+    {
+        LOG_INFO("Option " << i->first << " = \"" << i->second.first << '"'
+                 << (i->second.second ? " (default)" : ""));
+    }
+
+    usedOptions.clear();
+    recordUsedOptions = false;
+}
+
+void Configuration::addListener(Listener listener)
+{
+    listeners.push_back(listener);
+}
+
+void Configuration::removeListener(Listener listener)
+{
+    listeners.erase(std::remove(listeners.begin(), listeners.end(), listener),
+                    listeners.end());
+}
+
 std::string Configuration::getValue(const std::string &key,
                                     const std::string &deflt)
 {
-    std::map<std::string, std::string>::iterator iter = options.find(key);
-    if (iter == options.end())
-        return deflt;
-    return iter->second;
+    const std::string *value = findOption(key);
+    markUsed(key, value ? *value : deflt, !value);
+    return value ? *value : deflt;
 }
 
 int Configuration::getValue(const std::string &key, int deflt)
 {
-    std::map<std::string, std::string>::iterator iter = options.find(key);
-    if (iter == options.end())
-        return deflt;
-    return atoi(iter->second.c_str());
+    const std::string *value = findOption(key);
+    const int result = value ? atoi(value->c_str()) : deflt;
+    if (recordUsedOptions)
+        markUsed(key, utils::toString(result), !value);
+    return result;
 }
 
 bool Configuration::getBoolValue(const std::string &key, bool deflt)
 {
-    std::map<std::string, std::string>::iterator iter = options.find(key);
-    if (iter == options.end())
-        return deflt;
-    return utils::stringToBool(iter->second.c_str(), deflt);
+    const std::string *value = findOption(key);
+    const bool result = value ? utils::stringToBool(*value, deflt) : deflt;
+    markUsed(key, result ? "true" : "false", !value);
+    return result;
+}
+
+Configuration::Option::Option(const std::string &key):
+    mKey(key)
+{
+    optionHandles().push_back(this);
+}
+
+Configuration::Option::~Option()
+{
+    std::vector<Option*> &handles = optionHandles();
+    handles.erase(std::remove(handles.begin(), handles.end(), this),
+                  handles.end());
+}
+
+void Configuration::Option::initialize()
+{
+    if (loaded)
+        updateHandle(this);
+}
+
+Configuration::IntOption::IntOption(const std::string &key, int deflt):
+    Option(key),
+    mDefault(deflt),
+    mValue(deflt)
+{
+    initialize();
+}
+
+void Configuration::IntOption::update(const std::string *value)
+{
+    mValue = value ? atoi(value->c_str()) : mDefault;
+}
+
+std::string Configuration::IntOption::toString() const
+{
+    return utils::toString(mValue);
+}
+
+Configuration::BoolOption::BoolOption(const std::string &key, bool deflt):
+    Option(key),
+    mDefault(deflt),
+    mValue(deflt)
+{
+    initialize();
+}
+
+void Configuration::BoolOption::update(const std::string *value)
+{
+    mValue = value ? utils::stringToBool(*value, mDefault) : mDefault;
+}
+
+std::string Configuration::BoolOption::toString() const
+{
+    return mValue ? "true" : "false";
+}
+
+Configuration::StringOption::StringOption(const std::string &key,
+                                          const std::string &deflt):
+    Option(key),
+    mDefault(deflt),
+    mValue(deflt)
+{
+    initialize();
+}
+
+void Configuration::StringOption::update(const std::string *value)
+{
+    mValue = value ? *value : mDefault;
+}
+
+std::string Configuration::StringOption::toString() const
+{
+    return mValue;
 }
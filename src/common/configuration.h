@@ -57,6 +57,119 @@ namespace Configuration
      * @param deflt default value.
      */
     bool getBoolValue(const std::string &key, bool deflt);
+
+    /**
+     * Reads the configuration file again. The option handles are updated and
+     * the listeners are told about every option whose value changed. Options
+     * that were only read at startup keep their effect until a restart.
+     *
+     * @return whether the configuration file could be read
+     */
+    bool reload();
+
+    /**
+     * Logs every option that was read so far, with the value in use. The
+     * options read afterwards are no longer recorded.
+     */
+    void logUsedOptions();
+
+    /**
+     * Called with the name of an option after a reload changed its value.
+     */
+    typedef void (*Listener)(const std::string &key);
+
+    void addListener(Listener listener);
+
+    void removeListener(Listener listener);
+
+    /**
+     * A handle to an option, which caches its converted value. Handles look
+     * up their option once when the configuration is loaded and are updated
+     * on reload, so that code running every tick can read an option without
+     * a lookup. They are meant to be static objects.
+     */
+    class Option
+    {
+        public:
+            const std::string &getKey() const
+            { return mKey; }
+
+            /**
+             * Sets the value from the configuration, or back to the default
+             * value when the option is not set.
+             */
+            virtual void update(const std::string *value) = 0;
+
+            /**
+             * Returns the value in use, for logging.
+             */
+            virtual std::string toString() const = 0;
+
+        protected:
+            Option(const std::string &key);
+
+            virtual ~Option();
+
+            /**
+             * Reads the option when the configuration was already loaded.
+             * To be called by the constructor of the subclasses.
+             */
+            void initialize();
+
+        private:
+            Option(const Option &);
+            Option &operator=(const Option &);
+
+            std::string mKey;
+    };
+
+    class IntOption : public Option
+    {
+        public:
+            IntOption(const std::string &key, int deflt);
+
+            operator int() const
+            { return mValue; }
+
+            void update(const std::string *value);
+            std::string toString() const;
+
+        private:
+            int mDefault;
+            int mValue;
+    };
+
+    class BoolOption : public Option
+    {
+        public:
+            BoolOption(const std::string &key, bool deflt);
+
+            operator bool() const
+            { return mValue; }
+
+            void update(const std::string *value);
+            std::string toString() const;
+
+        private:
+            bool mDefault;
+            bool mValue;
+    };
+
+    class StringOption : public Option
+    {
+        public:
+            StringOption(const std::string &key, const std::string &deflt);
+
+            operator const std::string &() const
+            { return mValue; }
+
+            void update(const std::string *value);
+            std::string toString() const;
+
+        private:
+            std::string mDefault;
+            std::string mValue;
+    };
 }
 
 #ifndef DEFAULT_SERVER_PORT
@@ -51,10 +51,9 @@ void PermissionManager::initialize(const std::string & file)
 
 void PermissionManager::reload()
 {
-    XML::Document doc(permissionFile);
-    xmlNodePtr rootNode = doc.rootNode();
+    XML::Reader reader(permissionFile);
 
-    if (!rootNode || !xmlStrEqual(rootNode->name, BAD_CAST "permissions"))
+    if (!xmlStrEqual(reader.rootName(), BAD_CAST "permissions"))
     {
         LOG_ERROR("Permission Manager: " << permissionFile
                   << " is not a valid database file!");
@@ -62,7 +61,7 @@ void PermissionManager::reload()
     }
 
     LOG_INFO("Loading permission reference...");
-    for_each_xml_child_node(node, rootNode)
+    while (xmlNodePtr node = reader.nextChild())
     {
         unsigned char classmask = 0x01;
         if (!xmlStrEqual(node->name, BAD_CAST "class"))
@@ -25,6 +25,7 @@
 #include "utils/logger.h"
 
 #include <sys/stat.h>
+#include <cerrno>
 #include <cstdlib>
 #include <cstring>
 
@@ -72,6 +73,25 @@ bool ResourceManager::exists(const std::string &path, bool lookInSearchPath)
     return PHYSFS_exists(path.c_str());
 }
 
+bool ResourceManager::createDirectory(const std::string &path)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) == 0)
+        return (info.st_mode & S_IFDIR) != 0;
+
+#ifdef _WIN32
+    if (_mkdir(path.c_str()) == 0)
+        return true;
+#else
+    if (mkdir(path.c_str(), 0755) == 0)
+        return true;
+#endif
+
+    // Another thread may have created it in the meantime
+    return errno == EEXIST && stat(path.c_str(), &info) == 0 &&
+           (info.st_mode & S_IFDIR) != 0;
+}
+
 std::string ResourceManager::resolve(const std::string &path)
 {
     const char *realDir = PHYSFS_getRealDir(path.c_str());
@@ -42,6 +42,14 @@ namespace ResourceManager
      */
     bool exists(const std::string &path, bool lookInSearchPath = true);
 
+    /**
+     * Creates a directory on the real file system, unless it already exists.
+     * Its parent directory has to exist.
+     *
+     * @return whether the directory exists now.
+     */
+    bool createDirectory(const std::string &path);
+
     /**
      * Returns the real file-system path of the resource with the given
      * resource path, or an empty string when no such resource exists.
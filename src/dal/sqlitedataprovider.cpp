@@ -24,6 +24,7 @@
 
 #include "common/configuration.h"
 #include "utils/logger.h"
+#include "utils/string.h"
 
 #include <stdexcept>
 #include <limits.h>
@@ -39,6 +40,10 @@ namespace dal
 
 const std::string SqLiteDataProvider::CFGPARAM_SQLITE_DB     = "sqlite_database";
 const std::string SqLiteDataProvider::CFGPARAM_SQLITE_DB_DEF = "mana.db";
+const std::string SqLiteDataProvider::CFGPARAM_SQLITE_SYNCHRONOUS
+                                                        = "sqlite_synchronous";
+const std::string SqLiteDataProvider::CFGPARAM_SQLITE_JOURNAL_MODE
+                                                        = "sqlite_journalMode";
 
 SqLiteDataProvider::SqLiteDataProvider()
     throw()
@@ -107,6 +112,20 @@ void SqLiteDataProvider::connect()
     // transaction failures due to locked databases are very rare.
     sqlite3_busy_timeout(mDb, 1000);
 
+    // Durability settings, the SQLite defaults are kept when they are not set.
+    // E.g. journal mode WAL with synchronous NORMAL survives process crashes
+    // and only risks the last transactions on power loss.
+    static const char *const journalModes[] = {
+        "DELETE", "TRUNCATE", "PERSIST", "MEMORY", "WAL", "OFF", 0
+    };
+    static const char *const synchronousModes[] = {
+        "OFF", "NORMAL", "FULL", "EXTRA", "0", "1", "2", "3", 0
+    };
+    setPragmaFromConfig("journal_mode", CFGPARAM_SQLITE_JOURNAL_MODE,
+                        journalModes);
+    setPragmaFromConfig("synchronous", CFGPARAM_SQLITE_SYNCHRONOUS,
+                        synchronousModes);
+
     // Save the Db Name.
     mDbName = dbName;
 
@@ -114,6 +133,40 @@ void SqLiteDataProvider::connect()
     LOG_INFO("Connection to database successful.");
 }
 
+void SqLiteDataProvider::setPragmaFromConfig(const std::string &pragma,
+                                             const std::string &cfgParam,
+                                             const char *const *validValues)
+{
+    const std::string value = utils::toUpper(
+                Configuration::getValue(cfgParam, std::string()));
+    if (value.empty())
+        return;
+
+    // The value is pasted into the statement, so only known keywords pass
+    const char *const *valid = validValues;
+    while (*valid && value != *valid)
+        ++valid;
+    if (!*valid)
+    {
+        LOG_ERROR("Invalid SQLite " << pragma << " '" << value
+                  << "' in option " << cfgParam << ", ignored.");
+        return;
+    }
+
+    const std::string sql = "PRAGMA " + pragma + " = " + value + ";";
+    char *errMsg = 0;
+    if (sqlite3_exec(mDb, sql.c_str(), 0, 0, &errMsg) != SQLITE_OK)
+    {
+        LOG_WARN("Unable to set SQLite " << pragma << " to '" << value
+                 << "': " << (errMsg ? errMsg : "unknown error"));
+    }
+    else
+    {
+        LOG_INFO("SQLite " << pragma << " set to '" << value << "'.");
+    }
+    sqlite3_free(errMsg);
+}
+
 /**
  * Execute a SQL query.
  */
@@ -156,6 +156,20 @@ class SqLiteDataProvider: public DataProvider
         static const std::string CFGPARAM_SQLITE_DB;
         /** defines the default value of the CFGPARAM_SQLITE_DB parameter */
         static const std::string CFGPARAM_SQLITE_DB_DEF;
+        /** defines the name of the synchronous mode config parameter */
+        static const std::string CFGPARAM_SQLITE_SYNCHRONOUS;
+        /** defines the name of the journal mode config parameter */
+        static const std::string CFGPARAM_SQLITE_JOURNAL_MODE;
+
+        /**
+         * Sets a pragma to the value found in the configuration, if any.
+         *
+         * @param validValues the accepted values in upper case, terminated
+         *                    by a null pointer.
+         */
+        void setPragmaFromConfig(const std::string &pragma,
+                                 const std::string &cfgParam,
+                                 const char *const *validValues);
 
         sqlite3 *mDb; /**< the handle to the database connection */
         sqlite3_stmt *mStmt; /**< the prepared statement to process */
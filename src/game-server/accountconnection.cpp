@@ -105,6 +105,69 @@ bool AccountConnection::start(int gameServerPort)
     return true;
 }
 
+void AccountConnection::activatePendingMaps()
+{
+    if (mPendingMaps.empty())
+        return;
+
+    std::vector< int > mapIds;
+    for (std::vector< PendingMap >::const_iterator i = mPendingMaps.begin(),
+         i_end = mPendingMaps.end(); i != i_end; ++i)
+    {
+        mapIds.push_back(i->id);
+    }
+    MapManager::preloadMaps(mapIds);
+
+    for (std::vector< PendingMap >::const_iterator i = mPendingMaps.begin(),
+         i_end = mPendingMaps.end(); i != i_end; ++i)
+    {
+        activateMap(*i);
+    }
+    mPendingMaps.clear();
+}
+
+void AccountConnection::activateMap(const PendingMap &pending)
+{
+    const int mapId = pending.id;
+    if (!MapManager::activateMap(mapId))
+        return;
+
+    // Set map variables
+    MapComposite *m = MapManager::getMap(mapId);
+    for (std::vector< std::pair< std::string, std::string > >::const_iterator
+         i = pending.variables.begin(), i_end = pending.variables.end();
+         i != i_end; ++i)
+    {
+        m->setVariableFromDbserver(i->first, i->second);
+    }
+
+    // Recreate potential persistent floor items
+    LOG_DEBUG("Recreate persistant items on map " << mapId);
+    for (std::vector< PendingMap::FloorItem >::const_iterator
+         i = pending.floorItems.begin(), i_end = pending.floorItems.end();
+         i != i_end; ++i)
+    {
+        if (ItemClass *ic = itemManager->getItem(i->itemId))
+        {
+            Item *item = new Item(ic, i->amount);
+            item->setMap(m);
+            Point dst(i->x, i->y);
+            item->setPosition(dst);
+
+            // Do not wake up the map for its floor items
+            if (m->isHibernating())
+                m->insertHibernating(item);
+            else if (!GameState::insertOrDelete(item))
+            {
+                // The map is full.
+                LOG_WARN("Couldn't add floor item(s) " << i->itemId
+                         << " into map " << mapId);
+                return;
+            }
+        }
+    }
+}
+
 void AccountConnection::sendCharacterData(Character *p)
 {
     MessageOut msg(GAMSG_PLAYER_DATA);
@@ -163,48 +226,32 @@ void AccountConnection::processMessage(MessageIn &msg)
 
         case AGMSG_ACTIVE_MAP:
         {
-            int mapId = msg.readInt16();
-            if (MapManager::activateMap(mapId))
-            {
-                // Set map variables
-                MapComposite *m = MapManager::getMap(mapId);
-                int mapVarsNumber = msg.readInt16();
-                for(int i = 0; i < mapVarsNumber; ++i)
-                {
-                    std::string key = msg.readString();
-                    std::string value = msg.readString();
-                    if (!key.empty() && !value.empty())
-                        m->setVariableFromDbserver(key, value);
-                }
+            // The map is activated along with the others assigned with it,
+            // so that their files are read together.
+            PendingMap pending;
+            pending.id = msg.readInt16();
 
-                // Recreate potential persistent floor items
-                LOG_DEBUG("Recreate persistant items on map " << mapId);
-                int floorItemsNumber = msg.readInt16();
+            int mapVarsNumber = msg.readInt16();
+            for (int i = 0; i < mapVarsNumber; ++i)
+            {
+                std::string key = msg.readString();
+                std::string value = msg.readString();
+                if (!key.empty() && !value.empty())
+                    pending.variables.push_back(std::make_pair(key, value));
+            }
 
-                for (int i = 0; i < floorItemsNumber; ++i)
-                {
-                    int itemId = msg.readInt32();
-                    int amount = msg.readInt16();
-                    int posX = msg.readInt16();
-                    int posY = msg.readInt16();
-
-                    if (ItemClass *ic = itemManager->getItem(itemId))
-                    {
-                        Item *item = new Item(ic, amount);
-                        item->setMap(m);
-                        Point dst(posX, posY);
-                        item->setPosition(dst);
-
-                        if (!GameState::insertOrDelete(item))
-                        {
-                            // The map is full.
-                            LOG_WARN("Couldn't add floor item(s) " << itemId
-                                << " into map " << mapId);
-                            return;
-                        }
-                    }
-                }
+            int floorItemsNumber = msg.readInt16();
+            for (int i = 0; i < floorItemsNumber; ++i)
+            {
+                PendingMap::FloorItem item;
+                item.itemId = msg.readInt32();
+                item.amount = msg.readInt16();
+                item.x = msg.readInt16();
+                item.y = msg.readInt16();
+                pending.floorItems.push_back(item);
             }
+
+            mPendingMaps.push_back(pending);
         } break;
 
         case AGMSG_SET_VAR_WORLD:
@@ -24,6 +24,10 @@
 #include "net/messageout.h"
 #include "net/connection.h"
 
+#include <string>
+#include <utility>
+#include <vector>
+
 class Character;
 class MapComposite;
 
@@ -179,6 +183,13 @@ class AccountConnection : public Connection
          */
         void sendTransaction(int id, int action, const std::string &message);
 
+        /**
+         * Activates the maps assigned by the messages processed so far. The
+         * maps assigned together are read together, see
+         * MapManager::preloadMaps().
+         */
+        void activatePendingMaps();
+
     protected:
         /**
          * Processes server messages.
@@ -186,8 +197,28 @@ class AccountConnection : public Connection
         virtual void processMessage(MessageIn &);
 
     private:
+        /**
+         * A map assigned by the account server, with its variables and
+         * persistent floor items, waiting for activatePendingMaps().
+         */
+        struct PendingMap
+        {
+            struct FloorItem
+            {
+                int itemId, amount;
+                int x, y;
+            };
+
+            int id;
+            std::vector< std::pair< std::string, std::string > > variables;
+            std::vector< FloorItem > floorItems;
+        };
+
+        void activateMap(const PendingMap &);
+
         MessageOut* mSyncBuffer;     /**< Message buffer to store sync data. */
         int mSyncMessages;           /**< Number of messages in the sync buffer. */
+        std::vector< PendingMap > mPendingMaps;
 };
 
 extern AccountConnection *accountHandler;
@@ -64,7 +64,7 @@ class Actor : public Entity
          *
          * @param p the coordinates.
          */
-        void setPosition(const Point &p);
+        virtual void setPosition(const Point &p);
 
         /**
          * Gets the coordinates.
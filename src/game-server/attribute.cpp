@@ -21,7 +21,9 @@
 #include "attribute.h"
 #include "game-server/being.h"
 #include "utils/logger.h"
+#include <algorithm>
 #include <cassert>
+#include <stdexcept>
 
 AttributeModifiersEffect::AttributeModifiersEffect(StackableType stackableType,
                                                    ModifierEffectType effectType) :
@@ -40,14 +42,7 @@ AttributeModifiersEffect::AttributeModifiersEffect(StackableType stackableType,
               << " and stackableType " << stackableType << ".");
 }
 
-AttributeModifiersEffect::~AttributeModifiersEffect()
-{
-    // ?
-    /*mStates.clear();*/
-    LOG_WARN("DELETION of attribute effect!");
-}
-
-bool AttributeModifiersEffect::add(unsigned short duration,
+bool AttributeModifiersEffect::add(int expiry,
                                    double value,
                                    double prevLayerValue,
                                    int level)
@@ -56,7 +51,7 @@ bool AttributeModifiersEffect::add(unsigned short duration,
               " with a previous layer value of " << prevLayerValue << ". "
               "Current mod at this layer: " << mMod << ".");
     bool ret = false;
-    mStates.push_back(new AttributeModifierState(duration, value, level));
+    mStates.push_back(AttributeModifierState(expiry, value, level));
     switch (mStackableType) {
     case Stackable:
         switch (mEffectType) {
@@ -127,10 +122,10 @@ bool AttributeModifiersEffect::add(unsigned short duration,
     return ret;
 }
 
-bool durationCompare(const AttributeModifierState *lhs,
-                     const AttributeModifierState *rhs)
+bool expiryCompare(const AttributeModifierState &lhs,
+                   const AttributeModifierState &rhs)
 {
-    return lhs->mDuration < rhs->mDuration;
+    return lhs.mExpiry < rhs.mExpiry;
 }
 
 bool AttributeModifiersEffect::remove(double value, unsigned int id,
@@ -138,22 +133,21 @@ bool AttributeModifiersEffect::remove(double value, unsigned int id,
 {
     /* We need to find and check this entry exists, and erase the entry
        from the list too. */
-    if (!fullCheck)
-        mStates.sort(durationCompare); /* Search only through those with a duration of 0. */
+    if (!fullCheck) /* Search only through those without an expiry. */
+        std::stable_sort(mStates.begin(), mStates.end(), expiryCompare);
     bool ret = false;
 
-    for (std::list< AttributeModifierState * >::iterator it = mStates.begin();
-         it != mStates.end() && (fullCheck || !(*it)->mDuration);)
+    for (std::vector<AttributeModifierState>::iterator it = mStates.begin();
+         it != mStates.end() && (fullCheck || !it->mExpiry);)
     {
         /* Check for a match */
-        if ((*it)->mValue != value || (*it)->mId != id)
+        if (it->mValue != value || it->mId != id)
         {
             ++it;
             continue;
         }
 
-        delete *it;
-        mStates.erase(it++);
+        it = mStates.erase(it);
 
         /* If this is stackable, we need to update for every modifier affected */
         if (mStackableType == Stackable)
@@ -188,12 +182,12 @@ void AttributeModifiersEffect::updateMod(double value)
             else
             {
                 mMod = 1;
-                for (std::list< AttributeModifierState * >::const_iterator
+                for (std::vector<AttributeModifierState>::const_iterator
                      it = mStates.begin(),
                      it_end = mStates.end();
                     it != it_end;
                     ++it)
-                    mMod *= (*it)->mValue;
+                    mMod *= it->mValue;
             }
         }
         else LOG_ERROR("Attribute modifiers effect: unhandled type '"
@@ -204,13 +198,13 @@ void AttributeModifiersEffect::updateMod(double value)
         if (mMod == value)
         {
             mMod = 0;
-            for (std::list< AttributeModifierState * >::const_iterator
+            for (std::vector<AttributeModifierState>::const_iterator
                  it = mStates.begin(),
                  it_end = mStates.end();
                 it != it_end;
                 ++it)
-                if ((*it)->mValue > mMod)
-                    mMod = (*it)->mValue;
+                if (it->mValue > mMod)
+                    mMod = it->mValue;
         }
     }
     else
@@ -248,27 +242,28 @@ bool AttributeModifiersEffect::recalculateModifiedValue(double newPrevLayerValue
 }
 
 
-bool Attribute::add(unsigned short duration, double value,
+bool Attribute::add(int expiry, double value,
                     unsigned int layer, int level)
 {
     assert(mMods.size() > layer);
-    LOG_DEBUG("Adding modifier to attribute with duration " << duration <<
+    LOG_DEBUG("Adding modifier to attribute expiring at tick " << expiry <<
               ", value " << value << ", at layer " << layer << " with id "
               << level);
-    if (mMods.at(layer)->add(duration, value,
-                            (layer ? mMods.at(layer - 1)->getCachedModifiedValue()
+    if (mMods.at(layer).add(expiry, value,
+                            (layer ? mMods.at(layer - 1).getCachedModifiedValue()
                                    : mBase)
                             , level))
     {
         while (++layer < mMods.size())
         {
-            if (!mMods.at(layer)->recalculateModifiedValue(
-                       mMods.at(layer - 1)->getCachedModifiedValue()))
+            if (!mMods.at(layer).recalculateModifiedValue(
+                       mMods.at(layer - 1).getCachedModifiedValue()))
             {
                 LOG_DEBUG("Modifier added, but modified value not changed.");
                 return false;
             }
         }
+        updateModifiedValue();
         LOG_DEBUG("Modifier added. Base value: " << mBase << ", new modified "
                   "value: " << getModifiedAttribute() << ".");
         return true;
@@ -281,39 +276,43 @@ bool Attribute::remove(double value, unsigned int layer,
                        int lvl, bool fullcheck)
 {
     assert(mMods.size() > layer);
-    if (mMods.at(layer)->remove(value, lvl, fullcheck))
+    if (mMods.at(layer).remove(value, lvl, fullcheck))
     {
         while (++layer < mMods.size())
-           if (!mMods.at(layer)->recalculateModifiedValue(
-                         mMods.at(layer - 1)->getCachedModifiedValue()))
+           if (!mMods.at(layer).recalculateModifiedValue(
+                         mMods.at(layer - 1).getCachedModifiedValue()))
                return false;
+        updateModifiedValue();
         return true;
     }
     return false;
 }
 
-bool AttributeModifiersEffect::tick()
+bool AttributeModifiersEffect::expire(int tick)
 {
     bool ret = false;
-    std::list<AttributeModifierState *>::iterator it = mStates.begin();
+    std::vector<AttributeModifierState>::iterator it = mStates.begin();
     while (it != mStates.end())
     {
-        if ((*it)->tick())
+        if (it->hasExpired(tick))
         {
-            double value = (*it)->mValue;
+            double value = it->mValue;
             LOG_DEBUG("Modifier of value " << value << " expiring!");
-            delete *it;
-            mStates.erase(it++);
+            it = mStates.erase(it);
             updateMod(value);
             ret = true;
         }
-        ++it;
+        else
+        {
+            ++it;
+        }
     }
     return ret;
 }
 
 Attribute::Attribute(const AttributeManager::AttributeInfo &info):
     mBase(0),
+    mModified(0),
     mMinValue(info.minimum),
     mMaxValue(info.maximum)
 {
@@ -325,48 +324,38 @@ Attribute::Attribute(const AttributeManager::AttributeInfo &info):
         LOG_DEBUG("Adding layer with stackable type "
                   << modifiers[i].stackableType
                   << " and effect type " << modifiers[i].effectType << ".");
-        mMods.push_back(new AttributeModifiersEffect(modifiers[i].stackableType,
-                                                     modifiers[i].effectType));
+        mMods.push_back(AttributeModifiersEffect(modifiers[i].stackableType,
+                                                 modifiers[i].effectType));
         LOG_DEBUG("Layer added.");
     }
     mBase = checkBounds(mBase);
+    updateModifiedValue();
 }
 
-Attribute::~Attribute()
+bool Attribute::expire(unsigned int layer, int tick)
 {
-//    for (std::vector<AttributeModifiersEffect *>::iterator it = mMods.begin(),
-//         it_end = mMods.end(); it != it_end; ++it)
-//    {
-        // ?
-        //delete *it;
-//    }
-}
+    assert(mMods.size() > layer);
+    if (!mMods[layer].expire(tick))
+        return false;
 
-bool Attribute::tick()
-{
-    bool ret = false;
-    double prev = mBase;
-    for (std::vector<AttributeModifiersEffect *>::iterator it = mMods.begin(),
-        it_end = mMods.end(); it != it_end; ++it)
+    LOG_DEBUG("Attribute layer " << layer << " has expiring modifiers.");
+    double prev = layer ? mMods[layer - 1].getCachedModifiedValue() : mBase;
+    for (; layer < mMods.size(); ++layer)
     {
-        if ((*it)->tick())
-        {
-            LOG_DEBUG("Attribute layer " << mMods.begin() - it
-                      << " has expiring modifiers.");
-            ret = true;
-        }
-        if (ret)
-            if (!(*it)->recalculateModifiedValue(prev)) ret = false;
-        prev = (*it)->getCachedModifiedValue();
+        if (!mMods[layer].recalculateModifiedValue(prev))
+            return false;
+        prev = mMods[layer].getCachedModifiedValue();
     }
-    return ret;
+    updateModifiedValue();
+    return true;
 }
 
 void Attribute::clearMods()
 {
-    for (std::vector<AttributeModifiersEffect *>::iterator it = mMods.begin(),
+    for (std::vector<AttributeModifiersEffect>::iterator it = mMods.begin(),
          it_end = mMods.end(); it != it_end; ++it)
-        (*it)->clearMods(mBase);
+        it->clearMods(mBase);
+    updateModifiedValue();
 }
 
 void Attribute::setBase(double base)
@@ -375,14 +364,15 @@ void Attribute::setBase(double base)
     LOG_DEBUG("Setting base attribute from " << mBase << " to " << base << ".");
     double prev = mBase = base;
 
-    std::vector<AttributeModifiersEffect *>::iterator it = mMods.begin();
+    std::vector<AttributeModifiersEffect>::iterator it = mMods.begin();
     while (it != mMods.end())
     {
-        if ((*it)->recalculateModifiedValue(prev))
-            prev = (*it++)->getCachedModifiedValue();
+        if (it->recalculateModifiedValue(prev))
+            prev = (it++)->getCachedModifiedValue();
         else
             break;
     }
+    updateModifiedValue();
 }
 
 void AttributeModifiersEffect::clearMods(double baseValue)
@@ -401,3 +391,47 @@ double Attribute::checkBounds(double baseValue)
         baseValue = mMinValue;
     return baseValue;
 }
+
+std::pair<AttributeMap::iterator, bool> AttributeMap::insert(
+        const value_type &value)
+{
+    iterator it = find(value.first);
+    if (it != end())
+        return std::make_pair(it, false);
+
+    const int index = attributeManager->getAttributeIndex(value.first);
+    if (index < 0)
+    {
+        LOG_ERROR("AttributeMap: attribute " << value.first
+                  << " is not known to the attribute manager!");
+        return std::make_pair(end(), false);
+    }
+
+    it = begin();
+    while (it != end() && it->first < value.first)
+        ++it;
+    it = mAttributes.insert(it, value);
+
+    // The positions of the attributes after the new one have moved
+    mPositions.resize(attributeManager->getAttributeCount(), -1);
+    for (unsigned int i = it - begin(); i < mAttributes.size(); ++i)
+        mPositions[attributeManager->getAttributeIndex(mAttributes[i].first)] = i;
+
+    return std::make_pair(it, true);
+}
+
+Attribute &AttributeMap::at(unsigned int id)
+{
+    const int position = getPosition(id);
+    if (position < 0)
+        throw std::out_of_range("AttributeMap::at");
+    return mAttributes[position].second;
+}
+
+const Attribute &AttributeMap::at(unsigned int id) const
+{
+    const int position = getPosition(id);
+    if (position < 0)
+        throw std::out_of_range("AttributeMap::at");
+    return mAttributes[position].second;
+}
@@ -24,33 +24,34 @@
 #include "common/defines.h"
 #include "attributemanager.h"
 #include <vector>
-#include <list>
 
 class AttributeModifierState
 {
     public:
-        AttributeModifierState(unsigned short duration,
+        AttributeModifierState(int expiry,
                                double value,
                                unsigned int id)
-            : mDuration(duration)
+            : mExpiry(expiry)
             , mValue(value)
             , mId(id)
         {}
 
-        bool tick() { return mDuration ? !--mDuration : false; }
+        bool hasExpired(int tick) const
+        { return mExpiry && mExpiry <= tick; }
 
     private:
-        /** Number of ticks (0 means permanent, e.g. equipment). */
-        unsigned short mDuration;
-        const double mValue;   /**< Positive or negative amount. */
+        /** Tick at which the modifier expires (0 means permanent, e.g.
+            equipment). */
+        int mExpiry;
+        double mValue;   /**< Positive or negative amount. */
         /**
          * Special purpose variable used to identify this effect to
          * dispells or similar. Exact usage depends on the effect,
          * origin, etc.
          */
-        const unsigned int mId;
-        friend bool durationCompare(const AttributeModifierState*,
-                                    const AttributeModifierState*);
+        unsigned int mId;
+        friend bool expiryCompare(const AttributeModifierState &,
+                                  const AttributeModifierState &);
         friend class AttributeModifiersEffect;
 };
 
@@ -59,7 +60,6 @@ class AttributeModifiersEffect
     public:
         AttributeModifiersEffect(StackableType stackableType,
                                  ModifierEffectType effectType);
-        ~AttributeModifiersEffect();
 
         /**
          * Recalculates the value for this level.
@@ -69,7 +69,7 @@ class AttributeModifiersEffect
          * If this returns true, the cached values for *all* modifiers of a
          *     higher level must be recalculated, as well as the final
          */
-        bool add(unsigned short duration, double value,
+        bool add(int expiry, double value,
                  double prevLayerValue, int level);
 
         /**
@@ -98,7 +98,11 @@ class AttributeModifiersEffect
 
         double getCachedModifiedValue() const { return mCacheVal; }
 
-        bool tick();
+        /**
+         * Removes the modifiers that expired by the given tick.
+         * @returns Whether any modifier was removed.
+         */
+        bool expire(int tick);
 
         /**
          * clearMods() - removes all modifications present in this layer.
@@ -110,7 +114,7 @@ class AttributeModifiersEffect
 
     private:
         /** List of all modifications present at this level */
-        std::list<AttributeModifierState *> mStates;
+        std::vector<AttributeModifierState> mStates;
         /**
          * Stores the value that results from mStates. This takes into
          * account all previous layers.
@@ -121,8 +125,8 @@ class AttributeModifiersEffect
          * 0 for additive modifiers and 1 for multiplicative modifiers.
          */
         double mMod;
-        const StackableType mStackableType;
-        const ModifierEffectType mEffectType;
+        StackableType mStackableType;
+        ModifierEffectType mEffectType;
 };
 
 /**
@@ -136,14 +140,11 @@ class Attribute
 
         Attribute(const AttributeManager::AttributeInfo &info);
 
-        ~Attribute();
-
         void setBase(double base);
         double getBase() const { return mBase; }
 
         double getModifiedAttribute() const
-        { return mMods.empty() ? mBase :
-                                 (*mMods.rbegin())->getCachedModifiedValue(); }
+        { return mModified; }
 
         /*
          * add() and remove() are the standard functions used to add and
@@ -151,16 +152,16 @@ class Attribute
          */
 
         /**
-         * @param duration The amount of time before the modifier expires
-         *        naturally.
-         *        When set to 0, the effect does not expire.
+         * @param expiry The tick at which the modifier expires naturally.
+         *        When set to 0, the effect does not expire. The owner of the
+         *        attribute is responsible for calling expire() at that tick.
          * @param value The value to be applied as the modifier.
          * @param layer The id of the layer with which this modifier is to be
          *        applied to.
          * @param id Used to identify this effect.
          * @return Whether the modified attribute value was changed.
          */
-        bool add(unsigned short duration, double value, unsigned int layer, int id = 0);
+        bool add(int expiry, double value, unsigned int layer, int id = 0);
 
         /**
          * @param value The value of the modifier to be removed.
@@ -182,9 +183,11 @@ class Attribute
         void clearMods();
 
         /**
-         * tick() processes all timers associated with modifiers for this attribute.
+         * Removes the modifiers of the given layer that expired by the given
+         * tick.
+         * @returns Whether the modified attribute value was changed.
          */
-        bool tick();
+        bool expire(unsigned int layer, int tick);
 
     private:
         /**
@@ -193,10 +196,83 @@ class Attribute
          */
         double checkBounds(double baseValue);
 
+        /**
+         * Updates the cached modified value after the value of the last
+         * layer changed.
+         */
+        void updateModifiedValue()
+        { mModified = mMods.empty() ? mBase :
+                                      mMods.back().getCachedModifiedValue(); }
+
         double mBase; // The attribute base value
+        double mModified; // The value with all modifiers applied
         double mMinValue; // The min authorized base and derived attribute value
         double mMaxValue; // The max authorized base and derived attribute value
-        std::vector<AttributeModifiersEffect *> mMods;
+        std::vector<AttributeModifiersEffect> mMods;
+};
+
+/**
+ * The attributes of a being, sorted by id. Looking up an attribute goes
+ * through the index assigned to its id by the attribute manager, so that
+ * the frequent accesses to attributes do not need to search for them.
+ *
+ * The interface follows the one of std::map, which was used before.
+ */
+class AttributeMap
+{
+    public:
+        typedef std::pair<unsigned int, Attribute> value_type;
+        typedef std::vector<value_type>::iterator iterator;
+        typedef std::vector<value_type>::const_iterator const_iterator;
+
+        iterator begin() { return mAttributes.begin(); }
+        iterator end() { return mAttributes.end(); }
+        const_iterator begin() const { return mAttributes.begin(); }
+        const_iterator end() const { return mAttributes.end(); }
+
+        size_t size() const { return mAttributes.size(); }
+        bool empty() const { return mAttributes.empty(); }
+
+        /**
+         * Adds an attribute, unless one with the same id is already present.
+         * @returns The attribute with the id and whether it was added.
+         */
+        std::pair<iterator, bool> insert(const value_type &value);
+
+        iterator find(unsigned int id)
+        {
+            const int position = getPosition(id);
+            return position < 0 ? end() : begin() + position;
+        }
+
+        const_iterator find(unsigned int id) const
+        {
+            const int position = getPosition(id);
+            return position < 0 ? end() : begin() + position;
+        }
+
+        size_t count(unsigned int id) const
+        { return getPosition(id) < 0 ? 0 : 1; }
+
+        /**
+         * Returns the attribute with the given id.
+         * @throws std::out_of_range when the attribute is not present.
+         */
+        Attribute &at(unsigned int id);
+        const Attribute &at(unsigned int id) const;
+
+    private:
+        int getPosition(unsigned int id) const
+        {
+            const int index = attributeManager->getAttributeIndex(id);
+            return index < 0 || index >= (int) mPositions.size() ?
+                        -1 : mPositions[index];
+        }
+
+        std::vector<value_type> mAttributes;
+
+        /** Position in mAttributes by attribute index, -1 when absent. */
+        std::vector<int> mPositions;
 };
 
 #endif // ATTRIBUTE_H
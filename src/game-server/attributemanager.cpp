@@ -38,6 +38,16 @@ void AttributeManager::reload()
 
     readAttributesFile();
 
+    mAttributeIndices.clear();
+    if (!mAttributeMap.empty())
+        mAttributeIndices.resize(mAttributeMap.rbegin()->first + 1, -1);
+    int index = 0;
+    for (AttributeMap::const_iterator i = mAttributeMap.begin(),
+         i_end = mAttributeMap.end(); i != i_end; ++i)
+    {
+        mAttributeIndices[i->first] = index++;
+    }
+
     LOG_DEBUG("attribute map:");
     LOG_DEBUG("Stackable is " << Stackable << ", NonStackable is " << NonStackable
               << ", NonStackableBonus is " << NonStackableBonus << ".");
@@ -114,10 +124,9 @@ const std::string *AttributeManager::getTag(const ModifierLocation &location) co
 
 void AttributeManager::readAttributesFile()
 {
-    XML::Document doc(mAttributeReferenceFile);
-    xmlNodePtr node = doc.rootNode();
+    XML::Reader reader(mAttributeReferenceFile);
 
-    if (!node || !xmlStrEqual(node->name, BAD_CAST "attributes"))
+    if (!xmlStrEqual(reader.rootName(), BAD_CAST "attributes"))
     {
         LOG_FATAL("Attribute Manager: " << mAttributeReferenceFile
                   << " is not a valid database file!");
@@ -126,7 +135,7 @@ void AttributeManager::readAttributesFile()
 
     LOG_INFO("Loading attribute reference...");
 
-    for_each_xml_child_node(childNode, node)
+    while (xmlNodePtr childNode = reader.nextChild())
     {
         if (xmlStrEqual(childNode->name, BAD_CAST "attribute"))
             readAttributeNode(childNode);
@@ -128,6 +128,24 @@ class AttributeManager
 
         bool isAttributeDirectlyModifiable(int id) const;
 
+        /**
+         * Returns the index of the attribute with the given id, counting the
+         * loaded attributes in id order, or -1 when there is no such
+         * attribute.
+         */
+        int getAttributeIndex(int id) const
+        {
+            return id >= 0 && id < (int) mAttributeIndices.size() ?
+                        mAttributeIndices[id] : -1;
+        }
+
+        /**
+         * Returns the number of loaded attributes. Attribute indexes are
+         * lower than this.
+         */
+        unsigned int getAttributeCount() const
+        { return mAttributeMap.size(); }
+
         ModifierLocation getLocation(const std::string &tag) const;
 
         const std::string *getTag(const ModifierLocation &location) const;
@@ -147,6 +165,9 @@ class AttributeManager
         AttributeMap mAttributeMap;
         TagMap mTagMap;
 
+        /** Attribute id -> index, -1 for unused ids. */
+        std::vector<int> mAttributeIndices;
+
         const std::string mAttributeReferenceFile;
 };
 
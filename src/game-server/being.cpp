@@ -18,6 +18,7 @@
  *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cassert>
 
 #include "game-server/being.h"
@@ -30,16 +31,22 @@
 #include "game-server/eventlistener.h"
 #include "game-server/mapcomposite.h"
 #include "game-server/effect.h"
+#include "game-server/state.h"
 #include "game-server/statuseffect.h"
 #include "game-server/statusmanager.h"
 #include "utils/logger.h"
 #include "utils/speedconv.h"
 
+static Configuration::IntOption hpRegenBreakAfterHit(
+        "game_hpRegenBreakAfterHit", 0);
+
 Being::Being(EntityType type):
     Actor(type),
     mAction(STAND),
     mTarget(NULL),
     mGender(GENDER_UNSPECIFIED),
+    mPathCursor(0),
+    mMovementSlot(-1),
     mDirection(DOWN)
 {
     const AttributeManager::AttributeScope &attr = attributeManager->getAttributeScope(BeingScope);
@@ -126,8 +133,7 @@ int Being::damage(Actor * /* source */, const Damage &damage)
                   << mAttributes.at(ATTR_MAX_HP).getModifiedAttribute());
         setAttribute(ATTR_HP, HP.getBase() - HPloss);
         // No HP regen after being hit if this is set.
-        mHealthRegenerationTimeout.setSoft(
-                    Configuration::getValue("game_hpRegenBreakAfterHit", 0));
+        mHealthRegenerationTimeout.setSoft(hpRegenBreakAfterHit);
     }
     else
     {
@@ -190,6 +196,20 @@ void Being::setDestination(const Point &dst)
     mDst = dst;
     raiseUpdateFlags(UPDATEFLAG_NEW_DESTINATION);
     mPath.clear();
+    mPathCursor = 0;
+    updateMovement();
+}
+
+void Being::setPosition(const Point &p)
+{
+    Actor::setPosition(p);
+    updateMovement();
+}
+
+void Being::updateMovement()
+{
+    if (mMovementSlot >= 0)
+        getMap()->getMovement()->update(this);
 }
 
 Path Being::findPath()
@@ -302,6 +322,7 @@ void Being::move()
     // MapComposite::update() to determine whether a being has moved from one
     // zone to another.
     mOld = getPosition();
+    updateMovement();
 
     if (mMoveTime > WORLD_TICK_MS)
     {
@@ -337,21 +358,23 @@ void Being::move()
      * class has been used, because that seems to be the most logical
      * place extra functionality will be added.
      */
-    for (PathIterator pathIterator = mPath.begin();
+    for (PathIterator pathIterator = mPath.begin() + mPathCursor;
             pathIterator != mPath.end(); pathIterator++)
     {
         if (!map->getWalk(pathIterator->x, pathIterator->y, getWalkMask()))
         {
             mPath.clear();
+            mPathCursor = 0;
             break;
         }
     }
 
-    if (mPath.empty())
+    if (mPathCursor == mPath.size())
     {
         // No path exists: the walkability of cached path has changed, the
         // destination has changed, or a path was never set.
         mPath = findPath();
+        mPathCursor = 0;
     }
 
     if (mPath.empty())
@@ -360,24 +383,24 @@ void Being::move()
             setAction(STAND);
         // no path was found
         mDst = mOld;
+        updateMovement();
         mMoveTime = 0;
         return;
     }
 
     setAction(WALK);
 
+    const double speed = getModifiedAttribute(ATTR_MOVE_SPEED_RAW);
     Point prev(tileSX, tileSY);
     Point pos;
     do
     {
-        Point next = mPath.front();
-        mPath.pop_front();
+        Point next = mPath[mPathCursor++];
         // SQRT2 is used for diagonal movement.
         mMoveTime += (prev.x == next.x || prev.y == next.y) ?
-                       getModifiedAttribute(ATTR_MOVE_SPEED_RAW) :
-                       getModifiedAttribute(ATTR_MOVE_SPEED_RAW) * SQRT2;
+                       speed : speed * SQRT2;
 
-        if (mPath.empty())
+        if (mPathCursor == mPath.size())
         {
             // skip last tile center
             pos = mDst;
@@ -443,6 +466,7 @@ void Being::setAction(BeingAction action)
         mAutoAttacks.stop();
 
     mAction = action;
+    updateMovement();
     if (action != ATTACK && // The players are informed about these actions
         action != WALK)     // by other messages
     {
@@ -453,7 +477,15 @@ void Being::setAction(BeingAction action)
 void Being::applyModifier(unsigned int attr, double value, unsigned int layer,
                           unsigned int duration, unsigned int id)
 {
-    mAttributes.at(attr).add(duration, value, layer, id);
+    int expiry = 0;
+    if (duration)
+    {
+        expiry = GameState::getCurrentTick() + duration;
+        ModifierExpiry modifierExpiry = { expiry, attr, layer };
+        mModifierExpiries.push_back(modifierExpiry);
+        std::push_heap(mModifierExpiries.begin(), mModifierExpiries.end());
+    }
+    mAttributes.at(attr).add(expiry, value, layer, id);
     updateDerivedAttributes(attr);
 }
 
@@ -597,8 +629,9 @@ void Being::applyStatusEffect(int id, int timer)
     {
         Status newStatus;
         newStatus.status = statusEffect;
-        newStatus.time = timer;
+        newStatus.expiry = GameState::getCurrentTick() + timer;
         mStatus[id] = newStatus;
+        scheduleStatusExpiry(id, newStatus.expiry);
     }
     else
     {
@@ -626,14 +659,26 @@ bool Being::hasStatusEffect(int id) const
 unsigned Being::getStatusEffectTime(int id) const
 {
     StatusEffects::const_iterator it = mStatus.find(id);
-    if (it != mStatus.end()) return it->second.time;
-    else return 0;
+    if (it == mStatus.end())
+        return 0;
+    return std::max(it->second.expiry - GameState::getCurrentTick(), 0);
 }
 
 void Being::setStatusEffectTime(int id, int time)
 {
     StatusEffects::iterator it = mStatus.find(id);
-    if (it != mStatus.end()) it->second.time = time;
+    if (it != mStatus.end())
+    {
+        it->second.expiry = GameState::getCurrentTick() + time;
+        scheduleStatusExpiry(id, it->second.expiry);
+    }
+}
+
+void Being::scheduleStatusExpiry(int id, int tick)
+{
+    StatusExpiry expiry = { tick, id };
+    mStatusExpiries.push_back(expiry);
+    std::push_heap(mStatusExpiries.begin(), mStatusExpiries.end());
 }
 
 void Being::update()
@@ -660,33 +705,40 @@ void Being::update()
         raiseUpdateFlags(UPDATEFLAG_HEALTHCHANGE);
     }
 
-    // Update lifetime of effects.
-    for (AttributeMap::iterator it = mAttributes.begin();
-         it != mAttributes.end();
-         ++it)
+    // Remove the temporary modifiers that expired
+    const int tick = GameState::getCurrentTick();
+    while (!mModifierExpiries.empty() && mModifierExpiries.front().tick <= tick)
     {
-        if (it->second.tick())
-            updateDerivedAttributes(it->first);
+        const ModifierExpiry expiry = mModifierExpiries.front();
+        std::pop_heap(mModifierExpiries.begin(), mModifierExpiries.end());
+        mModifierExpiries.pop_back();
+
+        if (mAttributes.at(expiry.attribute).expire(expiry.layer, tick))
+            updateDerivedAttributes(expiry.attribute);
     }
 
-    // Update and run status effects
-    StatusEffects::iterator it = mStatus.begin();
-    while (it != mStatus.end())
+    // Remove the status effects that ended, or all of them when dead
+    if (mAction == DEAD)
     {
-        it->second.time--;
-        if (it->second.time > 0 && mAction != DEAD)
-            it->second.status->tick(this, it->second.time);
+        mStatus.clear();
+        mStatusExpiries.clear();
+    }
+    while (!mStatusExpiries.empty() && mStatusExpiries.front().tick <= tick)
+    {
+        const StatusExpiry expiry = mStatusExpiries.front();
+        std::pop_heap(mStatusExpiries.begin(), mStatusExpiries.end());
+        mStatusExpiries.pop_back();
 
-        if (it->second.time <= 0 || mAction == DEAD)
-        {
-            StatusEffects::iterator removeIt = it;
-            it++; // bring this iterator to the safety of the next element
-            mStatus.erase(removeIt);
-        }
-        else
-        {
-            it++;
-        }
+        StatusEffects::iterator it = mStatus.find(expiry.id);
+        if (it != mStatus.end() && it->second.expiry <= tick)
+            mStatus.erase(it);
+    }
+
+    // Run the remaining status effects
+    for (StatusEffects::iterator it = mStatus.begin(), it_end = mStatus.end();
+         it != it_end; ++it)
+    {
+        it->second.status->tick(this, it->second.expiry - tick);
     }
 
     // Check if being died
@@ -701,6 +753,7 @@ void Being::inserted()
     // Reset the old position, since after insertion it is important that it is
     // in sync with the zone that we're currently present in.
     mOld = getPosition();
+    updateMovement();
 }
 
 void Being::setGender(BeingGender gender)
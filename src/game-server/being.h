@@ -31,20 +31,21 @@
 #include "game-server/attribute.h"
 #include "game-server/autoattack.h"
 #include "game-server/timeout.h"
+#include "utils/objectpool.h"
 
 class Being;
 class MapComposite;
 class StatusEffect;
 
-typedef std::map< unsigned int, Attribute > AttributeMap;
-
 struct Status
 {
     StatusEffect *status;
-    unsigned time;  // Number of ticks
+    int expiry;     // Tick at which the effect ends
 };
 
-typedef std::map< int, Status > StatusEffects;
+typedef std::map< int, Status, std::less<int>,
+                  utils::PoolAllocator< std::pair<const int, Status> > >
+        StatusEffects;
 
 /**
  * Type definition for a list of hits
@@ -97,6 +98,12 @@ class Being : public Actor
          */
         void setDestination(const Point &dst);
 
+        /**
+         * Sets the coordinates of the being, keeping the movement store of
+         * its map up to date.
+         */
+        virtual void setPosition(const Point &p);
+
         /**
          * Sets the destination coordinates of the being to the current
          * position.
@@ -205,7 +212,8 @@ class Being : public Actor
         /**
          * Adds a modifier to one attribute.
          * @param duration If non-zero, creates a temporary modifier that
-         *        expires after \p duration ticks.
+         *        expires after \p duration ticks. It is queued to be
+         *        removed by update() at that time.
          * @param lvl If non-zero, indicates that a temporary modifier can be
          *        dispelled prematuraly by a spell of given level.
          */
@@ -246,12 +254,13 @@ class Being : public Actor
         bool hasStatusEffect(int id) const;
 
         /**
-         * Returns the time of the status effect if in effect, or 0 if not
+         * Returns the remaining time of the status effect if in effect, or
+         * 0 if not
          */
         unsigned getStatusEffectTime(int id) const;
 
         /**
-         * Changes the time of the status effect (if in effect)
+         * Changes the remaining time of the status effect (if in effect)
          */
         void setStatusEffectTime(int id, int time);
 
@@ -285,13 +294,69 @@ class Being : public Actor
          */
         virtual void inserted();
 
+        /**
+         * Gets the slot of the being in the movement store of its map, or -1
+         * when it is not listed there.
+         */
+        int getMovementSlot() const
+        { return mMovementSlot; }
+
+        /**
+         * Sets the slot of the being in the movement store of its map. Only
+         * meant to be called by MapMovement.
+         */
+        void setMovementSlot(int slot)
+        { mMovementSlot = slot; }
+
     protected:
         static const int TICKS_PER_HP_REGENERATION = 100;
 
         BeingAction mAction;
         AttributeMap mAttributes;
+
+        /**
+         * A layer of an attribute holding a temporary modifier, and the tick
+         * at which the modifier expires.
+         */
+        struct ModifierExpiry
+        {
+            int tick;
+            unsigned int attribute;
+            unsigned int layer;
+
+            /** Orders the queue so that the earliest expiry is on top. */
+            bool operator<(const ModifierExpiry &other) const
+            { return tick > other.tick; }
+        };
+
+        /**
+         * Heap of the pending expiries of temporary modifiers. Entries of
+         * modifiers that were removed early are left in place, expiring
+         * them only finds nothing to remove.
+         */
+        std::vector<ModifierExpiry> mModifierExpiries;
+
         AutoAttacks mAutoAttacks;
         StatusEffects mStatus;
+
+        /** A status effect and the tick at which it is due to end. */
+        struct StatusExpiry
+        {
+            int tick;
+            int id;
+
+            /** Orders the queue so that the earliest expiry is on top. */
+            bool operator<(const StatusExpiry &other) const
+            { return tick > other.tick; }
+        };
+
+        /**
+         * Heap of the expiries of the status effects. When the time of an
+         * effect changes, a new entry is added and the outdated one is
+         * ignored once it comes up.
+         */
+        std::vector<StatusExpiry> mStatusExpiries;
+
         Being *mTarget;
         Point mOld;                 /**< Old coordinates. */
         Point mDst;                 /**< Target coordinates. */
@@ -301,6 +366,15 @@ class Being : public Actor
         Being(const Being &rhs);
         Being &operator=(const Being &rhs);
 
+        /** Queues the removal of a status effect at the given tick. */
+        void scheduleStatusExpiry(int id, int tick);
+
+        /**
+         * Copies the movement state of the being to the movement store of
+         * its map, if it is listed there.
+         */
+        void updateMovement();
+
         /**
          * Update the being direction when moving so avoid directions desyncs
          * with other clients.
@@ -309,6 +383,8 @@ class Being : public Actor
                              const Point &destPos);
 
         Path mPath;
+        unsigned mPathCursor;        /**< Next step of the path. */
+        int mMovementSlot;           /**< Slot in the movement store. */
         BeingDirection mDirection;   /**< Facing direction. */
 
         std::string mName;
@@ -47,6 +47,8 @@
 #include <cmath>
 #include <limits.h>
 
+static Configuration::IntOption maxSkillCapOption("game_maxSkillCap", INT_MAX);
+
 // Experience curve related values
 const float Character::EXPCURVE_EXPONENT = 3.0f;
 const float Character::EXPCURVE_FACTOR = 10.0f;
@@ -130,19 +132,33 @@ void Character::update()
     if (getAction() == DEAD)
         return;
 
-    // Update special recharge
-    for (SpecialMap::iterator it = mSpecials.begin(), it_end = mSpecials.end();
-         it != it_end; it++)
+    // Notify about the specials that finished recharging
+    const int tick = GameState::getCurrentTick();
+    while (!mSpecialRecharges.empty() && mSpecialRecharges.front().tick <= tick)
     {
+        const SpecialRecharge recharge = mSpecialRecharges.front();
+        std::pop_heap(mSpecialRecharges.begin(), mSpecialRecharges.end());
+        mSpecialRecharges.pop_back();
+
+        SpecialMap::iterator it = mSpecials.find(recharge.id);
+        if (it == mSpecials.end() ||
+                it->second.getRechargedTick() != recharge.tick)
+            continue;
+
         SpecialValue &s = it->second;
-        if (s.specialInfo->rechargeable && s.currentMana < s.specialInfo->neededMana)
+        s.setCurrentMana(s.getCurrentMana());
+
+        const Script::Ref &callback = s.specialInfo->rechargedCallback;
+        if (callback.isValid())
         {
-            s.currentMana += s.rechargeSpeed;
-            if (s.currentMana >= s.specialInfo->neededMana &&
-                    s.specialInfo->rechargedCallback.isValid())
+            Script *script = ScriptManager::currentState();
+            if (callback.batched)
+            {
+                script->queueCall(callback, this, s.specialInfo->id);
+            }
+            else
             {
-                Script *script = ScriptManager::currentState();
-                script->prepare(s.specialInfo->rechargedCallback);
+                script->prepare(callback);
                 script->push(this);
                 script->push(s.specialInfo->id);
                 script->execute();
@@ -156,14 +172,6 @@ void Character::update()
         mSpecialUpdateNeeded = false;
     }
 
-    mStatusEffects.clear();
-    StatusEffects::iterator it = mStatus.begin();
-    while (it != mStatus.end())
-    {
-        mStatusEffects[it->first] = it->second.time;
-        it++;
-    }
-
     processAttacks();
 }
 
@@ -220,6 +228,12 @@ void Character::processAttacks()
 void Character::died()
 {
     Being::died();
+
+    // Dead characters do not recharge their specials
+    for (SpecialMap::iterator it = mSpecials.begin(), it_end = mSpecials.end();
+         it != it_end; ++it)
+        it->second.setRechargePaused(true);
+
     executeCallback(mDeathCallback, this);
 }
 
@@ -237,12 +251,19 @@ void Character::respawn()
     // Reset target
     mTarget = NULL;
 
+    for (SpecialMap::iterator it = mSpecials.begin(), it_end = mSpecials.end();
+         it != it_end; ++it)
+    {
+        it->second.setRechargePaused(false);
+        scheduleSpecialRecharge(it->first, it->second);
+    }
+
     // Execute respawn callback when set
     if (executeCallback(mDeathAcceptedCallback, this))
         return;
 
     // No script respawn callback set - fall back to hardcoded logic
-    mAttributes[ATTR_HP].setBase(mAttributes[ATTR_MAX_HP].getModifiedAttribute());
+    mAttributes.at(ATTR_HP).setBase(mAttributes.at(ATTR_MAX_HP).getModifiedAttribute());
     updateDerivedAttributes(ATTR_HP);
     // Warp back to spawn point.
     int spawnMap = Configuration::getValue("char_respawnMap", 1);
@@ -252,6 +273,59 @@ void Character::respawn()
     GameState::enqueueWarp(this, MapManager::getMap(spawnMap), spawnX, spawnY);
 }
 
+SpecialValue::SpecialValue(unsigned int currentMana,
+                           const SpecialManager::SpecialInfo *specialInfo)
+    : mana(currentMana)
+    , rechargeStart(GameState::getCurrentTick())
+    , rechargeSpeed(specialInfo->defaultRechargeSpeed)
+    , specialInfo(specialInfo)
+{}
+
+/**
+ * Returns the number of ticks needed to recharge the special from the given
+ * mana, or -1 if it does not recharge.
+ */
+static int rechargeTicks(const SpecialValue &special, unsigned int mana)
+{
+    const unsigned int neededMana = special.specialInfo->neededMana;
+    if (!special.specialInfo->rechargeable || special.rechargeStart < 0 ||
+            !special.rechargeSpeed || mana >= neededMana)
+        return -1;
+
+    return (neededMana - mana + special.rechargeSpeed - 1) /
+            special.rechargeSpeed;
+}
+
+unsigned int SpecialValue::getCurrentMana() const
+{
+    const int ticks = rechargeTicks(*this, mana);
+    if (ticks < 0)
+        return mana;
+
+    // Like when recharging tick by tick, the last step may overshoot
+    const int elapsed = GameState::getCurrentTick() - rechargeStart;
+    return mana + std::min(elapsed, ticks) * rechargeSpeed;
+}
+
+void SpecialValue::setCurrentMana(unsigned int currentMana)
+{
+    mana = currentMana;
+    if (rechargeStart >= 0)
+        rechargeStart = GameState::getCurrentTick();
+}
+
+int SpecialValue::getRechargedTick() const
+{
+    const int ticks = rechargeTicks(*this, mana);
+    return ticks < 0 ? 0 : rechargeStart + ticks;
+}
+
+void SpecialValue::setRechargePaused(bool paused)
+{
+    mana = getCurrentMana();
+    rechargeStart = paused ? -1 : GameState::getCurrentTick();
+}
+
 bool Character::specialUseCheck(SpecialMap::iterator it)
 {
     if (it == mSpecials.end())
@@ -263,11 +337,12 @@ bool Character::specialUseCheck(SpecialMap::iterator it)
 
     //check if the special is currently recharged
     SpecialValue &special = it->second;
+    const unsigned int currentMana = special.getCurrentMana();
     if (special.specialInfo->rechargeable &&
-            special.currentMana < special.specialInfo->neededMana)
+            currentMana < special.specialInfo->neededMana)
     {
         LOG_INFO("Character uses special " << it->first << " which is not recharged. ("
-                 << special.currentMana << "/"
+                 << currentMana << "/"
                  << special.specialInfo->neededMana << ")");
         return false;
     }
@@ -334,8 +409,12 @@ bool Character::giveSpecial(int id, int currentMana)
             LOG_ERROR("Tried to give not existing special id " << id << ".");
             return false;
         }
-        mSpecials.insert(std::pair<int, SpecialValue>(
-                             id, SpecialValue(currentMana, specialInfo)));
+        SpecialMap::iterator it = mSpecials.insert(
+                std::pair<int, SpecialValue>(
+                    id, SpecialValue(currentMana, specialInfo))).first;
+        if (getAction() == DEAD)
+            it->second.setRechargePaused(true);
+        scheduleSpecialRecharge(id, it->second);
         mSpecialUpdateNeeded = true;
         return true;
     }
@@ -347,7 +426,8 @@ bool Character::setSpecialMana(int id, int mana)
     SpecialMap::iterator it = mSpecials.find(id);
     if (it != mSpecials.end())
     {
-        it->second.currentMana = mana;
+        it->second.setCurrentMana(mana);
+        scheduleSpecialRecharge(id, it->second);
         mSpecialUpdateNeeded = true;
         return true;
     }
@@ -359,7 +439,10 @@ bool Character::setSpecialRechargeSpeed(int id, int speed)
     SpecialMap::iterator it = mSpecials.find(id);
     if (it != mSpecials.end())
     {
-        it->second.rechargeSpeed = speed;
+        SpecialValue &special = it->second;
+        special.setCurrentMana(special.getCurrentMana());
+        special.rechargeSpeed = speed;
+        scheduleSpecialRecharge(id, special);
         mSpecialUpdateNeeded = true;
         return true;
     }
@@ -376,13 +459,37 @@ void Character::sendSpecialUpdate()
          it != it_end; ++it)
     {
         msg.writeInt8(it->first);
-        msg.writeInt32(it->second.currentMana);
+        msg.writeInt32(it->second.getCurrentMana());
         msg.writeInt32(it->second.specialInfo->neededMana);
         msg.writeInt32(it->second.rechargeSpeed);
     }
     gameHandler->sendTo(this, msg);
 }
 
+void Character::scheduleSpecialRecharge(int id, const SpecialValue &special)
+{
+    const int tick = special.getRechargedTick();
+    if (!tick)
+        return;
+
+    SpecialRecharge recharge = { tick, id };
+    mSpecialRecharges.push_back(recharge);
+    std::push_heap(mSpecialRecharges.begin(), mSpecialRecharges.end());
+}
+
+std::map<int, int> Character::getStatusEffects() const
+{
+    std::map<int, int> statusEffects;
+    const int tick = GameState::getCurrentTick();
+    for (StatusEffects::const_iterator it = mStatus.begin(),
+         it_end = mStatus.end(); it != it_end; ++it)
+    {
+        if (it->second.expiry > tick)
+            statusEffects[it->first] = it->second.expiry - tick;
+    }
+    return statusEffects;
+}
+
 int Character::getMapId() const
 {
     return getMap()->getID();
@@ -621,7 +728,7 @@ void Character::receiveExperience(int skill, int experience, int optimalLevel)
         newExp = 0; // Avoid integer underflow/negative exp.
 
     // Check the skill cap
-    long int maxSkillCap = Configuration::getValue("game_maxSkillCap", INT_MAX);
+    const long int maxSkillCap = maxSkillCapOption;
     assert(maxSkillCap <= INT_MAX);  // Avoid integer overflow.
     if (newExp > maxSkillCap)
     {
@@ -832,4 +939,5 @@ bool Character::takeSpecial(int id)
 void Character::clearSpecials()
 {
     mSpecials.clear();
+    mSpecialRecharges.clear();
 }
@@ -43,16 +43,41 @@ class MessageOut;
 class Point;
 class Trade;
 
+/**
+ * The charge of a special. Instead of being increased every tick, the mana
+ * is remembered together with the tick from which it recharges, and the
+ * current mana is computed from those when needed.
+ */
 struct SpecialValue
 {
     SpecialValue(unsigned int currentMana,
-                 const SpecialManager::SpecialInfo *specialInfo)
-        : currentMana(currentMana)
-        , rechargeSpeed(specialInfo->defaultRechargeSpeed)
-        , specialInfo(specialInfo)
-    {}
-
-    unsigned int currentMana;
+                 const SpecialManager::SpecialInfo *specialInfo);
+
+    /**
+     * Returns the mana of the special, including what recharged since it
+     * was last set.
+     */
+    unsigned int getCurrentMana() const;
+
+    /**
+     * Sets the mana of the special, which recharges from the current tick
+     * on unless recharging is paused.
+     */
+    void setCurrentMana(unsigned int mana);
+
+    /**
+     * Returns the tick at which the special will be recharged, or 0 when it
+     * is not recharging.
+     */
+    int getRechargedTick() const;
+
+    /**
+     * Stops or restarts recharging, keeping the mana recharged so far.
+     */
+    void setRechargePaused(bool paused);
+
+    unsigned int mana;          /**< Mana at the tick rechargeStart. */
+    int rechargeStart;          /**< -1 while recharging is paused. */
     unsigned int rechargeSpeed;
     const SpecialManager::SpecialInfo *specialInfo;
 };
@@ -291,16 +316,10 @@ class Character : public Being
         { return mExperience.end(); }
 
         /**
-         * Used to serialize status effects.
+         * Used to serialize status effects. Returns the remaining time of
+         * each status effect, by status effect id.
          */
-        int getStatusEffectSize() const
-        { return mStatusEffects.size(); }
-
-        const std::map<int, int>::const_iterator getStatusEffectBegin() const
-        { return mStatusEffects.begin(); }
-
-        const std::map<int, int>::const_iterator getStatusEffectEnd() const
-        { return mStatusEffects.end(); }
+        std::map<int, int> getStatusEffects() const;
 
         /**
          * Used to serialize kill count.
@@ -475,6 +494,11 @@ class Character : public Being
          */
         void sendSpecialUpdate();
 
+        /**
+         * Queues the recharged callback of the special, if it is recharging.
+         */
+        void scheduleSpecialRecharge(int id, const SpecialValue &special);
+
         enum TransactionType
         { TRANS_NONE, TRANS_TRADE, TRANS_BUYSELL };
 
@@ -498,11 +522,26 @@ class Character : public Being
         std::map<int, int> mExperience; /**< experience collected for each skill.*/
 
         SpecialMap mSpecials;
-        std::map<int, int> mStatusEffects; /**< only used by select functions
-                                                to make it easier to make the accountserver
-                                                do not modify or use anywhere else*/
         bool mSpecialUpdateNeeded;
 
+        /** A special and the tick at which it will be recharged. */
+        struct SpecialRecharge
+        {
+            int tick;
+            int id;
+
+            /** Orders the queue so that the earliest recharge is on top. */
+            bool operator<(const SpecialRecharge &other) const
+            { return tick > other.tick; }
+        };
+
+        /**
+         * Heap of the specials that are recharging, to call their recharged
+         * callback. Entries are added whenever the mana or the recharge
+         * speed of a special changes, the outdated ones are ignored.
+         */
+        std::vector<SpecialRecharge> mSpecialRecharges;
+
         int mDatabaseID;             /**< Character's database ID. */
         unsigned char mHairStyle;    /**< Hair Style of the character. */
         unsigned char mHairColor;    /**< Hair Color of the character. */
@@ -35,6 +35,7 @@
 #include "game-server/specialmanager.h"
 #include "game-server/state.h"
 
+#include "scripting/script.h"
 #include "scripting/scriptmanager.h"
 
 #include "common/configuration.h"
@@ -86,6 +87,7 @@ static void handleGiveSpecial(Character*, std::string&);
 static void handleTakeSpecial(Character*, std::string&);
 static void handleRechargeSpecial(Character*, std::string&);
 static void handleListSpecials(Character*, std::string&);
+static void handleScriptProfile(Character*, std::string&);
 
 static CmdRef const cmdRef[] =
 {
@@ -167,6 +169,11 @@ static CmdRef const cmdRef[] =
         "<setname>_<specialname>", &handleRechargeSpecial},
     {"listspecials", "<character>",
         "Lists the specials of the character.", &handleListSpecials},
+    {"scriptprofile", "[on [sample interval] | off | reset | <entries>]",
+        "Enables or disables the script profiler, or shows where the time "
+        "spent in scripts went. A sample interval enables the sampling of "
+        "the executed lines every that many script instructions.",
+        &handleScriptProfile},
     {NULL, NULL, NULL, NULL}
 
 };
@@ -813,7 +820,8 @@ static void handleRecall(Character *player, std::string &args)
 
 static void handleReload(Character *, std::string &)
 {
-    // reload the items and monsters
+    // reload the configuration, items and monsters
+    Configuration::reload();
     itemManager->reload();
     monsterManager->reload();
 }
@@ -1693,11 +1701,59 @@ static void handleListSpecials(Character *player, std::string &args)
         const SpecialValue &info = it->second;
         std::stringstream str;
         str << info.specialInfo->id << ": " << info.specialInfo->setName << "/"
-            << info.specialInfo->name << " charge: " << info.currentMana;
+            << info.specialInfo->name << " charge: " << info.getCurrentMana();
         say(str.str(), player);
     }
 }
 
+static void handleScriptProfile(Character *player, std::string &args)
+{
+    Script *script = ScriptManager::currentState();
+    std::string action = getArgument(args);
+
+    if (action == "on")
+    {
+        std::string interval = getArgument(args);
+        if (!interval.empty() && !utils::isNumeric(interval))
+        {
+            say("Invalid sample interval.", player);
+            return;
+        }
+        script->setProfiling(true, interval.empty() ?
+                                       0 : utils::stringToInt(interval));
+        say("Script profiler enabled.", player);
+        return;
+    }
+    if (action == "off")
+    {
+        script->setProfiling(false);
+        say("Script profiler disabled.", player);
+        return;
+    }
+    if (action == "reset")
+    {
+        script->resetProfiler();
+        say("Script profile reset.", player);
+        return;
+    }
+    if (!action.empty() && !utils::isNumeric(action))
+    {
+        say("Invalid arguments given.", player);
+        say("Usage: @scriptprofile [on [sample interval] | off | reset | "
+            "<entries>]", player);
+        return;
+    }
+
+    const int entries = action.empty() ? 5 : utils::stringToInt(action);
+    std::list<std::string> lines;
+    script->getProfiler().report(lines, entries);
+    for (std::list<std::string>::const_iterator it = lines.begin(),
+         it_end = lines.end(); it != it_end; ++it)
+    {
+        say(*it, player);
+    }
+}
+
 void CommandHandler::handleCommand(Character *player,
                                    const std::string &command)
 {
@@ -22,6 +22,20 @@
 
 #include "game-server/mapcomposite.h"
 #include "game-server/state.h"
+#include "utils/objectpool.h"
+
+static utils::ObjectPool *effectPool =
+        utils::ObjectPool::get("Effect", sizeof(Effect));
+
+void *Effect::operator new(size_t size)
+{
+    return effectPool->allocate(size);
+}
+
+void Effect::operator delete(void *ptr, size_t size)
+{
+    effectPool->deallocate(ptr, size);
+}
 
 void Effect::update()
 {
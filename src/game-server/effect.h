@@ -34,6 +34,13 @@ class Effect : public Actor
           , mBeing(NULL)
         {}
 
+        /**
+         * An effect is removed in the tick after it was shown, and many are
+         * shown every tick during fights, so effects come from a pool.
+         */
+        static void *operator new(size_t size);
+        static void operator delete(void *ptr, size_t size);
+
         int getEffectId() const
         { return mEffectId; }
 
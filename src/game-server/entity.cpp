@@ -24,8 +24,37 @@
 
 #include "game-server/eventlistener.h"
 
+std::vector<Entity::HandleSlot> Entity::mHandleSlots;
+std::vector<unsigned> Entity::mFreeHandleSlots;
+
+Entity::Entity(EntityType type, MapComposite *map)
+  : mMap(map),
+    mType(type)
+{
+    if (mFreeHandleSlots.empty())
+    {
+        HandleSlot slot;
+        slot.generation = 1;
+        mFreeHandleSlots.push_back(mHandleSlots.size());
+        mHandleSlots.push_back(slot);
+    }
+
+    mHandle.index = mFreeHandleSlots.back();
+    mFreeHandleSlots.pop_back();
+
+    HandleSlot &slot = mHandleSlots[mHandle.index];
+    slot.entity = this;
+    mHandle.generation = slot.generation;
+}
+
 Entity::~Entity()
 {
+    // Invalidates the handles to this entity
+    HandleSlot &slot = mHandleSlots[mHandle.index];
+    slot.entity = 0;
+    ++slot.generation;
+    mFreeHandleSlots.push_back(mHandle.index);
+
     /* As another object will stop listening and call removeListener when it is
        deleted, the following assertion ensures that all the calls to
        removeListener have been performed will this object was still alive. It
@@ -45,6 +74,17 @@ void Entity::removeListener(const EventListener *l)
     mListeners.erase(l);
 }
 
+bool Entity::hasListener(const EventDispatch *d) const
+{
+    for (Listeners::const_iterator i = mListeners.begin(),
+         i_end = mListeners.end(); i != i_end; ++i)
+    {
+        if ((*i)->dispatch == d)
+            return true;
+    }
+    return false;
+}
+
 void Entity::inserted()
 {
     for (Listeners::iterator i = mListeners.begin(),
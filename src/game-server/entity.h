@@ -22,14 +22,28 @@
 #define ENTITY_H
 
 #include "common/manaserv_protocol.h"
+#include "utils/objectpool.h"
 
 using namespace ManaServ;
 
 #include <set>
+#include <vector>
 
 class EventListener;
+struct EventDispatch;
 class MapComposite;
 
+/**
+ * Refers to an entity in a way that can be checked for validity in constant
+ * time, also after the entity was deleted. Used for handing out entities to
+ * the scripts, which may hold on to them for longer than they exist.
+ */
+struct EntityHandle
+{
+    unsigned index;         /**< Slot of the entity. */
+    unsigned generation;    /**< Incremented each time the slot is freed. */
+};
+
 /**
  * Base class for in-game objects. Knows only its type and the map it resides
  * on. Provides listeners.
@@ -37,10 +51,7 @@ class MapComposite;
 class Entity
 {
     public:
-        Entity(EntityType type, MapComposite *map = 0)
-          : mMap(map),
-            mType(type)
-        {}
+        Entity(EntityType type, MapComposite *map = 0);
 
         virtual ~Entity();
 
@@ -52,6 +63,21 @@ class Entity
         EntityType getType() const
         { return mType; }
 
+        const EntityHandle &getHandle() const
+        { return mHandle; }
+
+        /**
+         * Returns the entity the handle refers to, or 0 when it was deleted.
+         */
+        static Entity *fromHandle(const EntityHandle &handle)
+        {
+            if (handle.index >= mHandleSlots.size())
+                return 0;
+
+            const HandleSlot &slot = mHandleSlots[handle.index];
+            return slot.generation == handle.generation ? slot.entity : 0;
+        }
+
         /**
          * Returns whether this entity is visible on the map or not. (Actor)
          */
@@ -98,6 +124,11 @@ class Entity
          */
         void removeListener(const EventListener *);
 
+        /**
+         * Checks whether one of the listeners uses the given dispatch table.
+         */
+        bool hasListener(const EventDispatch *) const;
+
         /**
          * Calls all the "inserted" listeners.
          */
@@ -109,12 +140,28 @@ class Entity
         virtual void removed();
 
     protected:
-        typedef std::set< const EventListener * > Listeners;
+        typedef std::set< const EventListener *,
+                          std::less<const EventListener *>,
+                          utils::PoolAllocator<const EventListener *> >
+                Listeners;
         Listeners mListeners;   /**< List of event listeners. */
 
     private:
+        struct HandleSlot
+        {
+            Entity *entity;
+            unsigned generation;
+        };
+
+        Entity(const Entity &);
+        Entity &operator=(const Entity &);
+
         MapComposite *mMap;     /**< Map the entity is on */
         EntityType mType;       /**< Type of this entity. */
+        EntityHandle mHandle;
+
+        static std::vector<HandleSlot> mHandleSlots;
+        static std::vector<unsigned> mFreeHandleSlots;
 };
 
 #endif // ENTITY_H
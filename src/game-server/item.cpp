@@ -31,6 +31,9 @@
 #include "game-server/state.h"
 #include "scripting/script.h"
 #include "scripting/scriptmanager.h"
+#include "utils/objectpool.h"
+
+Configuration::IntOption floorItemDecayTime("game_floorItemDecayTime", 0);
 
 bool ItemEffectAttrMod::apply(Being *itemUser)
 {
@@ -118,11 +121,23 @@ bool ItemClass::useTrigger(Being *itemUser, ItemTriggerType trigger)
     return ret;
 }
 
+static utils::ObjectPool *itemPool =
+        utils::ObjectPool::get("Item", sizeof(Item));
+
+void *Item::operator new(size_t size)
+{
+    return itemPool->allocate(size);
+}
+
+void Item::operator delete(void *ptr, size_t size)
+{
+    itemPool->deallocate(ptr, size);
+}
 
 Item::Item(ItemClass *type, int amount)
           : Actor(OBJECT_ITEM), mType(type), mAmount(amount)
 {
-    mLifetime = Configuration::getValue("game_floorItemDecayTime", 0) * 10;
+    mLifetime = floorItemDecayTime * 10;
 }
 
 void Item::update()
@@ -29,6 +29,17 @@
 class Being;
 class ItemClass;
 
+namespace Configuration
+{
+    class IntOption;
+}
+
+/**
+ * Seconds before items dropped on the floor vanish, the
+ * game_floorItemDecayTime option. 0 means never.
+ */
+extern Configuration::IntOption floorItemDecayTime;
+
 // Indicates the equip slot "cost" to equip an item.
 struct ItemEquipRequirement {
     ItemEquipRequirement():
@@ -269,11 +280,8 @@ class ItemClass
                 delete mEffects.begin()->second;
                 mEffects.erase(mEffects.begin());
             }
-            while (mDispells.begin() != mDispells.end())
-            {
-                delete mDispells.begin()->second;
-                mDispells.erase(mDispells.begin());
-            }
+            // The dispell effects are also in mEffects
+            mDispells.clear();
         }
 
         unsigned short mDatabaseID; /**< Item reference information */
@@ -308,6 +316,13 @@ class Item : public Actor
     public:
         Item(ItemClass *type, int amount);
 
+        /**
+         * Floor items appear with every drop and vanish when picked up or
+         * when their lifetime ends. They use a pool of their own.
+         */
+        static void *operator new(size_t size);
+        static void operator delete(void *ptr, size_t size);
+
         ItemClass *getItemClass() const
         { return mType; }
 
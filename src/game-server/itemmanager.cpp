@@ -35,8 +35,16 @@
 
 void ItemManager::reload()
 {
-    deinitialize();
-    initialize();
+    const uint64_t equipSlotsFingerprint = mEquipSlotsFingerprint;
+    clearEquipSlots();
+    readEquipSlotsFile();
+
+    // Items resolve the names of their equip slots when they are read, so
+    // they all need to be read again when the slots changed.
+    if (mEquipSlotsFingerprint != equipSlotsFingerprint)
+        mItemFingerprints.clear();
+
+    readItemsFile();
 }
 
 void ItemManager::initialize()
@@ -54,15 +62,42 @@ void ItemManager::deinitialize()
         delete i->second;
     }
 
-    for (std::map< unsigned int, EquipSlotInfo* >::iterator it =
-        mEquipSlotsInfo.begin(), it_end = mEquipSlotsInfo.end(); it != it_end;
-        ++it)
+    for (std::vector< ItemClass * >::iterator i = mRetiredItemClasses.begin(),
+         i_end = mRetiredItemClasses.end(); i != i_end; ++i)
     {
-        delete it->second;
+        delete *i;
     }
 
     mItemClasses.clear();
     mItemClassesByName.clear();
+    mItemFingerprints.clear();
+    mRetiredItemClasses.clear();
+
+    clearEquipSlots();
+}
+
+void ItemManager::clearEquipSlots()
+{
+    for (EquipSlotsInfo::iterator it = mEquipSlotsInfo.begin(),
+         it_end = mEquipSlotsInfo.end(); it != it_end; ++it)
+    {
+        delete it->second;
+    }
+
+    mEquipSlotsInfo.clear();
+    mNamedEquipSlotsInfo.clear();
+    mVisibleEquipSlotCount = 0;
+}
+
+void ItemManager::retireItem(ItemClasses::iterator i)
+{
+    ItemClass *item = i->second;
+    if (mItemClassesByName.value(item->getName()) == item)
+        mItemClassesByName.remove(item->getName());
+
+    mItemFingerprints.erase(i->first);
+    mRetiredItemClasses.push_back(item);
+    mItemClasses.erase(i);
 }
 
 ItemClass *ItemManager::getItem(int itemId) const
@@ -101,10 +136,9 @@ bool ItemManager::isEquipSlotVisible(unsigned int id) const
 
 void ItemManager::readEquipSlotsFile()
 {
-    XML::Document doc(mEquipSlotsFile);
-    xmlNodePtr rootNode = doc.rootNode();
+    XML::Reader reader(mEquipSlotsFile);
 
-    if (!rootNode || !xmlStrEqual(rootNode->name, BAD_CAST "equip-slots"))
+    if (!xmlStrEqual(reader.rootName(), BAD_CAST "equip-slots"))
     {
         LOG_ERROR("Item Manager: Error while parsing equip slots database ("
                   << mEquipSlotsFile << ")!");
@@ -116,9 +150,13 @@ void ItemManager::readEquipSlotsFile()
     unsigned totalCapacity = 0;
     unsigned slotCount = 0;
     mVisibleEquipSlotCount = 0;
+    mEquipSlotsFingerprint = 0;
 
-    for_each_xml_child_node(node, rootNode)
+    while (xmlNodePtr node = reader.nextChild())
     {
+        mEquipSlotsFingerprint = mEquipSlotsFingerprint * 31 +
+                                 XML::getFingerprint(node);
+
         if (xmlStrEqual(node->name, BAD_CAST "slot"))
         {
             const int slotId = XML::getProperty(node, "id", 0);
@@ -174,10 +212,9 @@ void ItemManager::readEquipSlotsFile()
 
 void ItemManager::readItemsFile()
 {
-    XML::Document doc2(mItemsFile);
-    xmlNodePtr rootNode = doc2.rootNode();
+    XML::Reader reader(mItemsFile);
 
-    if (!rootNode || !xmlStrEqual(rootNode->name, BAD_CAST "items"))
+    if (!xmlStrEqual(reader.rootName(), BAD_CAST "items"))
     {
         LOG_ERROR("Item Manager: Error while parsing item database ("
                   << mItemsFile << ")!");
@@ -186,41 +223,67 @@ void ItemManager::readItemsFile()
 
     LOG_INFO("Loading item reference: " << mItemsFile);
 
-    for_each_xml_child_node(node, rootNode)
+    std::set<int> readIds;
+    unsigned changedCount = 0;
+
+    while (xmlNodePtr node = reader.nextChild())
     {
         if (xmlStrEqual(node->name, BAD_CAST "item"))
         {
-            readItemNode(node);
+            if (readItemNode(node, readIds))
+                ++changedCount;
         }
     }
 
-    LOG_INFO("Loaded " << mItemClasses.size() << " items from "
-             << mItemsFile << ".");
+    // Retire the items that are no longer defined
+    for (ItemClasses::iterator i = mItemClasses.begin();
+         i != mItemClasses.end();)
+    {
+        if (readIds.find(i->first) == readIds.end())
+            retireItem(i++);
+        else
+            ++i;
+    }
+
+    LOG_INFO("Loaded " << mItemClasses.size() << " items (" << changedCount
+             << " new or changed) from " << mItemsFile << ".");
 }
 
-void ItemManager::readItemNode(xmlNodePtr itemNode)
+bool ItemManager::readItemNode(xmlNodePtr itemNode, std::set<int> &readIds)
 {
     const int id = XML::getProperty(itemNode, "id", 0);
     if (id < 1)
     {
         LOG_WARN("Item Manager: Item ID: " << id << " is invalid in "
                  << mItemsFile << ", and will be ignored.");
-        return;
+        return false;
     }
 
     // Type is mostly unused, but still serves for hairsheets and race sheets
     const std::string type = XML::getProperty(itemNode, "type", std::string());
     if (type == "hairsprite" || type == "racesprite")
-        return;
+        return false;
+
+    if (!readIds.insert(id).second)
+    {
+        LOG_WARN("Item Manager: Ignoring duplicate definition of item '" << id
+                 << "'!");
+        return false;
+    }
 
+    const uint64_t fingerprint = XML::getFingerprint(itemNode);
     ItemClasses::iterator i = mItemClasses.find(id);
 
     if (i != mItemClasses.end())
     {
-        LOG_WARN("Item Manager: Ignoring duplicate definition of item '" << id
-                 << "'!");
-        return;
+        std::map< int, uint64_t >::const_iterator f =
+                mItemFingerprints.find(id);
+        if (f != mItemFingerprints.end() && f->second == fingerprint)
+            return false;
+
+        retireItem(i);
     }
+    mItemFingerprints[id] = fingerprint;
 
     unsigned int maxPerSlot = XML::getProperty(itemNode, "max-per-slot", 0);
     if (!maxPerSlot)
@@ -260,6 +323,8 @@ void ItemManager::readItemNode(xmlNodePtr itemNode)
         }
         // More properties go here
     }
+
+    return true;
 }
 
 void ItemManager::readEquipNode(xmlNodePtr equipNode, ItemClass *item)
@@ -26,6 +26,7 @@
 
 #include <string>
 #include <map>
+#include <set>
 #include <vector>
 
 class ItemClass;
@@ -55,6 +56,7 @@ class ItemManager
             mItemsFile(itemFile),
             mEquipSlotsFile(equipFile),
             mVisibleEquipSlotCount(0),
+            mEquipSlotsFingerprint(0),
             mItemDatabaseVersion(0)
         {}
 
@@ -67,7 +69,10 @@ class ItemManager
         void initialize();
 
         /**
-         * Reloads item reference file.
+         * Reloads item reference file. Only the items whose definition
+         * changed are replaced. The replaced and removed item classes are
+         * kept alive until deinitialize(), since items in the world still
+         * refer to them.
          */
         void reload();
 
@@ -106,17 +111,30 @@ class ItemManager
     private:
         /** Loads the equip slots that a character has available to them. */
         void readEquipSlotsFile();
+        void clearEquipSlots();
 
         /** Loads the main item database. */
         void readItemsFile();
-        void readItemNode(xmlNodePtr itemNode);
+
+        /**
+         * Reads an item definition, unless it did not change since the
+         * last read. Returns whether a new or changed definition was read.
+         */
+        bool readItemNode(xmlNodePtr itemNode, std::set<int> &readIds);
         void readEquipNode(xmlNodePtr equipNode, ItemClass *item);
         void readEffectNode(xmlNodePtr effectNode, ItemClass *item);
 
         typedef std::map< int, ItemClass * > ItemClasses;
+        void retireItem(ItemClasses::iterator i);
+
         ItemClasses mItemClasses; /**< Item reference */
         utils::NameMap<ItemClass*> mItemClassesByName;
 
+        /** Hashes of the item definitions, to find changes on reload. */
+        std::map< int, uint64_t > mItemFingerprints;
+        /** Item classes replaced or removed by a reload. */
+        std::vector< ItemClass * > mRetiredItemClasses;
+
         // Map an equip slot id with the equip slot info.
         typedef std::map< unsigned int, EquipSlotInfo* > EquipSlotsInfo;
         // Reference to the vector position of equipSlots
@@ -130,6 +148,7 @@ class ItemManager
         std::string mItemsFile;
         std::string mEquipSlotsFile;
         unsigned int mVisibleEquipSlotCount; // Cache
+        uint64_t mEquipSlotsFingerprint;
 
         /** Version of the loaded items database file.*/
         unsigned int mItemDatabaseVersion;
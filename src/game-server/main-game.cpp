@@ -26,7 +26,10 @@
 #include "game-server/attributemanager.h"
 #include "game-server/gamehandler.h"
 #include "game-server/itemmanager.h"
+#include "game-server/mapcomposite.h"
+#include "game-server/map.h"
 #include "game-server/mapmanager.h"
+#include "game-server/mapreader.h"
 #include "game-server/monstermanager.h"
 #include "game-server/skillmanager.h"
 #include "game-server/specialmanager.h"
@@ -38,6 +41,7 @@
 #include "net/messageout.h"
 #include "scripting/scriptmanager.h"
 #include "utils/logger.h"
+#include "utils/objectpool.h"
 #include "utils/processorutils.h"
 #include "utils/stringfilter.h"
 #include "utils/timer.h"
@@ -221,7 +225,11 @@ static void printHelp()
               << "                        - 3. Plus standard information." << std::endl
               << "                        - 4. Plus debugging information." << std::endl
               << "     --port <n>      : Set the default port to listen on."
-              << std::endl;
+              << std::endl
+              << "     --compile-scripts : Fill the script bytecode cache"
+              << " with the scripts of all maps and exit." << std::endl
+              << "     --compile-maps  : Fill the map cache with all the maps"
+              << " of the maps file and exit." << std::endl;
     exit(EXIT_NORMAL);
 }
 
@@ -231,7 +239,9 @@ struct CommandLineOptions
         verbosity(Logger::Warn),
         verbosityChanged(false),
         port(DEFAULT_SERVER_PORT + 3),
-        portChanged(false)
+        portChanged(false),
+        compileScripts(false),
+        compileMaps(false)
     {}
 
     std::string configPath;
@@ -241,6 +251,9 @@ struct CommandLineOptions
 
     int port;
     bool portChanged;
+
+    bool compileScripts;
+    bool compileMaps;
 };
 
 /**
@@ -256,6 +269,8 @@ static void parseOptions(int argc, char *argv[], CommandLineOptions &options)
         { "config",     required_argument, 0, 'c' },
         { "verbosity",  required_argument, 0, 'v' },
         { "port",       required_argument, 0, 'p' },
+        { "compile-scripts", no_argument,  0, 's' },
+        { "compile-maps", no_argument,     0, 'm' },
         { 0, 0, 0, 0 }
     };
 
@@ -286,8 +301,105 @@ static void parseOptions(int argc, char *argv[], CommandLineOptions &options)
                 options.port = atoi(optarg);
                 options.portChanged = true;
                 break;
+            case 's':
+                options.compileScripts = true;
+                break;
+            case 'm':
+                options.compileMaps = true;
+                break;
+        }
+    }
+}
+
+
+/**
+ * Loads the main script and activates every map, so that all the scripts the
+ * server would load end up in the bytecode cache.
+ */
+static int compileScripts()
+{
+    if (Configuration::getValue("script_bytecodeCache", std::string()).empty())
+    {
+        LOG_FATAL("No script bytecode cache directory configured, set "
+                  "'script_bytecodeCache'.");
+        return EXIT_BAD_CONFIG_PARAMETER;
+    }
+
+    initializeServer();
+
+    const MapManager::Maps &maps = MapManager::getMaps();
+    std::vector< int > mapIds;
+    for (MapManager::Maps::const_iterator it = maps.begin(),
+         it_end = maps.end(); it != it_end; ++it)
+    {
+        mapIds.push_back(it->first);
+    }
+    MapManager::preloadMaps(mapIds);
+
+    for (MapManager::Maps::const_iterator it = maps.begin(),
+         it_end = maps.end(); it != it_end; ++it)
+    {
+        // The map scripts are loaded along with the content of the map
+        if (!MapManager::activateMap(it->first))
+            LOG_ERROR("Could not activate map " << it->second->getName());
+        else if (it->second->isHibernating())
+            it->second->wakeUp();
+    }
+
+    deinitializeServer();
+    return EXIT_NORMAL;
+}
+
+
+/**
+ * Reads every map of the maps file, so that they all end up in the map cache.
+ * Unlike compiling the scripts, this does not need the rest of the server.
+ */
+static int compileMaps()
+{
+    if (Configuration::getValue("map_cache", std::string()).empty())
+    {
+        LOG_FATAL("No map cache directory configured, set 'map_cache'.");
+        return EXIT_BAD_CONFIG_PARAMETER;
+    }
+
+    PHYSFS_init("");
+    Logger::initialize(Configuration::getValue("log_gameServerFile",
+                                               DEFAULT_LOG_FILE));
+    ResourceManager::initialize();
+
+    if (MapManager::initialize(DEFAULT_MAPSDB_FILE) < 1)
+    {
+        LOG_FATAL("The Game Server can't find any valid/available maps.");
+        return EXIT_MAP_FILE_NOT_FOUND;
+    }
+
+    int failures = 0;
+    const MapManager::Maps &maps = MapManager::getMaps();
+    for (MapManager::Maps::const_iterator it = maps.begin(),
+         it_end = maps.end(); it != it_end; ++it)
+    {
+        std::string file = "maps/" + it->second->getName() + ".tmx";
+        if (!ResourceManager::exists(file))
+            file += ".gz";
+
+        if (Map *map = MapReader::readMap(file))
+        {
+            delete map;
+        }
+        else
+        {
+            LOG_ERROR("Could not compile map " << it->second->getName());
+            ++failures;
         }
     }
+
+    LOG_INFO("Compiled " << maps.size() - failures << " of " << maps.size()
+             << " maps.");
+
+    MapManager::deinitialize();
+    PHYSFS_deinit();
+    return failures ? EXIT_MAP_FILE_NOT_FOUND : EXIT_NORMAL;
 }
 
 
@@ -319,6 +431,24 @@ int main(int argc, char *argv[])
                                                        options.verbosity) );
     Logger::setVerbosity(options.verbosity);
 
+    utils::ObjectPool::setPoisoning(
+            Configuration::getBoolValue("game_poisonPools", false));
+
+    if (options.compileScripts)
+    {
+        // Let the cache report what it did
+        if (options.verbosity < Logger::Info)
+            Logger::setVerbosity(Logger::Info);
+        return compileScripts();
+    }
+
+    if (options.compileMaps)
+    {
+        if (options.verbosity < Logger::Info)
+            Logger::setVerbosity(Logger::Info);
+        return compileMaps();
+    }
+
     // General initialization
     initializeServer();
 
@@ -371,6 +501,8 @@ int main(int argc, char *argv[])
         return EXIT_NET_EXCEPTION;
     }
 
+    Configuration::logUsedOptions();
+
     // Initialize world timer
     worldTimer.start();
 
@@ -402,12 +534,20 @@ int main(int argc, char *argv[])
             if (currentTick % 100 == 0)
                 LOG_INFO("World time: " << currentTick);
 
+            // Report on the scripts and the object pools every 30 seconds
+            if (currentTick % 300 == 0)
+            {
+                ScriptManager::logStatistics();
+                utils::ObjectPool::logStatistics();
+            }
+
             if (accountHandler->isConnected())
             {
                 accountServerLost = false;
 
                 // Handle all messages that are in the message queues
                 accountHandler->process();
+                accountHandler->activatePendingMaps();
 
                 if (currentTick % 100 == 0) {
                     accountHandler->syncChanges(true);
@@ -445,6 +585,9 @@ int main(int argc, char *argv[])
             // Send potentially urgent outgoing messages
             gameHandler->flush();
         }
+
+        // Collect the script garbage in the time left until the next tick
+        ScriptManager::collectGarbage(worldTimer.getTimeLeft());
     }
 
     LOG_INFO("Received: Quit signal, closing down...");
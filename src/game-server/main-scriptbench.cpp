@@ -0,0 +1,504 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Benchmark of the script engines. Loads the world data like the game server
+ * does, spawns monsters on a map and measures the time spent in world updates
+ * (where the monster, special and map scripts run) and in a loop calling the
+ * most frequently used read-only script bindings. Optionally, the upkeep of
+ * the attributes of a large number of beings is measured as well.
+ *
+ * Without the --engine option, the benchmark is run once for each available
+ * engine, each time in a new process since the script callbacks of the
+ * managers are bound to a single script state.
+ *
+ * When built with LuaJIT, the "lua" engine runs on LuaJIT as well, so it is
+ * run once with the JIT compiler turned off (the LuaJIT interpreter) and
+ * once with it on. Comparing with the stock Lua 5.1 interpreter takes a
+ * benchmark built without WITH_LUAJIT. Every result names the runtime it
+ * was measured with.
+ */
+
+#include "common/configuration.h"
+#include "common/permissionmanager.h"
+#include "common/resourcemanager.h"
+#include "game-server/accountconnection.h"
+#include "game-server/attributemanager.h"
+#include "game-server/gamehandler.h"
+#include "game-server/itemmanager.h"
+#include "game-server/map.h"
+#include "game-server/mapcomposite.h"
+#include "game-server/mapmanager.h"
+#include "game-server/monster.h"
+#include "game-server/monstermanager.h"
+#include "game-server/skillmanager.h"
+#include "game-server/specialmanager.h"
+#include "game-server/statusmanager.h"
+#include "game-server/postman.h"
+#include "game-server/state.h"
+#include "net/bandwidth.h"
+#include "scripting/script.h"
+#include "scripting/scriptmanager.h"
+#include "utils/logger.h"
+#include "utils/mathutils.h"
+#include "utils/processorutils.h"
+#include "utils/stringfilter.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <getopt.h>
+#include <iostream>
+#include <sstream>
+#include <physfs.h>
+
+using utils::Logger;
+
+#define DEFAULT_ITEMSDB_FILE                "items.xml"
+#define DEFAULT_EQUIPDB_FILE                "equip.xml"
+#define DEFAULT_SKILLSDB_FILE               "skills.xml"
+#define DEFAULT_ATTRIBUTEDB_FILE            "attributes.xml"
+#define DEFAULT_MAPSDB_FILE                 "maps.xml"
+#define DEFAULT_MONSTERSDB_FILE             "monsters.xml"
+#define DEFAULT_STATUSDB_FILE               "status-effects.xml"
+#define DEFAULT_PERMISSION_FILE             "permissions.xml"
+#define DEFAULT_MAIN_SCRIPT_FILE            "scripts/main.lua"
+#define DEFAULT_SPECIALSDB_FILE             "specials.xml"
+
+// The globals the game server code expects, see main-game.cpp
+utils::StringFilter *stringFilter;
+AttributeManager *attributeManager = new AttributeManager(DEFAULT_ATTRIBUTEDB_FILE);
+ItemManager *itemManager = new ItemManager(DEFAULT_ITEMSDB_FILE, DEFAULT_EQUIPDB_FILE);
+MonsterManager *monsterManager = new MonsterManager(DEFAULT_MONSTERSDB_FILE);
+SkillManager *skillManager = new SkillManager(DEFAULT_SKILLSDB_FILE);
+SpecialManager *specialManager = new SpecialManager(DEFAULT_SPECIALSDB_FILE);
+GameHandler *gameHandler;
+AccountConnection *accountHandler;
+PostMan *postMan;
+BandwidthMonitor *gBandwidth;
+
+struct BenchOptions
+{
+    BenchOptions():
+        mapId(0),
+        monsterCount(200),
+        monster("Maggot"),
+        ticks(1000),
+        iterations(2000),
+        beingCount(0),
+        noJit(false)
+    {}
+
+    std::string configPath;
+    std::string engine;
+    int mapId;              /**< 0 means the first map. */
+    int monsterCount;
+    std::string monster;
+    int ticks;
+    int iterations;
+    int beingCount;         /**< 0 skips the attribute benchmark. */
+    bool noJit;             /**< Turns the LuaJIT compiler off. */
+};
+
+static void printHelp()
+{
+    std::cout << "manaserv-scriptbench" << std::endl << std::endl
+              << "Options: " << std::endl
+              << "  -h --help           : Display this help" << std::endl
+              << "     --config <path>  : Set the config path to use."
+              << " (Default: ./manaserv.xml)" << std::endl
+              << "     --engine <name>  : Only benchmark the given script"
+              << " engine" << std::endl
+              << "     --map <id>       : Map to run on"
+              << " (Default: the first map)" << std::endl
+              << "     --monsters <n>   : Number of monsters to spawn"
+              << " (Default: 200)" << std::endl
+              << "     --monster <name> : Monster class to spawn"
+              << " (Default: Maggot)" << std::endl
+              << "     --ticks <n>      : Number of world ticks to run"
+              << " (Default: 1000)" << std::endl
+              << "     --iterations <n> : Iterations of the binding loop"
+              << " (Default: 2000)" << std::endl
+              << "     --beings <n>     : Number of beings for the attribute"
+              << " benchmark (Default: 0, skipped)" << std::endl
+#ifdef BUILD_LUAJIT
+              << "     --no-jit         : Turn the LuaJIT compiler off"
+              << std::endl
+#endif
+              ;
+    exit(EXIT_NORMAL);
+}
+
+static void parseOptions(int argc, char *argv[], BenchOptions &options)
+{
+    const char *optString = "h";
+
+    const struct option longOptions[] =
+    {
+        { "help",       no_argument,       0, 'h' },
+        { "config",     required_argument, 0, 'c' },
+        { "engine",     required_argument, 0, 'e' },
+        { "map",        required_argument, 0, 'm' },
+        { "monsters",   required_argument, 0, 'n' },
+        { "monster",    required_argument, 0, 'o' },
+        { "ticks",      required_argument, 0, 't' },
+        { "iterations", required_argument, 0, 'i' },
+        { "beings",     required_argument, 0, 'b' },
+        { "no-jit",     no_argument,       0, 'j' },
+        { 0, 0, 0, 0 }
+    };
+
+    while (optind < argc)
+    {
+        int result = getopt_long(argc, argv, optString, longOptions, NULL);
+
+        if (result == -1)
+            break;
+
+        switch (result)
+        {
+            default: // Unknown option.
+            case 'h':
+                printHelp();
+                break;
+            case 'c':
+                options.configPath = optarg;
+                break;
+            case 'e':
+                options.engine = optarg;
+                break;
+            case 'm':
+                options.mapId = atoi(optarg);
+                break;
+            case 'n':
+                options.monsterCount = atoi(optarg);
+                break;
+            case 'o':
+                options.monster = optarg;
+                break;
+            case 't':
+                options.ticks = atoi(optarg);
+                break;
+            case 'i':
+                options.iterations = atoi(optarg);
+                break;
+            case 'b':
+                options.beingCount = atoi(optarg);
+                break;
+            case 'j':
+                options.noJit = true;
+                break;
+        }
+    }
+}
+
+/**
+ * Runs the benchmark of every available engine in its own process.
+ */
+static int runAllEngines(int argc, char *argv[])
+{
+    const char *engines[] = {
+#ifdef BUILD_LUAJIT
+        "lua --no-jit",
+        "lua",
+        "luajit",
+#else
+        "lua",
+#endif
+    };
+
+    int status = 0;
+    for (unsigned i = 0; i < sizeof(engines) / sizeof(engines[0]); ++i)
+    {
+        std::ostringstream command;
+        command << '"' << argv[0] << '"';
+        for (int arg = 1; arg < argc; ++arg)
+            command << " \"" << argv[arg] << '"';
+        command << " --engine " << engines[i];
+
+        if (std::system(command.str().c_str()) != 0)
+            status = 1;
+    }
+    return status;
+}
+
+/**
+ * Describes the Lua runtime the benchmark runs on.
+ */
+static const char *runtimeName(const BenchOptions &options)
+{
+#ifdef BUILD_LUAJIT
+    if (options.noJit)
+        return "LuaJIT interpreter";
+    return options.engine == "luajit" ? "LuaJIT compiler with FFI bindings"
+                                      : "LuaJIT compiler";
+#else
+    (void) options;
+    return "Lua 5.1 interpreter";
+#endif
+}
+
+static double secondsSince(std::clock_t start)
+{
+    return double(std::clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void initializeWorld(const std::string &engine, bool noJit)
+{
+    PHYSFS_init("");
+    Logger::initialize(Configuration::getValue("log_gameServerFile",
+                                               "manaserv-scriptbench.log"));
+
+    stringFilter = new utils::StringFilter;
+
+    ResourceManager::initialize();
+    ScriptManager::initialize(engine);
+    if (!ScriptManager::currentState())
+        exit(EXIT_BAD_CONFIG_PARAMETER);
+
+    // Before any script code is loaded, so that none of it gets compiled
+    if (noJit)
+        ScriptManager::currentState()->load("if jit then jit.off() end",
+                                            "scriptbench");
+
+    if (MapManager::initialize(DEFAULT_MAPSDB_FILE) < 1)
+    {
+        LOG_FATAL("No valid map found.");
+        exit(EXIT_MAP_FILE_NOT_FOUND);
+    }
+    attributeManager->initialize();
+    skillManager->initialize();
+    specialManager->initialize();
+    itemManager->initialize();
+    monsterManager->initialize();
+    StatusManager::initialize(DEFAULT_STATUSDB_FILE);
+    PermissionManager::initialize(DEFAULT_PERMISSION_FILE);
+
+    ScriptManager::loadMainScript(
+            Configuration::getValue("script_mainFile",
+                                    DEFAULT_MAIN_SCRIPT_FILE));
+
+    gameHandler = new GameHandler;
+    accountHandler = new AccountConnection;
+    postMan = new PostMan;
+    gBandwidth = new BandwidthMonitor;
+
+    utils::math::init();
+    utils::processor::init();
+    std::srand(42);
+}
+
+static MapComposite *activateMap(int mapId)
+{
+    const MapManager::Maps &maps = MapManager::getMaps();
+    if (maps.empty())
+        return 0;
+
+    if (!mapId)
+        mapId = maps.begin()->first;
+
+    MapComposite *map = MapManager::getMap(mapId);
+    if (!map || !MapManager::activateMap(mapId))
+        return 0;
+    return map;
+}
+
+static int spawnMonsters(MapComposite *map, MonsterClass *monsterClass,
+                         int count)
+{
+    const Map *m = map->getMap();
+    const int tileWidth = m->getTileWidth();
+    const int tileHeight = m->getTileHeight();
+
+    int spawned = 0;
+    for (int attempt = 0; spawned < count && attempt < count * 100; ++attempt)
+    {
+        const int x = std::rand() % m->getWidth();
+        const int y = std::rand() % m->getHeight();
+        if (!m->getWalk(x, y))
+            continue;
+
+        Monster *monster = new Monster(monsterClass);
+        monster->setMap(map);
+        monster->setPosition(Point(x * tileWidth + tileWidth / 2,
+                                   y * tileHeight + tileHeight / 2));
+        GameState::enqueueInsert(monster);
+        ++spawned;
+    }
+    return spawned;
+}
+
+/**
+ * Measures the attribute upkeep of \a count monsters kept outside of the
+ * world, running the being part of their update for \a ticks ticks. Every
+ * tick, one in a hundred of them gets a temporary modifier lasting 50 ticks,
+ * so that about half of them carry one at any time.
+ */
+static double benchmarkAttributes(MonsterClass *monsterClass, int count,
+                                  int ticks, int &tick)
+{
+    std::vector<Monster *> monsters;
+    monsters.reserve(count);
+    for (int i = 0; i < count; ++i)
+        monsters.push_back(new Monster(monsterClass));
+
+    double updateTime = 0;
+    for (int i = 0; i < ticks; ++i)
+    {
+        GameState::update(++tick);
+
+        std::clock_t start = std::clock();
+        for (int j = 0; j < count; ++j)
+        {
+            Monster *monster = monsters[j];
+            if ((j + tick) % 100 == 0)
+                monster->applyModifier(ATTR_DEFENSE, 1, 0, 50);
+            monster->Being::update();
+        }
+        updateTime += secondsSince(start);
+    }
+
+    for (int i = 0; i < count; ++i)
+        delete monsters[i];
+    return updateTime;
+}
+
+/**
+ * Returns a script calling the bindings under test for the beings in the
+ * whole map, \a iterations times.
+ */
+static std::string bindingLoop(const Map *map, int iterations)
+{
+    const int width = map->getWidth() * map->getTileWidth();
+    const int height = map->getHeight() * map->getTileHeight();
+
+    std::ostringstream script;
+    script << "local beings = get_beings_in_circle(" << width / 2 << ", "
+           << height / 2 << ", " << std::max(width, height) << ")\n"
+           << "local sum = 0\n"
+           << "for i = 1, " << iterations << " do\n"
+           << "    for _, being in ipairs(beings) do\n"
+           << "        sum = sum + posX(being) + posY(being)\n"
+           << "              + being_get_modified_attribute(being, "
+              "ATTR_ACCURACY)\n"
+           << "    end\n"
+           << "end\n"
+           << "for i = 1, " << iterations / 10 + 1 << " do\n"
+           << "    for _, being in ipairs(beings) do\n"
+           << "        sum = sum + #get_beings_in_circle(being, 64)\n"
+           << "    end\n"
+           << "end\n";
+    return script.str();
+}
+
+int main(int argc, char *argv[])
+{
+    BenchOptions options;
+    parseOptions(argc, argv, options);
+
+    if (options.engine.empty())
+        return runAllEngines(argc, argv);
+
+    if (!Configuration::initialize(options.configPath))
+    {
+        LOG_FATAL("Refusing to run without configuration!");
+        exit(EXIT_CONFIG_NOT_FOUND);
+    }
+    Logger::setVerbosity(Logger::Error);
+
+    initializeWorld(options.engine, options.noJit);
+
+    MapComposite *map = activateMap(options.mapId);
+    if (!map)
+    {
+        LOG_FATAL("Could not activate the map to run on.");
+        exit(EXIT_MAP_FILE_NOT_FOUND);
+    }
+
+    MonsterClass *monsterClass =
+            monsterManager->getMonsterByName(options.monster);
+    if (!monsterClass)
+    {
+        LOG_FATAL("Unknown monster class \"" << options.monster << "\".");
+        exit(EXIT_BAD_CONFIG_PARAMETER);
+    }
+
+    const int spawned = spawnMonsters(map, monsterClass,
+                                      options.monsterCount);
+
+    // Let the spawned monsters enter the map before measuring
+    int tick = 0;
+    GameState::update(++tick);
+
+    // The garbage collection between the ticks is measured separately
+    double collectionTime = 0;
+    double updateTime = 0;
+    for (int i = 0; i < options.ticks; ++i)
+    {
+        std::clock_t start = std::clock();
+        GameState::update(++tick);
+        const double tickTime = secondsSince(start);
+        updateTime += tickTime;
+
+        start = std::clock();
+        ScriptManager::collectGarbage(WORLD_TICK_MS - int(tickTime * 1000));
+        collectionTime += secondsSince(start);
+    }
+
+    Script *script = ScriptManager::currentState();
+    const Script::MemoryStatistics memory = script->getMemoryStatistics();
+    script->setMap(map);
+    const std::string loop = bindingLoop(map->getMap(), options.iterations);
+
+    std::clock_t start = std::clock();
+    script->load(loop.c_str(), "scriptbench");
+    const double bindingTime = secondsSince(start);
+
+    double attributeTime = 0;
+    if (options.beingCount > 0)
+    {
+        attributeTime = benchmarkAttributes(monsterClass, options.beingCount,
+                                            options.ticks, tick);
+    }
+
+    std::cout << "engine " << options.engine
+              << " (" << runtimeName(options) << ")"
+              << ": map \"" << map->getName() << "\", "
+              << spawned << " monsters" << std::endl
+              << "  world update:   " << options.ticks << " ticks in "
+              << updateTime << " s ("
+              << (options.ticks ? updateTime * 1000 / options.ticks : 0)
+              << " ms/tick)" << std::endl
+              << "  garbage:        " << memory.collections
+              << " collections in " << collectionTime << " s between ticks, "
+              << memory.used / 1024 << " KiB used" << std::endl
+              << "  binding loop:   " << options.iterations
+              << " iterations in " << bindingTime << " s" << std::endl;
+    if (options.beingCount > 0)
+    {
+        std::cout << "  attributes:     " << options.beingCount
+                  << " beings, " << options.ticks << " ticks in "
+                  << attributeTime << " s ("
+                  << (options.ticks ? attributeTime * 1000 / options.ticks : 0)
+                  << " ms/tick)" << std::endl;
+    }
+
+    return EXIT_NORMAL;
+}
@@ -99,7 +99,8 @@ class Location
 Map::Map(int width, int height, int tileWidth, int tileHeight):
     mWidth(width), mHeight(height),
     mTileWidth(tileWidth), mTileHeight(tileHeight),
-    mMetaTiles(width * height)
+    mMetaTiles(width * height),
+    mWallRevision(0)
 {
 }
 
@@ -118,6 +119,7 @@ void Map::setSize(int width, int height)
     mHeight = height;
 
     mMetaTiles.resize(width * height);
+    ++mWallRevision;
 }
 
 const std::string &Map::getProperty(const std::string &key) const
@@ -143,6 +145,8 @@ void Map::blockTile(int x, int y, BlockType type)
         switch (type)
         {
             case BLOCKTYPE_WALL:
+                if (!(metaTile.blockmask & BLOCKMASK_WALL))
+                    ++mWallRevision;
                 metaTile.blockmask |= BLOCKMASK_WALL;
                 break;
             case BLOCKTYPE_CHARACTER:
@@ -171,6 +175,8 @@ void Map::freeTile(int x, int y, BlockType type)
         switch (type)
         {
             case BLOCKTYPE_WALL:
+                if (metaTile.blockmask & BLOCKMASK_WALL)
+                    ++mWallRevision;
                 metaTile.blockmask &= (BLOCKMASK_WALL xor 0xff);
                 break;
             case BLOCKTYPE_CHARACTER:
@@ -363,14 +369,15 @@ Path FindPath::operator() (int startX, int startY,
 
         while (pathX != startX || pathY != startY)
         {
-            // Add the new path node to the start of the path list
-            path.push_front(Point(pathX, pathY));
+            // Add the new path node, the path is reversed once complete
+            path.push_back(Point(pathX, pathY));
 
             // Find out the next parent
             PathInfo *tile = getInfo(pathX, pathY);
             pathX = tile->parentX;
             pathY = tile->parentY;
         }
+        std::reverse(path.begin(), path.end());
     }
 
     return path;
@@ -21,7 +21,6 @@
 #ifndef MAP_H
 #define MAP_H
 
-#include <list>
 #include <map>
 #include <string>
 #include <vector>
@@ -30,7 +29,7 @@
 #include "utils/point.h"
 #include "utils/string.h"
 
-typedef std::list<Point> Path;
+typedef std::vector< Point > Path;
 typedef Path::iterator PathIterator;
 enum BlockType
 {
@@ -89,6 +88,9 @@ class MapObject
         const std::string &getType() const
         { return mType; }
 
+        const utils::NameMap<std::string> &getProperties() const
+        { return mProperties; }
+
         const Rectangle &getBounds() const
         { return mBounds; }
 
@@ -132,6 +134,13 @@ class Map
          */
         void freeTile(int x, int y, BlockType type);
 
+        /**
+         * Returns a number that changes whenever a tile becomes a wall or
+         * stops being one, so that walkability information can be cached.
+         */
+        unsigned getWallRevision() const
+        { return mWallRevision; }
+
         /**
          * Gets walkability for a tile with a blocking bitmask
          */
@@ -172,6 +181,12 @@ class Map
          */
         const std::string &getProperty(const std::string &key) const;
 
+        /**
+         * Returns all the general map properties.
+         */
+        const std::map<std::string, std::string> &getProperties() const
+        { return mProperties; }
+
         /**
         * Sets a map property
         */
@@ -213,6 +228,7 @@ class Map
 
         std::vector<MetaTile> mMetaTiles;
         std::vector<MapObject*> mMapObjects;
+        unsigned mWallRevision;
 };
 
 #endif
@@ -0,0 +1,337 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "game-server/mapcache.h"
+
+#include "common/resourcemanager.h"
+#include "game-server/map.h"
+#include "utils/logger.h"
+
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#ifdef _MSC_VER
+   typedef unsigned __int32 uint32_t;
+#else
+   #include <stdint.h>
+#endif
+
+/**
+ * Identifies a compiled map file. Increase the version whenever the layout
+ * below changes.
+ */
+static const char MAGIC[8] = { 'M', 'A', 'N', 'A', 'M', 'A', 'P', 0 };
+static const uint32_t FORMAT_VERSION = 1;
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    char hash[64];          /**< Hash of the map file, as a hex string. */
+    uint32_t width, height;
+    uint32_t tileWidth, tileHeight;
+    uint32_t propertyCount;
+    uint32_t objectCount;
+    // Followed by the walls, one byte per tile padded to 4 bytes, then the
+    // properties as key and value strings, then the objects.
+};
+
+/**
+ * Appends values to a compiled map.
+ */
+class Writer
+{
+    public:
+        Writer(std::string &data): mData(data) {}
+
+        void write(const void *p, size_t size)
+        {
+            mData.append(static_cast<const char *>(p), size);
+            mData.append((4 - size % 4) % 4, '\0');
+        }
+
+        void write(uint32_t value)
+        { write(&value, sizeof(value)); }
+
+        void write(const std::string &string)
+        {
+            write(static_cast<uint32_t>(string.size()));
+            write(string.data(), string.size());
+        }
+
+    private:
+        std::string &mData;
+};
+
+/**
+ * Reads values from a compiled map, failing once it would read past its
+ * end.
+ */
+class Reader
+{
+    public:
+        Reader(const std::vector<char> &data):
+            mData(data),
+            mPosition(0),
+            mFailed(false)
+        {}
+
+        bool failed() const
+        { return mFailed; }
+
+        bool atEnd() const
+        { return mPosition == mData.size(); }
+
+        const char *read(size_t size)
+        {
+            const size_t padded = size + (4 - size % 4) % 4;
+            if (mFailed || padded > mData.size() - mPosition)
+            {
+                mFailed = true;
+                return 0;
+            }
+
+            const char *p = &mData[0] + mPosition;
+            mPosition += padded;
+            return p;
+        }
+
+        uint32_t readInt()
+        {
+            uint32_t value = 0;
+            if (const char *p = read(sizeof(value)))
+                memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        std::string readString()
+        {
+            const uint32_t size = readInt();
+            const char *p = read(size);
+            return p ? std::string(p, size) : std::string();
+        }
+
+    private:
+        const std::vector<char> &mData;
+        size_t mPosition;
+        bool mFailed;
+};
+
+std::string MapCache::getPath(const std::string &directory,
+                              const std::string &hash)
+{
+    return directory + "/" + hash + ".map";
+}
+
+Map *MapCache::load(const std::string &directory, const std::string &hash)
+{
+    const std::string path = getPath(directory, hash);
+
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if (!file)
+        return 0;
+
+    const std::vector<char> data((std::istreambuf_iterator<char>(file)),
+                                 std::istreambuf_iterator<char>());
+    file.close();
+
+    Reader reader(data);
+
+    Header header;
+    if (const char *p = reader.read(sizeof(header)))
+        memcpy(&header, p, sizeof(header));
+
+    if (reader.failed() ||
+        memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.version != FORMAT_VERSION ||
+        header.byteOrder != BYTE_ORDER_MARK ||
+        hash.compare(0, std::string::npos,
+                     header.hash, sizeof(header.hash)) != 0)
+    {
+        LOG_WARN("Ignoring compiled map " << path
+                 << " of an unknown format.");
+        return 0;
+    }
+
+    // The tiles are indexed with ints, make sure their count fits
+    if (header.width == 0 || header.height == 0 ||
+        header.width > INT_MAX / header.height)
+    {
+        LOG_WARN("Ignoring compiled map " << path << " of invalid size "
+                 << header.width << 'x' << header.height << '.');
+        return 0;
+    }
+
+    const int width = header.width;
+    const int height = header.height;
+    const char *walls = reader.read((size_t) width * height);
+    if (!walls)
+    {
+        LOG_WARN("Ignoring truncated compiled map " << path << '.');
+        return 0;
+    }
+
+    Map *map = new Map(width, height, header.tileWidth, header.tileHeight);
+
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            if (walls[x + y * width])
+                map->blockTile(x, y, BLOCKTYPE_WALL);
+        }
+    }
+
+    for (uint32_t i = 0; i < header.propertyCount && !reader.failed(); ++i)
+    {
+        const std::string key = reader.readString();
+        map->setProperty(key, reader.readString());
+    }
+
+    for (uint32_t i = 0; i < header.objectCount && !reader.failed(); ++i)
+    {
+        Rectangle bounds;
+        bounds.x = reader.readInt();
+        bounds.y = reader.readInt();
+        bounds.w = reader.readInt();
+        bounds.h = reader.readInt();
+        const std::string name = reader.readString();
+        const std::string type = reader.readString();
+
+        MapObject *object = new MapObject(bounds, name, type);
+
+        const uint32_t propertyCount = reader.readInt();
+        for (uint32_t j = 0; j < propertyCount && !reader.failed(); ++j)
+        {
+            const std::string key = reader.readString();
+            object->addProperty(key, reader.readString());
+        }
+
+        map->addObject(object);
+    }
+
+    if (reader.failed() || !reader.atEnd())
+    {
+        LOG_WARN("Ignoring truncated compiled map " << path << '.');
+        delete map;
+        return 0;
+    }
+
+    return map;
+}
+
+bool MapCache::store(const std::string &directory, const std::string &hash,
+                     const Map *map)
+{
+    if (!ResourceManager::createDirectory(directory))
+    {
+        LOG_WARN("Could not create the map cache directory " << directory
+                 << '.');
+        return false;
+    }
+
+    const int width = map->getWidth();
+    const int height = map->getHeight();
+    const std::map<std::string, std::string> &properties =
+            map->getProperties();
+    const std::vector<MapObject*> &objects = map->getObjects();
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = FORMAT_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    hash.copy(header.hash, sizeof(header.hash));
+    header.width = width;
+    header.height = height;
+    header.tileWidth = map->getTileWidth();
+    header.tileHeight = map->getTileHeight();
+    header.propertyCount = properties.size();
+    header.objectCount = objects.size();
+
+    std::string data;
+    Writer writer(data);
+    writer.write(&header, sizeof(header));
+
+    std::vector<char> walls(width * height);
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+            walls[x + y * width] = !map->getWalk(x, y, Map::BLOCKMASK_WALL);
+    }
+    if (!walls.empty())
+        writer.write(&walls[0], walls.size());
+
+    for (std::map<std::string, std::string>::const_iterator
+         it = properties.begin(), it_end = properties.end();
+         it != it_end; ++it)
+    {
+        writer.write(it->first);
+        writer.write(it->second);
+    }
+
+    for (std::vector<MapObject*>::const_iterator it = objects.begin(),
+         it_end = objects.end(); it != it_end; ++it)
+    {
+        const MapObject *object = *it;
+        const Rectangle &bounds = object->getBounds();
+        writer.write(static_cast<uint32_t>(bounds.x));
+        writer.write(static_cast<uint32_t>(bounds.y));
+        writer.write(static_cast<uint32_t>(bounds.w));
+        writer.write(static_cast<uint32_t>(bounds.h));
+        writer.write(object->getName());
+        writer.write(object->getType());
+
+        const utils::NameMap<std::string> &objectProperties =
+                object->getProperties();
+        writer.write(static_cast<uint32_t>(objectProperties.size()));
+        for (utils::NameMap<std::string>::const_iterator
+             i = objectProperties.begin(), i_end = objectProperties.end();
+             i != i_end; ++i)
+        {
+            writer.write(i->first);
+            writer.write(i->second);
+        }
+    }
+
+    // Written under a temporary name first, so that a server starting at the
+    // same time never reads a partial map.
+    const std::string path = getPath(directory, hash);
+    const std::string temporaryPath = path + ".tmp";
+    std::ofstream file(temporaryPath.c_str(),
+                       std::ios::out | std::ios::binary | std::ios::trunc);
+    file.write(data.data(), data.size());
+    file.close();
+
+    if (!file || std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+    {
+        LOG_WARN("Could not write the compiled map " << path << '.');
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,63 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MAPCACHE_H
+#define MAPCACHE_H
+
+#include <string>
+
+class Map;
+
+/**
+ * A directory of compiled maps, holding everything the server reads from a
+ * map file: its size, the walls of the collision layer, the properties and
+ * the objects.
+ *
+ * Each compiled map is stored in a file named after the SHA-256 hash of the
+ * map file it was compiled from, so that an edited map simply misses the
+ * cache. The file starts with a header identifying the format version and
+ * the byte order, followed by flat arrays of 32-bit values and
+ * length-prefixed strings, all aligned on 4 bytes.
+ */
+class MapCache
+{
+    public:
+        /**
+         * Loads the map compiled from a map file with the given hash.
+         *
+         * @return the map when the cache holds a valid entry, 0 otherwise.
+         */
+        static Map *load(const std::string &directory,
+                         const std::string &hash);
+
+        /**
+         * Compiles the map into the cache, under the hash of the map file it
+         * was read from. The cache directory is created when needed.
+         */
+        static bool store(const std::string &directory,
+                          const std::string &hash,
+                          const Map *map);
+
+    private:
+        static std::string getPath(const std::string &directory,
+                                   const std::string &hash);
+};
+
+#endif // MAPCACHE_H
@@ -32,6 +32,7 @@
 #include "game-server/mapreader.h"
 #include "game-server/monstermanager.h"
 #include "game-server/spawnarea.h"
+#include "game-server/state.h"
 #include "game-server/trigger.h"
 #include "scripting/script.h"
 #include "scripting/scriptmanager.h"
@@ -148,12 +149,37 @@ static void addZone(MapRegion &r, unsigned z)
     }
 }
 
+ZoneIterator::ZoneIterator()
+  : pos(0),
+    x(0), y(0),
+    minX(0), maxX(-1), maxY(-1),
+    current(NULL),
+    map(NULL)
+{
+}
+
 ZoneIterator::ZoneIterator(const MapRegion &r, const MapContent *m)
-  : region(r), pos(0), map(m)
+  : region(r), pos(0),
+    x(0), y(0),
+    minX(0), maxX(m->mapWidth - 1), maxY(m->mapHeight - 1),
+    map(m)
 {
     current = &map->zones[r.empty() ? 0 : r[0]];
 }
 
+ZoneIterator::ZoneIterator(int minX, int minY, int maxX, int maxY,
+                           const MapContent *m)
+  : pos(0),
+    x(minX), y(minY),
+    minX(minX), maxX(maxX), maxY(maxY),
+    map(m)
+{
+    if (minX <= maxX && minY <= maxY)
+        current = &map->zones[x + y * map->mapWidth];
+    else
+        current = NULL;
+}
+
 void ZoneIterator::operator++()
 {
     current = NULL;
@@ -166,9 +192,14 @@ void ZoneIterator::operator++()
     }
     else
     {
-        if (++pos != (unsigned)map->mapWidth * map->mapHeight)
+        if (++x > maxX)
         {
-            current = &map->zones[pos];
+            x = minX;
+            ++y;
+        }
+        if (y <= maxY)
+        {
+            current = &map->zones[x + y * map->mapWidth];
         }
     }
 }
@@ -431,19 +462,14 @@ void MapContent::fillRegion(MapRegion &r, const Point &p, int radius) const
     }
 }
 
-void MapContent::fillRegion(MapRegion &r, const Rectangle &p) const
+ZoneIterator MapContent::getZoneIterator(int x1, int y1,
+                                        int x2, int y2) const
 {
-    int ax = p.x / zoneDiam,
-        ay = p.y / zoneDiam,
-        bx = std::min((p.x + p.w) / zoneDiam, mapWidth - 1),
-        by = std::min((p.y + p.h) / zoneDiam, mapHeight - 1);
-    for (int y = ay; y <= by; ++y)
-    {
-        for (int x = ax; x <= bx; ++x)
-        {
-            addZone(r, x + y * mapWidth);
-        }
-    }
+    return ZoneIterator(std::max(x1, 0) / zoneDiam,
+                        std::max(y1, 0) / zoneDiam,
+                        std::min(x2 / zoneDiam, mapWidth - 1),
+                        std::min(y2 / zoneDiam, mapHeight - 1),
+                        this);
 }
 
 MapZone& MapContent::getZone(const Point &pos) const
@@ -451,17 +477,158 @@ MapZone& MapContent::getZone(const Point &pos) const
     return zones[(pos.x / zoneDiam) + (pos.y / zoneDiam) * mapWidth];
 }
 
+/**
+ * Moves the last element of an array to the given slot.
+ */
+template< typename T >
+static void moveLast(std::vector< T > &v, unsigned slot)
+{
+    v[slot] = v.back();
+    v.pop_back();
+}
+
+void MapMovement::add(Being *being, unsigned zone)
+{
+    being->setMovementSlot(beings.size());
+    beings.push_back(being);
+    x.push_back(0);
+    y.push_back(0);
+    oldX.push_back(0);
+    oldY.push_back(0);
+    dstX.push_back(0);
+    dstY.push_back(0);
+    standing.push_back(0);
+    zones.push_back(zone);
+    update(being);
+}
+
+void MapMovement::remove(Being *being)
+{
+    const unsigned slot = being->getMovementSlot();
+    assert(slot < beings.size() && beings[slot] == being);
+
+    moveLast(beings, slot);
+    moveLast(x, slot);
+    moveLast(y, slot);
+    moveLast(oldX, slot);
+    moveLast(oldY, slot);
+    moveLast(dstX, slot);
+    moveLast(dstY, slot);
+    moveLast(standing, slot);
+    moveLast(zones, slot);
+
+    if (slot < beings.size())
+        beings[slot]->setMovementSlot(slot);
+    being->setMovementSlot(-1);
+}
+
+void MapMovement::update(const Being *being)
+{
+    const unsigned slot = being->getMovementSlot();
+    const Point &pos = being->getPosition(),
+                &old = being->getOldPosition(),
+                &dst = being->getDestination();
+    x[slot] = pos.x;
+    y[slot] = pos.y;
+    oldX[slot] = old.x;
+    oldY[slot] = old.y;
+    dstX[slot] = dst.x;
+    dstY[slot] = dst.y;
+    standing[slot] = being->getAction() == STAND;
+}
+
+void MapMovement::clear()
+{
+    for (std::vector< Being * >::const_iterator i = beings.begin(),
+         i_end = beings.end(); i != i_end; ++i)
+    {
+        (*i)->setMovementSlot(-1);
+    }
+
+    beings.clear();
+    x.clear();
+    y.clear();
+    oldX.clear();
+    oldY.clear();
+    dstX.clear();
+    dstY.clear();
+    standing.clear();
+    zones.clear();
+}
+
 
 /******************************************************************************
  * MapComposite
  *****************************************************************************/
 
+/**
+ * Tells the trigger areas of a zone about a being that was inserted on the
+ * map.
+ */
+static void enterTriggers(const MapZone &zone, Actor *obj)
+{
+    const Point &pos = obj->getPosition();
+    for (std::vector< TriggerArea * >::const_iterator i = zone.triggers.begin(),
+         i_end = zone.triggers.end(); i != i_end; ++i)
+    {
+        if ((*i)->getZone().contains(pos))
+            (*i)->enter(obj);
+    }
+}
+
+/**
+ * Makes a being that is removed from the map leave the trigger areas of its
+ * zone.
+ */
+static void leaveTriggers(const MapZone &zone, Actor *obj)
+{
+    for (std::vector< TriggerArea * >::const_iterator i = zone.triggers.begin(),
+         i_end = zone.triggers.end(); i != i_end; ++i)
+    {
+        (*i)->leave(obj);
+    }
+}
+
+/**
+ * Tells the trigger areas of a zone about a being crossing their border.
+ * Areas also registered with the zone to skip are left alone, so that a
+ * being changing zones is only checked once per area.
+ */
+static void moveThroughTriggers(const MapZone &zone, const MapZone *skip,
+                                Being *obj)
+{
+    const Point &pos1 = obj->getOldPosition(),
+                &pos2 = obj->getPosition();
+
+    for (std::vector< TriggerArea * >::const_iterator i = zone.triggers.begin(),
+         i_end = zone.triggers.end(); i != i_end; ++i)
+    {
+        const Rectangle &r = (*i)->getZone();
+        const bool wasInside = r.contains(pos1);
+        if (wasInside == r.contains(pos2))
+            continue;
+
+        if (skip && std::find(skip->triggers.begin(), skip->triggers.end(),
+                              *i) != skip->triggers.end())
+            continue;
+
+        if (wasInside)
+            (*i)->leave(obj);
+        else
+            (*i)->enter(obj);
+    }
+}
+
 Script::Ref MapComposite::mInitializeCallback;
 Script::Ref MapComposite::mUpdateCallback;
 
 MapComposite::MapComposite(int id, const std::string &name):
     mMap(NULL),
     mContent(NULL),
+    mContentInitialized(false),
+    mCharacterCount(0),
+    mIdleTicks(0),
+    mHibernations(0),
     mName(name),
     mID(id)
 {
@@ -473,20 +640,23 @@ MapComposite::~MapComposite()
     delete mContent;
 }
 
-bool MapComposite::activate()
+Map *MapComposite::readMap() const
 {
-    assert(!isActive());
-
     std::string file = "maps/" + mName + ".tmx";
     if (!ResourceManager::exists(file))
         file += ".gz";
 
-    mMap = MapReader::readMap(file);
+    return MapReader::readMap(file);
+}
+
+bool MapComposite::activate(Map *map)
+{
+    assert(!isActive());
+
+    mMap = map ? map : readMap();
     if (!mMap)
         return false;
 
-    initializeContent();
-
     std::string sPvP = mMap->getProperty("pvp");
     if (sPvP.empty())
         sPvP = Configuration::getValue("game_defaultPvp", std::string());
@@ -496,44 +666,129 @@ bool MapComposite::activate()
     else
         mPvPRules = PVP_NONE;
 
-    if (!mInitializeCallback.isValid())
+    return true;
+}
+
+void MapComposite::wakeUp()
+{
+    assert(isHibernating());
+
+    mContent = new MapContent(mMap);
+    mIdleTicks = 0;
+
+    std::vector< Entity * > entities;
+    entities.swap(mHibernatedEntities);
+
+    if (!mContentInitialized)
     {
-        LOG_WARN("No callback for map initialization found");
+        mContentInitialized = true;
+        initializeContent();
+
+        if (!mInitializeCallback.isValid())
+        {
+            LOG_WARN("No callback for map initialization found");
+        }
+        else
+        {
+            Script *s = ScriptManager::currentState();
+            s->setMap(this);
+            s->prepare(mInitializeCallback);
+            s->execute();
+        }
     }
     else
     {
-        Script *s = ScriptManager::currentState();
-        s->setMap(this);
-        s->prepare(mInitializeCallback);
-        s->execute();
+        LOG_INFO("Map \"" << mName << "\" woke up with " << entities.size()
+                 << " entities.");
     }
 
-    return true;
+    // These either were on the map before or do not need a public ID, so
+    // they fit again. Like GameState::insert, let them know, which also
+    // registers the trigger areas with the new zones.
+    for (std::vector< Entity * >::iterator i = entities.begin(),
+         i_end = entities.end(); i != i_end; ++i)
+    {
+        if (insert(*i))
+            (*i)->inserted();
+    }
+}
+
+void MapComposite::hibernate()
+{
+    assert(mContent && mCharacterCount == 0);
+
+    // Nobody will miss the effects and the monsters of the spawn areas, which
+    // spawn new ones. Other monsters, like those created by scripts, are
+    // kept with the rest.
+    std::vector< Entity * > discarded;
+    const std::vector< Entity * > entities = mContent->entities;
+    for (std::vector< Entity * >::const_iterator i = entities.begin(),
+         i_end = entities.end(); i != i_end; ++i)
+    {
+        const EntityType type = (*i)->getType();
+        if (type == OBJECT_EFFECT ||
+            (type == OBJECT_MONSTER && SpawnArea::isSpawned(*i)))
+        {
+            GameState::remove(*i);
+            discarded.push_back(*i);
+        }
+    }
+
+    for (std::vector< Entity * >::iterator i = discarded.begin(),
+         i_end = discarded.end(); i != i_end; ++i)
+    {
+        delete *i;
+    }
+
+    mHibernatedEntities.insert(mHibernatedEntities.end(),
+                               mContent->entities.begin(),
+                               mContent->entities.end());
+
+    // The kept beings do not move while hibernating
+    mContent->movement.clear();
+
+    delete mContent;
+    mContent = NULL;
+    ++mHibernations;
+
+    LOG_INFO("Map \"" << mName << "\" hibernates, discarded "
+             << discarded.size() << " and kept " << mHibernatedEntities.size()
+             << " entities.");
+}
+
+void MapComposite::insertHibernating(Entity *ptr)
+{
+    assert(isHibernating());
+    mHibernatedEntities.push_back(ptr);
 }
 
 ZoneIterator MapComposite::getAroundPointIterator(const Point &p, int radius) const
 {
-    MapRegion r;
-    mContent->fillRegion(r, p, radius);
-    return ZoneIterator(r, mContent);
+    if (!mContent)
+        return ZoneIterator();
+
+    return mContent->getZoneIterator(p.x - radius, p.y - radius,
+                                     p.x + radius, p.y + radius);
 }
 
 ZoneIterator MapComposite::getAroundActorIterator(Actor *obj, int radius) const
 {
-    MapRegion r;
-    mContent->fillRegion(r, obj->getPosition(), radius);
-    return ZoneIterator(r, mContent);
+    return getAroundPointIterator(obj->getPosition(), radius);
 }
 
 ZoneIterator MapComposite::getInsideRectangleIterator(const Rectangle &p) const
 {
-    MapRegion r;
-    mContent->fillRegion(r, p);
-    return ZoneIterator(r, mContent);
+    if (!mContent)
+        return ZoneIterator();
+
+    return mContent->getZoneIterator(p.x, p.y, p.x + p.w, p.y + p.h);
 }
 
 ZoneIterator MapComposite::getAroundBeingIterator(Being *obj, int radius) const
 {
+    if (!mContent)
+        return ZoneIterator();
+
     MapRegion r1;
     mContent->fillRegion(r1, obj->getOldPosition(), radius);
     MapRegion r2 = r1;
@@ -567,9 +822,20 @@ bool MapComposite::insert(Entity *ptr)
         }
 
         Actor *obj = static_cast< Actor * >(ptr);
-        mContent->getZone(obj->getPosition()).insert(obj);
+        MapZone &zone = mContent->getZone(obj->getPosition());
+        zone.insert(obj);
+
+        if (ptr->canMove())
+        {
+            mContent->movement.add(static_cast< Being * >(ptr),
+                                   &zone - mContent->zones);
+            enterTriggers(zone, obj);
+        }
     }
 
+    if (ptr->getType() == OBJECT_CHARACTER)
+        ++mCharacterCount;
+
     ptr->setMap(this);
     mContent->entities.push_back(ptr);
     return true;
@@ -577,6 +843,14 @@ bool MapComposite::insert(Entity *ptr)
 
 void MapComposite::remove(Entity *ptr)
 {
+    if (!mContent)
+    {
+        mHibernatedEntities.erase(std::remove(mHibernatedEntities.begin(),
+                                              mHibernatedEntities.end(), ptr),
+                                  mHibernatedEntities.end());
+        return;
+    }
+
     for (std::vector<Entity*>::iterator i = mContent->entities.begin(),
          i_end = mContent->entities.end(); i != i_end; ++i)
     {
@@ -590,6 +864,8 @@ void MapComposite::remove(Entity *ptr)
         }
         if (*i == ptr)
         {
+            if (ptr->getType() == OBJECT_CHARACTER)
+                --mCharacterCount;
             i = mContent->entities.erase(i);
         }
     }
@@ -597,10 +873,13 @@ void MapComposite::remove(Entity *ptr)
     if (ptr->isVisible())
     {
         Actor *obj = static_cast< Actor * >(ptr);
-        mContent->getZone(obj->getPosition()).remove(obj);
+        MapZone &zone = mContent->getZone(obj->getPosition());
+        zone.remove(obj);
 
         if (ptr->canMove())
         {
+            leaveTriggers(zone, obj);
+            mContent->movement.remove(static_cast< Being * >(ptr));
             mContent->deallocate(static_cast< Being * >(ptr));
         }
     }
@@ -608,6 +887,8 @@ void MapComposite::remove(Entity *ptr)
 
 void MapComposite::update()
 {
+    mIdleTicks = mCharacterCount ? 0 : mIdleTicks + 1;
+
     // Update object status
     const std::vector< Entity * > &entities = getEverything();
     for (std::vector< Entity * >::const_iterator it = entities.begin(),
@@ -625,43 +906,111 @@ void MapComposite::update()
         s->execute();
     }
 
-    // Move objects around and update zones.
-    for (BeingIterator it(getWholeMapIterator()); it; ++it)
+    // Move objects around. Beings standing at their destination are skipped
+    // without being looked at.
+    MapMovement &movement = mContent->movement;
+    for (unsigned i = 0; i < movement.size(); ++i)
     {
-        (*it)->move();
+        if (movement.standing[i] &&
+            movement.x[i] == movement.dstX[i] &&
+            movement.y[i] == movement.dstY[i])
+        {
+            continue;
+        }
+        movement.beings[i]->move();
     }
 
-    for (int i = 0; i < mContent->mapHeight * mContent->mapWidth; ++i)
+    MapRegion &departedZones = mContent->departedZones;
+    for (MapRegion::const_iterator i = departedZones.begin(),
+         i_end = departedZones.end(); i != i_end; ++i)
     {
-        mContent->zones[i].destinations.clear();
+        mContent->zones[*i].destinations.clear();
     }
+    departedZones.clear();
 
-    // Cannot use a WholeMap iterator as objects will change zones under its feet.
-    for (std::vector< Entity * >::iterator i = mContent->entities.begin(),
-         i_end = mContent->entities.end(); i != i_end; ++i)
-    {
-        if (!(*i)->canMove())
-            continue;
+    const unsigned count = movement.size();
+    if (!count)
+        return;
 
-        Being *obj = static_cast< Being * >(*i);
+    // Compute the zones of all the beings in one go, without any branch so
+    // that the compiler can vectorize it. Positions are never negative.
+    movement.newZones.resize(count);
+    movement.moved.resize(count);
+    const int *x = &movement.x[0], *y = &movement.y[0];
+    const int *oldX = &movement.oldX[0], *oldY = &movement.oldY[0];
+    unsigned *newZones = &movement.newZones[0];
+    char *moved = &movement.moved[0];
+    const unsigned mapWidth = mContent->mapWidth;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        newZones[i] = unsigned(y[i]) / zoneDiam * mapWidth
+                    + unsigned(x[i]) / zoneDiam;
+        moved[i] = (x[i] != oldX[i]) | (y[i] != oldY[i]);
+    }
 
-        const Point &pos1 = obj->getOldPosition(),
-                    &pos2 = obj->getPosition();
+    // Only the beings that moved need their zone and triggers updated
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (!moved[i])
+            continue;
 
-        MapZone &src = mContent->getZone(pos1),
-                &dst = mContent->getZone(pos2);
-        if (&src != &dst)
+        Being *obj = movement.beings[i];
+        const unsigned srcZone = movement.zones[i];
+        MapZone &src = mContent->zones[srcZone];
+        if (newZones[i] != srcZone)
         {
-            addZone(src.destinations, &dst - mContent->zones);
+            MapZone &dst = mContent->zones[newZones[i]];
+            if (src.destinations.empty())
+                departedZones.push_back(srcZone);
+            addZone(src.destinations, newZones[i]);
             src.remove(obj);
             dst.insert(obj);
+            movement.zones[i] = newZones[i];
+
+            moveThroughTriggers(src, 0, obj);
+            moveThroughTriggers(dst, &src, obj);
         }
+        else
+        {
+            moveThroughTriggers(src, 0, obj);
+        }
+    }
+}
+
+void MapComposite::addTrigger(TriggerArea *trigger)
+{
+    const Rectangle &r = trigger->getZone();
+    for (ZoneIterator i(getInsideRectangleIterator(r)); i; ++i)
+    {
+        (*i)->triggers.push_back(trigger);
+    }
+
+    // Beings already standing in the area enter it right away
+    for (BeingIterator i(getInsideRectangleIterator(r)); i; ++i)
+    {
+        if (r.contains((*i)->getPosition()))
+            trigger->enter(*i);
+    }
+}
+
+void MapComposite::removeTrigger(TriggerArea *trigger)
+{
+    // Hibernating maps have no zones, the trigger gets registered again
+    // when it is inserted on wake up
+    if (!mContent)
+        return;
+
+    for (ZoneIterator i(getInsideRectangleIterator(trigger->getZone())); i; ++i)
+    {
+        std::vector< TriggerArea * > &triggers = (*i)->triggers;
+        triggers.erase(std::remove(triggers.begin(), triggers.end(), trigger),
+                       triggers.end());
     }
 }
 
 const std::vector< Entity * > &MapComposite::getEverything() const
 {
-    return mContent->entities;
+    return mContent ? mContent->entities : mHibernatedEntities;
 }
 
 
@@ -728,8 +1077,6 @@ void MapComposite::callWorldVariableCallback(const std::string &key,
  */
 void MapComposite::initializeContent()
 {
-    mContent = new MapContent(mMap);
-
     const std::vector<MapObject*> &objects = mMap->getObjects();
 
     for (size_t i = 0; i < objects.size(); ++i)
@@ -748,8 +1095,11 @@ void MapComposite::initializeContent()
                 if (MapComposite *destMap = MapManager::getMap(destMapName))
                 {
                     WarpAction *action = new WarpAction(destMap, destX, destY);
-                    insert(new TriggerArea(this, object->getBounds(),
-                                           action, false));
+                    TriggerArea *area = new TriggerArea(this,
+                                                        object->getBounds(),
+                                                        action, false);
+                    insert(area);
+                    area->inserted();
                 }
             }
             else
@@ -762,6 +1112,7 @@ void MapComposite::initializeContent()
             MonsterClass *monster = 0;
             int maxBeings = utils::stringToInt(object->getProperty("MAX_BEINGS"));
             int spawnRate = utils::stringToInt(object->getProperty("SPAWN_RATE"));
+            int spawnBatch = utils::stringToInt(object->getProperty("SPAWN_BATCH"));
             std::string monsterName = object->getProperty("MONSTER_ID");
             int monsterId = utils::stringToInt(monsterName);
 
@@ -787,7 +1138,7 @@ void MapComposite::initializeContent()
             if (monster && maxBeings && spawnRate)
             {
                 insert(new SpawnArea(this, monster, object->getBounds(),
-                                     maxBeings, spawnRate));
+                                     maxBeings, spawnRate, spawnBatch));
             }
         }
         else if (utils::compareStrI(type, "NPC") == 0)
@@ -36,6 +36,7 @@ class MapComposite;
 class Point;
 class Rectangle;
 class Entity;
+class TriggerArea;
 
 struct MapContent;
 struct MapZone;
@@ -57,12 +58,29 @@ typedef std::vector< unsigned > MapRegion;
  */
 struct ZoneIterator
 {
-    MapRegion region; /**< Zones to visit. Empty means the entire map. */
+    MapRegion region; /**< Zones to visit. Empty means the zone bounds. */
     unsigned pos;
+    int x, y;                   /**< Current zone, when visiting the bounds. */
+    int minX, maxX, maxY;       /**< Inclusive zone bounds. */
     MapZone *current;
     const MapContent *map;
 
+    /**
+     * Visits no zone at all.
+     */
+    ZoneIterator();
+
+    /**
+     * Visits the zones of the given region, or all the zones of the map when
+     * the region is empty.
+     */
     ZoneIterator(const MapRegion &, const MapContent *);
+
+    /**
+     * Visits the zones within the given inclusive bounds, in the same order
+     * as a region would.
+     */
+    ZoneIterator(int minX, int minY, int maxX, int maxY, const MapContent *);
     void operator++();
     MapZone *operator*() const { return current; }
     operator bool() const { return current; }
@@ -148,6 +166,11 @@ struct MapZone
      */
     MapRegion destinations;
 
+    /**
+     * Trigger areas overlapping this zone.
+     */
+    std::vector< TriggerArea * > triggers;
+
     MapZone(): nbCharacters(0), nbMovingObjects(0) {}
     void insert(Actor *);
     void remove(Actor *);
@@ -171,6 +194,49 @@ struct ObjectBucket
     void deallocate(int);
 };
 
+/**
+ * Movement state of the beings on a map, kept as one array per field so that
+ * the movement and zone change passes of MapComposite::update() run through
+ * contiguous memory instead of visiting every being. The beings remain the
+ * reference: they copy their state to their slot whenever it changes.
+ */
+struct MapMovement
+{
+    /**
+     * Lists a being that was inserted in the given zone.
+     */
+    void add(Being *, unsigned zone);
+
+    /**
+     * Unlists a being. The last slot takes its place.
+     */
+    void remove(Being *);
+
+    /**
+     * Copies the current state of a listed being to its slot.
+     */
+    void update(const Being *);
+
+    /**
+     * Unlists all the beings.
+     */
+    void clear();
+
+    unsigned size() const
+    { return beings.size(); }
+
+    std::vector< Being * > beings;
+    std::vector< int > x, y;        /**< Current positions. */
+    std::vector< int > oldX, oldY;  /**< Positions before the last move. */
+    std::vector< int > dstX, dstY;  /**< Destinations. */
+    std::vector< char > standing;   /**< Whether the action is STAND. */
+    std::vector< unsigned > zones;  /**< Zones the beings are listed in. */
+
+    /** Scratch arrays of the zone change pass. */
+    std::vector< unsigned > newZones;
+    std::vector< char > moved;
+};
+
 /**
  * Entities on a map.
  */
@@ -195,9 +261,10 @@ struct MapContent
     void fillRegion(MapRegion &, const Point &, int) const;
 
     /**
-     * Fills a region of zones inside a rectangle.
+     * Gets an iterator over the zones overlapping the given inclusive pixel
+     * bounds. Unlike a filled region, it does not need any allocation.
      */
-    void fillRegion(MapRegion &, const Rectangle &) const;
+    ZoneIterator getZoneIterator(int x1, int y1, int x2, int y2) const;
 
     /**
      * Gets zone at given position.
@@ -209,6 +276,17 @@ struct MapContent
      */
     std::vector< Entity * > entities;
 
+    /**
+     * Movement state of the beings located on the map.
+     */
+    MapMovement movement;
+
+    /**
+     * Zones that got destinations during the last update, so that only
+     * those need to be cleared.
+     */
+    MapRegion departedZones;
+
     /**
      * Buckets of MovingObjects located on the map, referenced by ID.
      */
@@ -235,13 +313,47 @@ class MapComposite
         ~MapComposite();
 
         /**
-         * Loads the map and initializes the map content. Should only be called
-         * once!
+         * Reads the map file. This does not touch the rest of the server, so
+         * it may be called from any thread, also for several maps at once.
+         *
+         * @return the map, or 0 when it could not be read.
+         */
+        Map *readMap() const;
+
+        /**
+         * Loads the map, so that it can be hosted on this server. The map
+         * content is only initialized by the first call to wakeUp(). Should
+         * only be called once!
+         *
+         * @param map the map when it was read beforehand with readMap(). The
+         *            map composite takes ownership of it.
          *
          * @return <code>true</code> when succesful, <code>false</code> when
          *         an error occurred.
          */
-        bool activate();
+        bool activate(Map *map = 0);
+
+        /**
+         * Loads the content of a hibernating map. The first time, this
+         * initializes the content from the map file and the map scripts.
+         * Afterwards, it brings back the entities kept by hibernate().
+         */
+        void wakeUp();
+
+        /**
+         * Unloads the content of a map without characters. The monsters of
+         * the spawn areas and the effects are discarded, the spawn areas
+         * repopulate the map once it wakes up. The other entities (NPCs,
+         * monsters created by scripts, floor items, spawn areas, triggers...)
+         * are kept aside and do not get updated meanwhile.
+         */
+        void hibernate();
+
+        /**
+         * Adds an entity to a hibernating map without waking it up. It gets
+         * inserted along with the rest of the content when the map wakes up.
+         */
+        void insertHibernating(Entity *);
 
         /**
          * Gets the underlying pathfinding map.
@@ -255,6 +367,35 @@ class MapComposite
         bool isActive() const
         { return mMap; }
 
+        /**
+         * Returns whether the map is active but its content is not loaded,
+         * either because nobody entered it yet or because it hibernates.
+         */
+        bool isHibernating() const
+        { return mMap && !mContent; }
+
+        /**
+         * Gets the movement store of the beings on the map, or 0 while it
+         * hibernates.
+         */
+        MapMovement *getMovement() const
+        { return mContent ? &mContent->movement : 0; }
+
+        /**
+         * Gets the number of ticks the map has been updated without any
+         * character on it.
+         */
+        int getIdleTicks() const
+        { return mIdleTicks; }
+
+        /**
+         * Gets the number of times the map hibernated. Iterations over the
+         * content that last longer than a tick compare it to find out that
+         * the content they were visiting is gone.
+         */
+        unsigned getHibernationCount() const
+        { return mHibernations; }
+
         /**
          * Gets the game ID of this map.
          */
@@ -277,6 +418,17 @@ class MapComposite
          */
         void remove(Entity *);
 
+        /**
+         * Registers a trigger area with the zones it overlaps, so that it
+         * gets notified about the beings entering and leaving it.
+         */
+        void addTrigger(TriggerArea *);
+
+        /**
+         * Unregisters a trigger area.
+         */
+        void removeTrigger(TriggerArea *);
+
         /**
          * Updates zones of every moving beings.
          */
@@ -291,7 +443,8 @@ class MapComposite
          * Gets an iterator on the objects of the whole map.
          */
         ZoneIterator getWholeMapIterator() const
-        { return ZoneIterator(MapRegion(), mContent); }
+        { return mContent ? ZoneIterator(MapRegion(), mContent)
+                          : ZoneIterator(); }
 
         /**
          * Gets an iterator on the objects inside a given rectangle.
@@ -315,7 +468,8 @@ class MapComposite
         ZoneIterator getAroundBeingIterator(Being *, int radius) const;
 
         /**
-         * Gets everything related to the map.
+         * Gets everything related to the map, including what is kept aside
+         * while it hibernates.
          */
         const std::vector< Entity * > &getEverything() const;
 
@@ -368,6 +522,13 @@ class MapComposite
 
         Map *mMap;            /**< Actual map. */
         MapContent *mContent; /**< Entities on the map. */
+        bool mContentInitialized; /**< Whether the map ever woke up. */
+        int mCharacterCount;  /**< Characters on the map. */
+        int mIdleTicks;       /**< Updates without characters. */
+        unsigned mHibernations;
+
+        /** Entities kept aside while hibernating. */
+        std::vector< Entity * > mHibernatedEntities;
         std::string mName;    /**< Name of the map. */
         unsigned short mID;   /**< ID of the map. */
         /** Cached persistent variables */
@@ -21,19 +21,97 @@
 
 #include "game-server/mapmanager.h"
 
+#include "common/configuration.h"
+#include "common/defines.h"
 #include "common/resourcemanager.h"
 #include "game-server/map.h"
 #include "game-server/mapcomposite.h"
 #include "utils/logger.h"
+#include "utils/thread.h"
 #include "utils/xml.h"
 
+#include <algorithm>
 #include <cassert>
+#include <vector>
+
+#include <sys/time.h>
 
 /**
  * List of all the game maps, be they present or not on this server.
  */
 static MapManager::Maps maps;
 
+/**
+ * Maps read ahead of their activation, by map ID.
+ */
+static std::map< int, Map * > preloadedMaps;
+
+/**
+ * Statistics about the activation of the preloaded maps, in microseconds.
+ */
+static uint64_t preloadTime = 0;
+static uint64_t preloadReadTime = 0;
+static uint64_t preloadActivationTime = 0;
+static int preloadThreadCount = 0;
+static int preloadActivatedCount = 0;
+
+/**
+ * Number of ticks a map stays loaded without characters, or 0 when maps are
+ * loaded as soon as they are activated and never hibernate.
+ */
+static int hibernationTicks = 0;
+
+static void readHibernationTime()
+{
+    hibernationTicks = Configuration::getValue("map_hibernateTime", 0)
+                       * 1000 / WORLD_TICK_MS;
+}
+
+static void configurationChanged(const std::string &key)
+{
+    if (key == "map_hibernateTime")
+        readHibernationTime();
+}
+
+static uint64_t getTime()
+{
+    timeval time;
+    gettimeofday(&time, 0);
+    return (uint64_t)time.tv_sec * 1000000 + time.tv_usec;
+}
+
+/**
+ * The maps to be read by the preloading threads.
+ */
+struct PreloadQueue
+{
+    std::vector< MapComposite * > composites;
+    std::vector< Map * > results;
+    std::vector< uint64_t > times;
+    size_t next;
+    utils::Mutex mutex;
+};
+
+static void preloadWorker(void *data)
+{
+    PreloadQueue *queue = static_cast< PreloadQueue * >(data);
+
+    for (;;)
+    {
+        size_t index;
+        {
+            utils::MutexLocker lock(&queue->mutex);
+            if (queue->next == queue->composites.size())
+                return;
+            index = queue->next++;
+        }
+
+        const uint64_t start = getTime();
+        queue->results[index] = queue->composites[index]->readMap();
+        queue->times[index] = getTime() - start;
+    }
+}
+
 const MapManager::Maps &MapManager::getMaps()
 {
     return maps;
@@ -54,6 +132,9 @@ int MapManager::initialize(const std::string &mapReferenceFile)
         return loadedMaps;
     }
 
+    readHibernationTime();
+    Configuration::addListener(&configurationChanged);
+
     LOG_INFO("Loading map reference: " << mapReferenceFile);
     for_each_xml_child_node(node, rootNode)
     {
@@ -105,6 +186,15 @@ int MapManager::initialize(const std::string &mapReferenceFile)
 
 void MapManager::deinitialize()
 {
+    Configuration::removeListener(&configurationChanged);
+
+    for (std::map< int, Map * >::iterator i = preloadedMaps.begin(),
+         i_end = preloadedMaps.end(); i != i_end; ++i)
+    {
+        delete i->second;
+    }
+    preloadedMaps.clear();
+
     for (Maps::iterator i = maps.begin(), i_end = maps.end(); i != i_end; ++i)
     {
         delete i->second;
@@ -127,6 +217,77 @@ MapComposite *MapManager::getMap(const std::string &mapName)
     return NULL;
 }
 
+void MapManager::preloadMaps(const std::vector< int > &mapIds)
+{
+    PreloadQueue queue;
+    for (std::vector< int >::const_iterator i = mapIds.begin(),
+         i_end = mapIds.end(); i != i_end; ++i)
+    {
+        MapComposite *composite = getMap(*i);
+        if (composite && !composite->isActive() && !preloadedMaps.count(*i))
+            queue.composites.push_back(composite);
+    }
+
+    if (queue.composites.empty())
+        return;
+
+    int threadCount = Configuration::getValue("map_loadThreads", 0);
+    if (threadCount <= 0)
+        threadCount = utils::Thread::getProcessorCount();
+
+    queue.results.resize(queue.composites.size());
+    queue.times.resize(queue.composites.size());
+    queue.next = 0;
+
+    threadCount = std::max(1, std::min<int>(threadCount,
+                                            queue.composites.size()));
+
+    // The parser has to be initialized before using it from several threads
+    xmlInitParser();
+
+    const uint64_t start = getTime();
+
+    std::vector< utils::Thread * > threads;
+    for (int i = 0; i < threadCount; ++i)
+    {
+        utils::Thread *thread = new utils::Thread;
+        if (!thread->start(preloadWorker, &queue))
+        {
+            delete thread;
+            break;
+        }
+        threads.push_back(thread);
+    }
+
+    // Read whatever is left on this thread when threads are not available
+    if (threads.empty())
+        preloadWorker(&queue);
+
+    for (size_t i = 0; i < threads.size(); ++i)
+        delete threads[i];  // Joins the thread
+
+    const uint64_t time = getTime() - start;
+    preloadTime += time;
+    preloadThreadCount = std::max<int>(threads.size(), 1);
+
+    uint64_t readTime = 0;
+    int read = 0;
+    for (size_t i = 0; i < queue.composites.size(); ++i)
+    {
+        readTime += queue.times[i];
+        if (queue.results[i])
+        {
+            preloadedMaps[queue.composites[i]->getID()] = queue.results[i];
+            ++read;
+        }
+    }
+    preloadReadTime += readTime;
+
+    LOG_INFO("Read " << read << " of " << queue.composites.size()
+             << " maps in " << time / 1000 << " ms on " << preloadThreadCount
+             << " threads (" << readTime / 1000 << " ms of reading).");
+}
+
 bool MapManager::activateMap(int mapId)
 {
     Maps::iterator i = maps.find(mapId);
@@ -136,16 +297,64 @@ bool MapManager::activateMap(int mapId)
     if (composite->isActive())
         return true;
 
-    if (composite->activate())
+    Map *map = 0;
+    std::map< int, Map * >::iterator preloaded = preloadedMaps.find(mapId);
+    if (preloaded != preloadedMaps.end())
+    {
+        map = preloaded->second;
+        preloadedMaps.erase(preloaded);
+    }
+
+    const uint64_t start = getTime();
+    const bool activated = composite->activate(map);
+
+    // With hibernation, the content is loaded when the first character enters
+    if (activated && !hibernationTicks)
+        composite->wakeUp();
+
+    const uint64_t time = getTime() - start;
+
+    if (activated)
     {
         LOG_INFO("Activated map \"" << composite->getName()
-                 << "\" (id " << mapId << ")");
-        return true;
+                 << "\" (id " << mapId << ") in " << time / 1000 << " ms");
     }
     else
     {
         LOG_WARN("Couldn't activate invalid map \"" << composite->getName()
                  << "\" (id " << mapId << ")");
-        return false;
+    }
+
+    if (map)
+    {
+        preloadActivationTime += time;
+        ++preloadActivatedCount;
+
+        if (preloadedMaps.empty())
+        {
+            LOG_INFO("Activated " << preloadActivatedCount
+                     << " preloaded maps: reading took " << preloadTime / 1000
+                     << " ms on " << preloadThreadCount
+                     << " threads, activating them took "
+                     << preloadActivationTime / 1000 << " ms.");
+        }
+    }
+
+    return activated;
+}
+
+void MapManager::hibernateIdleMaps()
+{
+    if (!hibernationTicks)
+        return;
+
+    for (Maps::iterator i = maps.begin(), i_end = maps.end(); i != i_end; ++i)
+    {
+        MapComposite *map = i->second;
+        if (map->isActive() && !map->isHibernating()
+                && map->getIdleTicks() >= hibernationTicks)
+        {
+            map->hibernate();
+        }
     }
 }
@@ -24,6 +24,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 class MapComposite;
 
@@ -60,10 +61,25 @@ namespace MapManager
     const Maps &getMaps();
 
     /**
-     * Sets the activity status of the map.
+     * Reads the files of the given maps on several threads, so that
+     * activating them only has to initialize their content. Call it with the
+     * maps about to be activated, since the maps that are not activated stay
+     * in memory until deinitialization.
+     */
+    void preloadMaps(const std::vector< int > &mapIds);
+
+    /**
+     * Sets the activity status of the map. When maps hibernate, its content
+     * is only loaded once a character enters it.
      * @return true if the activation was successful.
      */
     bool activateMap(int mapId);
+
+    /**
+     * Unloads the content of the maps that have been without characters for
+     * longer than the configured hibernation time.
+     */
+    void hibernateIdleMaps();
 }
 
 #endif // MAPMANAGER_H
@@ -21,19 +21,53 @@
 
 #include "game-server/mapreader.h"
 
+#include "common/configuration.h"
 #include "common/defines.h"
+#include "common/resourcemanager.h"
 #include "game-server/map.h"
+#include "game-server/mapcache.h"
 #include "utils/base64.h"
 #include "utils/logger.h"
+#include "utils/sha256.h"
 #include "utils/xml.h"
 #include "utils/zlib.h"
 #include "utils/string.h"
 
+#include <cstdlib>
 #include <cstring>
 
-static std::vector<unsigned> tilesetFirstGids;
-
 Map *MapReader::readMap(const std::string &filename)
+{
+    const std::string cacheDirectory =
+            Configuration::getValue("map_cache", std::string());
+    if (cacheDirectory.empty())
+        return readMapFile(filename);
+
+    int fileSize;
+    char *fileData = ResourceManager::loadFile(filename, fileSize);
+    if (!fileData)
+    {
+        LOG_ERROR("Error: Could not read map file " << filename << '.');
+        return 0;
+    }
+
+    const std::string hash = sha256(std::string(fileData, fileSize));
+    free(fileData);
+
+    if (Map *map = MapCache::load(cacheDirectory, hash))
+    {
+        LOG_DEBUG("Loaded compiled map " << filename);
+        return map;
+    }
+
+    Map *map = readMapFile(filename);
+    if (map && MapCache::store(cacheDirectory, hash, map))
+        LOG_INFO("Compiled map " << filename << " into the map cache.");
+
+    return map;
+}
+
+Map *MapReader::readMapFile(const std::string &filename)
 {
     XML::Document doc(filename);
     xmlNodePtr rootNode = doc.rootNode();
@@ -55,6 +89,7 @@ Map *MapReader::readMap(xmlNodePtr node)
     int tileW = XML::getProperty(node, "tilewidth", DEFAULT_TILE_LENGTH);
     int tileH = XML::getProperty(node, "tileheight", DEFAULT_TILE_LENGTH);
     Map *map = new Map(w, h, tileW, tileH);
+    std::vector<unsigned> tilesetFirstGids;
 
     for (node = node->xmlChildrenNode; node != NULL; node = node->next)
     {
@@ -66,8 +101,8 @@ Map *MapReader::readMap(xmlNodePtr node)
             }
             else
             {
-                ::tilesetFirstGids.push_back(XML::getProperty(node, "firstgid",
-                                                              0));
+                tilesetFirstGids.push_back(XML::getProperty(node, "firstgid",
+                                                            0));
             }
         }
         else if (xmlStrEqual(node->name, BAD_CAST "properties"))
@@ -90,7 +125,7 @@ Map *MapReader::readMap(xmlNodePtr node)
             if (utils::compareStrI(XML::getProperty(node, "name", "unnamed"),
                                    "collision") == 0)
             {
-                readLayer(node, map);
+                readLayer(node, map, tilesetFirstGids);
             }
         }
         else if (xmlStrEqual(node->name, BAD_CAST "objectgroup"))
@@ -141,13 +176,11 @@ Map *MapReader::readMap(xmlNodePtr node)
         }
     }
 
-    // Clean up tilesets
-    ::tilesetFirstGids.clear();
-
     return map;
 }
 
-void MapReader::readLayer(xmlNodePtr node, Map *map)
+void MapReader::readLayer(xmlNodePtr node, Map *map,
+                          const std::vector<unsigned> &tilesetFirstGids)
 {
     node = node->xmlChildrenNode;
     int h = map->getHeight();
@@ -235,7 +268,7 @@ void MapReader::readLayer(xmlNodePtr node, Map *map)
                     (binData[i + 2] << 16) |
                     (binData[i + 3] << 24);
 
-            setTileWithGid(map, x, y, gid);
+            setTileWithGid(map, x, y, gid, tilesetFirstGids);
 
             if (++x == w)
             {
@@ -263,7 +296,7 @@ void MapReader::readLayer(xmlNodePtr node, Map *map)
             pos = csv.find_first_of(",", oldPos);
 
             unsigned gid = atol(csv.substr(oldPos, pos - oldPos).c_str());
-            setTileWithGid(map, x, y, gid);
+            setTileWithGid(map, x, y, gid, tilesetFirstGids);
 
             x++;
             if (x == w)
@@ -290,7 +323,7 @@ void MapReader::readLayer(xmlNodePtr node, Map *map)
             if (xmlStrEqual(node->name, BAD_CAST "tile") && y < h)
             {
                 unsigned gid = XML::getProperty(node, "gid", 0);
-                setTileWithGid(map, x, y, gid);
+                setTileWithGid(map, x, y, gid, tilesetFirstGids);
 
                 if (++x == w)
                 {
@@ -332,7 +365,8 @@ int MapReader::getObjectProperty(xmlNodePtr node, int def)
     return val;
 }
 
-void MapReader::setTileWithGid(Map *map, int x, int y, unsigned gid)
+void MapReader::setTileWithGid(Map *map, int x, int y, unsigned gid,
+                               const std::vector<unsigned> &tilesetFirstGids)
 {
     // Bits on the far end of the 32-bit global tile ID are used for tile flags
     const int FlippedHorizontallyFlag   = 0x80000000;
@@ -346,8 +380,8 @@ void MapReader::setTileWithGid(Map *map, int x, int y, unsigned gid)
 
     // Find the tileset with the highest firstGid below/eq to gid
     unsigned set = gid;
-    for (std::vector<unsigned>::const_iterator i = ::tilesetFirstGids.begin(),
-         i_end = ::tilesetFirstGids.end(); i != i_end; ++i)
+    for (std::vector<unsigned>::const_iterator i = tilesetFirstGids.begin(),
+         i_end = tilesetFirstGids.end(); i != i_end; ++i)
     {
         if (gid < *i)
             break;
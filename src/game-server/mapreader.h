@@ -30,18 +30,26 @@
 class Map;
 
 /**
- * Reader for XML map files (*.tmx)
+ * Reader for XML map files (*.tmx). Maps may be read from several threads at
+ * once.
  */
 class MapReader
 {
     public:
         /**
-         * Read an XML map from a file.
+         * Read an XML map from a file. When a map cache is configured, the
+         * compiled map is loaded instead, unless the file changed since it
+         * was compiled.
          * @return the map when successful, 0 otherwise.
          */
         static Map *readMap(const std::string &filename);
 
     private:
+        /**
+         * Read an XML map from a file, bypassing the map cache.
+         */
+        static Map *readMapFile(const std::string &filename);
+
         /**
          * Read an XML map from a parsed XML tree.
          */
@@ -50,7 +58,8 @@ class MapReader
         /**
          * Reads a map layer and adds it to the given map.
          */
-        static void readLayer(xmlNodePtr node, Map *map);
+        static void readLayer(xmlNodePtr node, Map *map,
+                              const std::vector<unsigned> &tilesetFirstGids);
 
         /**
          * Get the string value from the given object property node.
@@ -63,7 +72,8 @@ class MapReader
          */
         static int getObjectProperty(xmlNodePtr node, int def);
 
-        static void setTileWithGid(Map *map, int x, int y, unsigned gid);
+        static void setTileWithGid(Map *map, int x, int y, unsigned gid,
+                                   const std::vector<unsigned> &tilesetFirstGids);
 };
 
 #endif
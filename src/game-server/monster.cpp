@@ -26,11 +26,13 @@
 #include "game-server/character.h"
 #include "game-server/collisiondetection.h"
 #include "game-server/item.h"
+#include "game-server/itemmanager.h"
 #include "game-server/map.h"
 #include "game-server/mapcomposite.h"
 #include "game-server/state.h"
 #include "scripting/scriptmanager.h"
 #include "utils/logger.h"
+#include "utils/objectpool.h"
 #include "utils/speedconv.h"
 
 #include <cmath>
@@ -47,6 +49,22 @@ struct MonsterTargetEventDispatch: EventDispatch
 
 static MonsterTargetEventDispatch monsterTargetEventDispatch;
 
+static utils::ObjectPool *monsterPool =
+        utils::ObjectPool::get("Monster", sizeof(Monster));
+
+void *Monster::operator new(size_t size)
+{
+    return monsterPool->allocate(size);
+}
+
+void Monster::operator delete(void *ptr, size_t size)
+{
+    monsterPool->deallocate(ptr, size);
+}
+
+const unsigned char Monster::WALKMASK = Map::BLOCKMASK_WALL |
+                                        Map::BLOCKMASK_CHARACTER;
+
 Monster::Monster(MonsterClass *specy):
     Being(OBJECT_MONSTER),
     mSpecy(specy),
@@ -56,7 +74,7 @@ Monster::Monster(MonsterClass *specy):
 {
     LOG_DEBUG("Monster spawned! (id: " << mSpecy->getId() << ").");
 
-    setWalkMask(Map::BLOCKMASK_WALL | Map::BLOCKMASK_CHARACTER);
+    setWalkMask(WALKMASK);
 
     /*
      * Initialise the attribute structures.
@@ -134,13 +152,21 @@ void Monster::update()
         return;
     }
 
-    if (mSpecy->getUpdateCallback().isValid())
+    const Script::Ref updateCallback = mSpecy->getUpdateCallback();
+    if (updateCallback.isValid())
     {
         Script *script = ScriptManager::currentState();
-        script->setMap(getMap());
-        script->prepare(mSpecy->getUpdateCallback());
-        script->push(this);
-        script->execute();
+        if (updateCallback.batched)
+        {
+            script->queueCall(updateCallback, this);
+        }
+        else
+        {
+            script->setMap(getMap());
+            script->prepare(updateCallback);
+            script->push(this);
+            script->execute();
+        }
     }
 
     // Cancel the rest when we are currently performing an attack
@@ -186,7 +212,7 @@ void Monster::refreshTarget()
     BeingDirection bestAttackDirection = DOWN;
 
     // Iterate through objects nearby
-    int aroundArea = Configuration::getValue("game_visualRange", 448);
+    const int aroundArea = GameState::visualRangeOption;
     for (BeingIterator i(getMap()->getAroundBeingIterator(this, aroundArea));
          i; ++i)
     {
@@ -311,7 +337,12 @@ void Monster::processAttack()
     if (!mCurrentAttack->scriptEvent.empty() && hit > -1)
     {
         Script::Ref function = mSpecy->getEventCallback(mCurrentAttack->scriptEvent);
-        if (function.isValid())
+        if (function.isValid() && function.batched)
+        {
+            ScriptManager::currentState()->queueCall(function, this,
+                                                     mTarget, hit);
+        }
+        else if (function.isValid())
         {
             Script *script = ScriptManager::currentState();
             script->setMap(getMap());
@@ -459,9 +490,13 @@ void Monster::died()
         for (unsigned i = 0; i < size; i++)
         {
             const int p = rand() / (RAND_MAX / 10000);
-            if (p <= mSpecy->mDrops[i].probability)
+            if (p > mSpecy->mDrops[i].probability)
+                continue;
+
+            if (ItemClass *itemClass =
+                    itemManager->getItem(mSpecy->mDrops[i].itemId))
             {
-                Item *item = new Item(mSpecy->mDrops[i].item, 1);
+                Item *item = new Item(itemClass, 1);
                 item->setMap(getMap());
                 item->setPosition(getPosition());
                 GameState::enqueueInsert(item);
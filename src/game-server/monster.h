@@ -35,12 +35,13 @@ class ItemClass;
 class Script;
 
 /**
- * Structure containing an item class and its probability to be dropped
- * (unit: 1/10000).
+ * Structure containing an item class id and its probability to be dropped
+ * (unit: 1/10000). The item class is looked up when dropping, so that drops
+ * follow reloads of the item database.
  */
 struct MonsterDrop
 {
-    ItemClass *item;
+    int itemId;
     int probability;
 };
 
@@ -199,14 +200,22 @@ class MonsterClass
         /** Returns script filename */
         const std::string &getScript() const { return mScript; }
 
-        void setUpdateCallback(Script *script)
-        { script->assignCallback(mUpdateCallback); }
+        void setUpdateCallback(Script *script, bool batched = false)
+        {
+            script->assignCallback(mUpdateCallback);
+            mUpdateCallback.batched = batched;
+        }
 
         void setDamageCallback(Script *script)
         { script->assignCallback(mDamageCallback); }
 
-        void setEventCallback(const std::string &event, Script *script)
-        { script->assignCallback(mEventCallbacks[event]); }
+        void setEventCallback(const std::string &event, Script *script,
+                              bool batched = false)
+        {
+            Script::Ref &callback = mEventCallbacks[event];
+            script->assignCallback(callback);
+            callback.batched = batched;
+        }
 
         Script::Ref getUpdateCallback() const
         { return mUpdateCallback; }
@@ -283,9 +292,19 @@ class Monster : public Being
         /** Time in game ticks until ownership of a monster can change. */
         static const int KILLSTEAL_PROTECTION_TIME = 100;
 
+        /** Blockmask of the tiles monsters cannot walk on. */
+        static const unsigned char WALKMASK;
+
         Monster(MonsterClass *);
         ~Monster();
 
+        /**
+         * Killed monsters are deleted and replaced by new ones from their
+         * spawn area, so the respawn cycle allocates from a pool.
+         */
+        static void *operator new(size_t size);
+        static void operator delete(void *ptr, size_t size);
+
         /**
          * Returns monster specy.
          */
@@ -56,16 +56,14 @@ Element elementFromString (const std::string &name)
 
 void MonsterManager::reload()
 {
-    deinitialize();
     initialize();
 }
 
 void MonsterManager::initialize()
 {
-    XML::Document doc(mMonsterReferenceFile);
-    xmlNodePtr rootNode = doc.rootNode();
+    XML::Reader reader(mMonsterReferenceFile);
 
-    if (!rootNode || !xmlStrEqual(rootNode->name, BAD_CAST "monsters"))
+    if (!xmlStrEqual(reader.rootName(), BAD_CAST "monsters"))
     {
         LOG_ERROR("Monster Manager: Error while parsing monster database ("
                   << mMonsterReferenceFile << ")!");
@@ -73,272 +71,316 @@ void MonsterManager::initialize()
     }
 
     LOG_INFO("Loading monster reference: " << mMonsterReferenceFile);
-    int nbMonsters = 0;
-    for_each_xml_child_node(node, rootNode)
-    {
-        if (!xmlStrEqual(node->name, BAD_CAST "monster"))
-            continue;
 
-        int id = XML::getProperty(node, "id", 0);
-        std::string name = XML::getProperty(node, "name", std::string());
+    std::set<int> readIds;
+    unsigned changedCount = 0;
 
-        if (id < 1)
+    while (xmlNodePtr node = reader.nextChild())
+    {
+        if (xmlStrEqual(node->name, BAD_CAST "monster"))
         {
-            LOG_WARN("Monster Manager: Ignoring monster ("
-                     << name << ") without Id in "
-                     << mMonsterReferenceFile << "! It has been ignored.");
-            continue;
+            if (readMonsterNode(node, readIds))
+                ++changedCount;
         }
+    }
 
-        MonsterClasses::iterator i = mMonsterClasses.find(id);
-        if (i != mMonsterClasses.end())
-        {
-            LOG_WARN("Monster Manager: Ignoring duplicate definition of "
-                     "monster '" << id << "'!");
-            continue;
-        }
+    // Retire the monsters that are no longer defined
+    for (MonsterClasses::iterator i = mMonsterClasses.begin();
+         i != mMonsterClasses.end();)
+    {
+        if (readIds.find(i->first) == readIds.end())
+            retireMonster(i++);
+        else
+            ++i;
+    }
 
-        MonsterClass *monster = new MonsterClass(id);
-        mMonsterClasses[id] = monster;
+    LOG_INFO("Loaded " << mMonsterClasses.size() << " monsters ("
+             << changedCount << " new or changed) from "
+             << mMonsterReferenceFile << '.');
+}
 
-        if (!name.empty())
-        {
-            monster->setName(name);
+void MonsterManager::retireMonster(MonsterClasses::iterator i)
+{
+    MonsterClass *monster = i->second;
+    if (mMonsterClassesByName.value(monster->getName()) == monster)
+        mMonsterClassesByName.remove(monster->getName());
 
-            if (mMonsterClassesByName.contains(name))
-                LOG_WARN("Monster Manager: Name not unique for monster " << id);
-            else
-                mMonsterClassesByName.insert(name, monster);
-        }
+    mMonsterFingerprints.erase(i->first);
+    mRetiredMonsterClasses.push_back(monster);
+    mMonsterClasses.erase(i);
+}
 
-        MonsterDrops drops;
-        bool attributesSet = false;
-        bool behaviorSet = false;
+bool MonsterManager::readMonsterNode(xmlNodePtr node, std::set<int> &readIds)
+{
+    int id = XML::getProperty(node, "id", 0);
+    std::string name = XML::getProperty(node, "name", std::string());
+
+    if (id < 1)
+    {
+        LOG_WARN("Monster Manager: Ignoring monster ("
+                 << name << ") without Id in "
+                 << mMonsterReferenceFile << "! It has been ignored.");
+        return false;
+    }
+
+    if (!readIds.insert(id).second)
+    {
+        LOG_WARN("Monster Manager: Ignoring duplicate definition of "
+                 "monster '" << id << "'!");
+        return false;
+    }
 
-        for_each_xml_child_node(subnode, node)
+    const uint64_t fingerprint = XML::getFingerprint(node);
+    MonsterClasses::iterator i = mMonsterClasses.find(id);
+
+    if (i != mMonsterClasses.end())
+    {
+        std::map< int, uint64_t >::const_iterator f =
+                mMonsterFingerprints.find(id);
+        if (f != mMonsterFingerprints.end() && f->second == fingerprint)
+            return false;
+
+        retireMonster(i);
+    }
+    mMonsterFingerprints[id] = fingerprint;
+
+    MonsterClass *monster = new MonsterClass(id);
+    mMonsterClasses[id] = monster;
+
+    if (!name.empty())
+    {
+        monster->setName(name);
+
+        if (mMonsterClassesByName.contains(name))
+            LOG_WARN("Monster Manager: Name not unique for monster " << id);
+        else
+            mMonsterClassesByName.insert(name, monster);
+    }
+
+    MonsterDrops drops;
+    bool attributesSet = false;
+    bool behaviorSet = false;
+
+    for_each_xml_child_node(subnode, node)
+    {
+        if (xmlStrEqual(subnode->name, BAD_CAST "drop"))
+        {
+            MonsterDrop drop;
+            drop.itemId = XML::getProperty(subnode, "item", 0);
+            drop.probability = XML::getFloatProperty(subnode, "percent",
+                                                     0.0) * 100 + 0.5;
+
+            if (itemManager->getItem(drop.itemId) && drop.probability)
+                drops.push_back(drop);
+        }
+        else if (xmlStrEqual(subnode->name, BAD_CAST "attributes"))
         {
-            if (xmlStrEqual(subnode->name, BAD_CAST "drop"))
+            attributesSet = true;
+
+            const int hp = XML::getProperty(subnode, "hp", -1);
+            monster->setAttribute(ATTR_MAX_HP, hp);
+            monster->setAttribute(ATTR_HP, hp);
+
+            monster->setAttribute(MOB_ATTR_PHY_ATK_MIN,
+                XML::getProperty(subnode, "attack-min", -1));
+            monster->setAttribute(MOB_ATTR_PHY_ATK_DELTA,
+                XML::getProperty(subnode, "attack-delta", -1));
+            monster->setAttribute(MOB_ATTR_MAG_ATK,
+                XML::getProperty(subnode, "attack-magic", -1));
+            monster->setAttribute(ATTR_DODGE,
+                XML::getProperty(subnode, "evade", -1));
+            monster->setAttribute(ATTR_MAGIC_DODGE,
+                XML::getProperty(subnode, "magic-evade", -1));
+            monster->setAttribute(ATTR_ACCURACY,
+                XML::getProperty(subnode, "hit", -1));
+            monster->setAttribute(ATTR_DEFENSE,
+                XML::getProperty(subnode, "physical-defence", -1));
+            monster->setAttribute(ATTR_MAGIC_DEFENSE,
+                XML::getProperty(subnode, "magical-defence", -1));
+            monster->setSize(XML::getProperty(subnode, "size", -1));
+            float speed = (XML::getFloatProperty(subnode, "speed", -1.0f));
+            monster->setMutation(XML::getProperty(subnode, "mutation", 0));
+            std::string genderString = XML::getProperty(subnode, "gender",
+                                                        std::string());
+            monster->setGender(getGender(genderString));
+
+            // Checking attributes for completeness and plausibility
+            if (monster->getMutation() > MAX_MUTATION)
             {
-                MonsterDrop drop;
-                drop.item = itemManager->getItem(
-                                          XML::getProperty(subnode, "item", 0));
-                drop.probability = XML::getFloatProperty(subnode, "percent",
-                                                         0.0) * 100 + 0.5;
-
-                if (drop.item && drop.probability)
-                    drops.push_back(drop);
+                LOG_WARN(mMonsterReferenceFile
+                << ": Mutation of monster Id:" << id << " more than "
+                << MAX_MUTATION << "%. Defaulted to 0.");
+                monster->setMutation(0);
             }
-            else if (xmlStrEqual(subnode->name, BAD_CAST "attributes"))
-            {
-                attributesSet = true;
-
-                const int hp = XML::getProperty(subnode, "hp", -1);
-                monster->setAttribute(ATTR_MAX_HP, hp);
-                monster->setAttribute(ATTR_HP, hp);
-
-                monster->setAttribute(MOB_ATTR_PHY_ATK_MIN,
-                    XML::getProperty(subnode, "attack-min", -1));
-                monster->setAttribute(MOB_ATTR_PHY_ATK_DELTA,
-                    XML::getProperty(subnode, "attack-delta", -1));
-                monster->setAttribute(MOB_ATTR_MAG_ATK,
-                    XML::getProperty(subnode, "attack-magic", -1));
-                monster->setAttribute(ATTR_DODGE,
-                    XML::getProperty(subnode, "evade", -1));
-                monster->setAttribute(ATTR_MAGIC_DODGE,
-                    XML::getProperty(subnode, "magic-evade", -1));
-                monster->setAttribute(ATTR_ACCURACY,
-                    XML::getProperty(subnode, "hit", -1));
-                monster->setAttribute(ATTR_DEFENSE,
-                    XML::getProperty(subnode, "physical-defence", -1));
-                monster->setAttribute(ATTR_MAGIC_DEFENSE,
-                    XML::getProperty(subnode, "magical-defence", -1));
-                monster->setSize(XML::getProperty(subnode, "size", -1));
-                float speed = (XML::getFloatProperty(subnode, "speed", -1.0f));
-                monster->setMutation(XML::getProperty(subnode, "mutation", 0));
-                std::string genderString = XML::getProperty(subnode, "gender",
-                                                            std::string());
-                monster->setGender(getGender(genderString));
-
-                // Checking attributes for completeness and plausibility
-                if (monster->getMutation() > MAX_MUTATION)
-                {
-                    LOG_WARN(mMonsterReferenceFile
-                    << ": Mutation of monster Id:" << id << " more than "
-                    << MAX_MUTATION << "%. Defaulted to 0.");
-                    monster->setMutation(0);
-                }
 
-                bool attributesComplete = true;
-                const AttributeManager::AttributeScope &mobAttr =
-                            attributeManager->getAttributeScope(MonsterScope);
-
-                for (AttributeManager::AttributeScope::const_iterator it =
-                    mobAttr.begin(), it_end = mobAttr.end(); it != it_end; ++it)
-                {
-                    if (!monster->mAttributes.count(it->first))
-                    {
-                        LOG_WARN(mMonsterReferenceFile << ": No attribute "
-                                 << it->first << " for monster Id: "
-                                 << id << ". Defaulted to 0.");
-                        attributesComplete = false;
-                        monster->setAttribute(it->first, 0);
-                    }
-                }
+            bool attributesComplete = true;
+            const AttributeManager::AttributeScope &mobAttr =
+                        attributeManager->getAttributeScope(MonsterScope);
 
-                if (monster->getSize() == -1)
+            for (AttributeManager::AttributeScope::const_iterator it =
+                mobAttr.begin(), it_end = mobAttr.end(); it != it_end; ++it)
+            {
+                if (!monster->mAttributes.count(it->first))
                 {
-                    LOG_WARN(mMonsterReferenceFile
-                             << ": No size set for monster Id:" << id << ". "
-                             << "Defaulted to " << DEFAULT_MONSTER_SIZE
-                             << " pixels.");
-                    monster->setSize(DEFAULT_MONSTER_SIZE);
+                    LOG_WARN(mMonsterReferenceFile << ": No attribute "
+                             << it->first << " for monster Id: "
+                             << id << ". Defaulted to 0.");
                     attributesComplete = false;
+                    monster->setAttribute(it->first, 0);
                 }
+            }
 
-                if (speed == -1.0f)
-                {
-                    LOG_WARN(mMonsterReferenceFile
-                             << ": No speed set for monster Id:" << id << ". "
-                             << "Defaulted to " << DEFAULT_MONSTER_SPEED
-                             << " tiles/second.");
-                    speed = DEFAULT_MONSTER_SPEED;
-                    attributesComplete = false;
-                }
-                monster->setAttribute(ATTR_MOVE_SPEED_TPS, speed);
+            if (monster->getSize() == -1)
+            {
+                LOG_WARN(mMonsterReferenceFile
+                         << ": No size set for monster Id:" << id << ". "
+                         << "Defaulted to " << DEFAULT_MONSTER_SIZE
+                         << " pixels.");
+                monster->setSize(DEFAULT_MONSTER_SIZE);
+                attributesComplete = false;
+            }
 
-                if (!attributesComplete)
-                {
-                    LOG_WARN(mMonsterReferenceFile
-                             << ": Attributes incomplete for monster Id:" << id
-                             << ". Defaults values may have been applied!");
-                }
+            if (speed == -1.0f)
+            {
+                LOG_WARN(mMonsterReferenceFile
+                         << ": No speed set for monster Id:" << id << ". "
+                         << "Defaulted to " << DEFAULT_MONSTER_SPEED
+                         << " tiles/second.");
+                speed = DEFAULT_MONSTER_SPEED;
+                attributesComplete = false;
+            }
+            monster->setAttribute(ATTR_MOVE_SPEED_TPS, speed);
+
+            if (!attributesComplete)
+            {
+                LOG_WARN(mMonsterReferenceFile
+                         << ": Attributes incomplete for monster Id:" << id
+                         << ". Defaults values may have been applied!");
+            }
 
+        }
+        else if (xmlStrEqual(subnode->name, BAD_CAST "exp"))
+        {
+            xmlChar *exp = subnode->xmlChildrenNode->content;
+            monster->setExp(atoi((const char*)exp));
+            monster->setOptimalLevel(XML::getProperty(subnode, "level", 0));
+        }
+        else if (xmlStrEqual(subnode->name, BAD_CAST "behavior"))
+        {
+            behaviorSet = true;
+            if (XML::getBoolProperty(subnode, "aggressive", false))
+                monster->setAggressive(true);
+
+            monster->setTrackRange(
+                           XML::getProperty(subnode, "track-range", 1));
+            monster->setStrollRange(
+                           XML::getProperty(subnode, "stroll-range", 0));
+            monster->setAttackDistance(
+                           XML::getProperty(subnode, "attack-distance", 0));
+        }
+        else if (xmlStrEqual(subnode->name, BAD_CAST "attack"))
+        {
+            MonsterAttack *att = new MonsterAttack;
+            att->id = XML::getProperty(subnode, "id", 0);
+            att->priority = XML::getProperty(subnode, "priority", 1);
+            att->damageFactor = XML::getFloatProperty(subnode,
+                                                     "damage-factor", 1.0f);
+            att->preDelay = XML::getProperty(subnode, "pre-delay", 1);
+            att->aftDelay = XML::getProperty(subnode, "aft-delay", 0);
+            att->range = XML::getProperty(subnode, "range", 0);
+            att->scriptEvent = XML::getProperty(subnode, "script-event",
+                                                std::string());
+            std::string sElement = XML::getProperty(subnode,
+                                                    "element", "neutral");
+            att->element = elementFromString(sElement);
+            std::string sType = XML::getProperty(subnode,
+                                                 "type", "physical");
+
+            bool validMonsterAttack = true;
+            if (sType == "physical")
+            {
+                att->type = DAMAGE_PHYSICAL;
             }
-            else if (xmlStrEqual(subnode->name, BAD_CAST "exp"))
+            else if (sType == "magical" || sType == "magic")
             {
-                xmlChar *exp = subnode->xmlChildrenNode->content;
-                monster->setExp(atoi((const char*)exp));
-                monster->setOptimalLevel(XML::getProperty(subnode, "level", 0));
+                att->type = DAMAGE_MAGICAL;
             }
-            else if (xmlStrEqual(subnode->name, BAD_CAST "behavior"))
+            else if (sType == "other")
             {
-                behaviorSet = true;
-                if (XML::getBoolProperty(subnode, "aggressive", false))
-                    monster->setAggressive(true);
-
-                monster->setTrackRange(
-                               XML::getProperty(subnode, "track-range", 1));
-                monster->setStrollRange(
-                               XML::getProperty(subnode, "stroll-range", 0));
-                monster->setAttackDistance(
-                               XML::getProperty(subnode, "attack-distance", 0));
+                att->type = DAMAGE_OTHER;
             }
-            else if (xmlStrEqual(subnode->name, BAD_CAST "attack"))
+            else
             {
-                MonsterAttack *att = new MonsterAttack;
-                att->id = XML::getProperty(subnode, "id", 0);
-                att->priority = XML::getProperty(subnode, "priority", 1);
-                att->damageFactor = XML::getFloatProperty(subnode,
-                                                         "damage-factor", 1.0f);
-                att->preDelay = XML::getProperty(subnode, "pre-delay", 1);
-                att->aftDelay = XML::getProperty(subnode, "aft-delay", 0);
-                att->range = XML::getProperty(subnode, "range", 0);
-                att->scriptEvent = XML::getProperty(subnode, "script-event",
-                                                    std::string());
-                std::string sElement = XML::getProperty(subnode,
-                                                        "element", "neutral");
-                att->element = elementFromString(sElement);
-                std::string sType = XML::getProperty(subnode,
-                                                     "type", "physical");
-
-                bool validMonsterAttack = true;
-                if (sType == "physical")
-                {
-                    att->type = DAMAGE_PHYSICAL;
-                }
-                else if (sType == "magical" || sType == "magic")
-                {
-                    att->type = DAMAGE_MAGICAL;
-                }
-                else if (sType == "other")
-                {
-                    att->type = DAMAGE_OTHER;
-                }
-                else
-                {
-                    LOG_WARN("Monster manager " << mMonsterReferenceFile
-                              <<  ": unknown damage type '" << sType << "'.");
-                    validMonsterAttack = false;
-                }
-
-                if (att->id < 1)
-                {
-                    LOG_WARN(mMonsterReferenceFile
-                             << ": Attack without ID for monster Id:"
-                             << id << " (" << name << ") - attack ignored");
-                    validMonsterAttack = false;
-                }
-                else if (att->element == ELEMENT_ILLEGAL)
-                {
-                    LOG_WARN(mMonsterReferenceFile
-                             << ": Attack with unknown element \""
-                             << sElement << "\" for monster Id:" << id
-                             << " (" << name << ") - attack ignored");
-                    validMonsterAttack = false;
-                }
-                else if (att->type == -1)
-                {
-                    LOG_WARN(mMonsterReferenceFile
-                             << ": Attack with unknown type \"" << sType << "\""
-                             << " for monster Id:" << id
-                             << " (" << name << ")");
-                    validMonsterAttack = false;
-                }
+                LOG_WARN("Monster manager " << mMonsterReferenceFile
+                          <<  ": unknown damage type '" << sType << "'.");
+                validMonsterAttack = false;
+            }
 
-                if (validMonsterAttack)
-                {
-                    monster->addAttack(att);
-                }
-                else
-                {
-                    delete att;
-                    att = 0;
-                }
+            if (att->id < 1)
+            {
+                LOG_WARN(mMonsterReferenceFile
+                         << ": Attack without ID for monster Id:"
+                         << id << " (" << name << ") - attack ignored");
+                validMonsterAttack = false;
+            }
+            else if (att->element == ELEMENT_ILLEGAL)
+            {
+                LOG_WARN(mMonsterReferenceFile
+                         << ": Attack with unknown element \""
+                         << sElement << "\" for monster Id:" << id
+                         << " (" << name << ") - attack ignored");
+                validMonsterAttack = false;
+            }
+            else if (att->type == -1)
+            {
+                LOG_WARN(mMonsterReferenceFile
+                         << ": Attack with unknown type \"" << sType << "\""
+                         << " for monster Id:" << id
+                         << " (" << name << ")");
+                validMonsterAttack = false;
+            }
 
+            if (validMonsterAttack)
+            {
+                monster->addAttack(att);
             }
-            else if (xmlStrEqual(subnode->name, BAD_CAST "script"))
+            else
             {
-                xmlChar *filename = subnode->xmlChildrenNode->content;
-                std::string val = (char *)filename;
-                monster->setScript(val);
+                delete att;
+                att = 0;
             }
-        }
 
-        monster->setDrops(drops);
-        if (!attributesSet)
-        {
-            LOG_WARN(mMonsterReferenceFile
-                     << ": No attributes defined for monster Id:" << id
-                     << " (" << name << ")");
-        }
-        if (!behaviorSet)
-        {
-            LOG_WARN(mMonsterReferenceFile
-                << ": No behavior defined for monster Id:" << id
-                << " (" << name << ")");
         }
-        if (monster->getExp() == -1)
+        else if (xmlStrEqual(subnode->name, BAD_CAST "script"))
         {
-            LOG_WARN(mMonsterReferenceFile
-                    << ": No experience defined for monster Id:" << id
-                    << " (" << name << ")");
-            monster->setExp(0);
+            xmlChar *filename = subnode->xmlChildrenNode->content;
+            std::string val = (char *)filename;
+            monster->setScript(val);
         }
-        ++nbMonsters;
     }
 
-    LOG_INFO("Loaded " << nbMonsters << " monsters from "
-             << mMonsterReferenceFile << '.');
+    monster->setDrops(drops);
+    if (!attributesSet)
+    {
+        LOG_WARN(mMonsterReferenceFile
+                 << ": No attributes defined for monster Id:" << id
+                 << " (" << name << ")");
+    }
+    if (!behaviorSet)
+    {
+        LOG_WARN(mMonsterReferenceFile
+            << ": No behavior defined for monster Id:" << id
+            << " (" << name << ")");
+    }
+    if (monster->getExp() == -1)
+    {
+        LOG_WARN(mMonsterReferenceFile
+                << ": No experience defined for monster Id:" << id
+                << " (" << name << ")");
+        monster->setExp(0);
+    }
+
+    return true;
 }
 
 void MonsterManager::deinitialize()
@@ -348,8 +390,18 @@ void MonsterManager::deinitialize()
     {
         delete i->second;
     }
+
+    for (std::vector< MonsterClass * >::iterator i =
+         mRetiredMonsterClasses.begin(), i_end = mRetiredMonsterClasses.end();
+         i != i_end; ++i)
+    {
+        delete *i;
+    }
+
     mMonsterClasses.clear();
     mMonsterClassesByName.clear();
+    mMonsterFingerprints.clear();
+    mRetiredMonsterClasses.clear();
 }
 
 MonsterClass *MonsterManager::getMonsterByName(const std::string &name) const
@@ -23,7 +23,10 @@
 
 #include <string>
 #include <map>
+#include <set>
+#include <vector>
 #include "utils/string.h"
+#include "utils/xml.h"
 
 class MonsterClass;
 
@@ -43,7 +46,10 @@ class MonsterManager
         void initialize();
 
         /**
-         * Reloads monster reference file.
+         * Reloads monster reference file. Only the monsters whose definition
+         * changed are replaced. The replaced and removed monster classes are
+         * kept alive until deinitialize(), since monsters in the world still
+         * refer to them.
          */
         void reload();
 
@@ -66,11 +72,23 @@ class MonsterManager
         MonsterClass *getMonsterByName(const std::string &name) const;
 
     private:
-
         typedef std::map< int, MonsterClass * > MonsterClasses;
+
+        /**
+         * Reads a monster definition, unless it did not change since the
+         * last read. Returns whether a new or changed definition was read.
+         */
+        bool readMonsterNode(xmlNodePtr node, std::set<int> &readIds);
+        void retireMonster(MonsterClasses::iterator i);
+
         MonsterClasses mMonsterClasses; /**< Monster reference */
         utils::NameMap<MonsterClass*> mMonsterClassesByName;
 
+        /** Hashes of the monster definitions, to find changes on reload. */
+        std::map< int, uint64_t > mMonsterFingerprints;
+        /** Monster classes replaced or removed by a reload. */
+        std::vector< MonsterClass * > mRetiredMonsterClasses;
+
         std::string mMonsterReferenceFile;
 };
 
@@ -40,10 +40,9 @@ void SkillManager::initialize()
 {
     clear();
 
-    XML::Document doc(mSkillFile);
-    xmlNodePtr rootNode = doc.rootNode();
+    XML::Reader reader(mSkillFile);
 
-    if (!rootNode || !xmlStrEqual(rootNode->name, BAD_CAST "skills"))
+    if (!xmlStrEqual(reader.rootName(), BAD_CAST "skills"))
     {
         LOG_ERROR("Skill Manager: " << mSkillFile
                   << " is not a valid database file!");
@@ -52,7 +51,7 @@ void SkillManager::initialize()
 
     LOG_INFO("Loading skill reference: " << mSkillFile);
 
-    for_each_xml_child_node(setNode, rootNode)
+    while (xmlNodePtr setNode = reader.nextChild())
     {
         // The server will prefix the core name with the set, so we need one.
         if (!xmlStrEqual(setNode->name, BAD_CAST "set"))
@@ -20,11 +20,16 @@
 
 #include "game-server/spawnarea.h"
 
+#include "game-server/map.h"
 #include "game-server/mapcomposite.h"
 #include "game-server/monster.h"
+#include "game-server/monstermanager.h"
 #include "game-server/state.h"
 #include "utils/logger.h"
 
+#include <algorithm>
+#include <cstdlib>
+
 struct SpawnAreaEventDispatch : EventDispatch
 {
     SpawnAreaEventDispatch()
@@ -41,16 +46,37 @@ SpawnArea::SpawnArea(MapComposite *map,
                      MonsterClass *specy,
                      const Rectangle &zone,
                      int maxBeings,
-                     int spawnRate):
+                     int spawnRate,
+                     int batchSize):
     Entity(OBJECT_OTHER, map),
     mSpecy(specy),
     mSpawnedListener(&spawnAreaEventDispatch),
     mZone(zone),
     mMaxBeings(maxBeings),
     mSpawnRate(spawnRate),
+    mBatchSize(std::max(batchSize, 1)),
     mNumBeings(0),
     mNextSpawn(0)
 {
+    const Map *realMap = map->getMap();
+
+    // Reset the spawn area to the whole map in case of dimensionless zone
+    if (mZone.w == 0 || mZone.h == 0)
+    {
+        mZone.x = 0;
+        mZone.y = 0;
+        mZone.w = realMap->getWidth() * realMap->getTileWidth();
+        mZone.h = realMap->getHeight() * realMap->getTileHeight();
+    }
+
+    collectWalkableTiles();
+
+    if (mWalkableTiles.empty())
+    {
+        LOG_WARN("No walkable tile for spawning monster " << mSpecy->getId()
+                 << " on map " << map->getName() << " (" << mZone.x << ','
+                 << mZone.y << ',' << mZone.w << ',' << mZone.h << ')');
+    }
 }
 
 void SpawnArea::update()
@@ -60,69 +86,124 @@ void SpawnArea::update()
 
     if (mNextSpawn == 0 && mNumBeings < mMaxBeings && mSpawnRate > 0)
     {
-        MapComposite *map = getMap();
-        const Map *realMap = map->getMap();
+        if (mWallRevision != getMap()->getMap()->getWallRevision())
+            collectWalkableTiles();
+
+        const int count = std::min(mBatchSize, mMaxBeings - mNumBeings);
+        int spawned = 0;
+        while (spawned < count && spawn())
+            ++spawned;
+
+        // Predictable respawn intervals (can be randomized later)
+        mNextSpawn = (10 * 60 * std::max(spawned, 1)) / mSpawnRate;
+    }
+}
 
-        // Reset the spawn area to the whole map in case of dimensionless zone
-        if (mZone.w == 0 || mZone.h == 0)
+/**
+ * Collects the tiles overlapping the area on which monsters can walk,
+ * ignoring the beings standing on them.
+ */
+void SpawnArea::collectWalkableTiles()
+{
+    const Map *map = getMap()->getMap();
+    const int tileWidth = map->getTileWidth();
+    const int tileHeight = map->getTileHeight();
+
+    mWalkableTiles.clear();
+    mWallRevision = map->getWallRevision();
+
+    // Clamp the area to the map first, so that every tile in the range below
+    // overlaps it
+    const int left = std::max(mZone.x, 0);
+    const int top = std::max(mZone.y, 0);
+    const int right = std::min(mZone.x + mZone.w,
+                               map->getWidth() * tileWidth);
+    const int bottom = std::min(mZone.y + mZone.h,
+                                map->getHeight() * tileHeight);
+    if (left >= right || top >= bottom)
+        return;
+
+    const int minX = left / tileWidth;
+    const int minY = top / tileHeight;
+    const int maxX = (right - 1) / tileWidth;
+    const int maxY = (bottom - 1) / tileHeight;
+
+    for (int y = minY; y <= maxY; ++y)
+    {
+        for (int x = minX; x <= maxX; ++x)
         {
-            mZone.x = 0;
-            mZone.y = 0;
-            mZone.w = realMap->getWidth() * realMap->getTileWidth();
-            mZone.h = realMap->getHeight() * realMap->getTileHeight();
+            if (map->getWalk(x, y, Map::BLOCKMASK_WALL))
+                mWalkableTiles.push_back(x + y * map->getWidth());
         }
+    }
+}
 
-        // Find a free spawn location. Give up after 10 tries
-        int c = 10;
-        Point position;
-        const int x = mZone.x;
-        const int y = mZone.y;
-        const int width = mZone.w;
-        const int height = mZone.h;
+/**
+ * Picks a random location on a walkable tile of the area. Tiles occupied by
+ * characters are avoided when another one is found within a few tries.
+ */
+bool SpawnArea::findSpawnLocation(Point &position) const
+{
+    if (mWalkableTiles.empty())
+        return false;
 
-        Being *being = new Monster(mSpecy);
+    const Map *map = getMap()->getMap();
+    const int width = map->getWidth();
 
-        if (being->getModifiedAttribute(ATTR_MAX_HP) <= 0)
-        {
-            LOG_WARN("Refusing to spawn dead monster " << mSpecy->getId());
-            delete being;
-            being = 0;
-        }
+    unsigned tile = 0;
+    for (int tries = 3; tries > 0; --tries)
+    {
+        tile = mWalkableTiles[rand() % mWalkableTiles.size()];
+        if (map->getWalk(tile % width, tile / width, Monster::WALKMASK))
+            break;
+    }
 
-        if (being)
-        {
-            do
-            {
-                position = Point(x + rand() % width, y + rand() % height);
-                c--;
-            }
-            while (!realMap->getWalk(position.x / realMap->getTileWidth(),
-                                     position.y / realMap->getTileHeight(),
-                                     being->getWalkMask()) && c);
-
-            if (c)
-            {
-                being->addListener(&mSpawnedListener);
-                being->setMap(map);
-                being->setPosition(position);
-                being->clearDestination();
-                GameState::enqueueInsert(being);
-
-                mNumBeings++;
-            }
-            else
-            {
-                LOG_WARN("Unable to find a free spawn location for monster "
-                         << mSpecy->getId() << " on map " << map->getName()
-                         << " (" << x << ',' << y << ','
-                         << width << ',' << height << ')');
-                delete being;
-            }
-        }
+    // The part of the tile that is inside the area
+    const int tileWidth = map->getTileWidth();
+    const int tileHeight = map->getTileHeight();
+    const int left = std::max<int>((tile % width) * tileWidth, mZone.x);
+    const int top = std::max<int>((tile / width) * tileHeight, mZone.y);
+    const int right = std::min<int>((tile % width + 1) * tileWidth,
+                                    mZone.x + mZone.w);
+    const int bottom = std::min<int>((tile / width + 1) * tileHeight,
+                                     mZone.y + mZone.h);
+    if (left >= right || top >= bottom)
+        return false;
+
+    position = Point(left + rand() % (right - left),
+                     top + rand() % (bottom - top));
+    return true;
+}
 
-        // Predictable respawn intervals (can be randomized later)
-        mNextSpawn = (10 * 60) / mSpawnRate;
+bool SpawnArea::spawn()
+{
+    MapComposite *map = getMap();
+
+    Point position;
+    if (!findSpawnLocation(position))
+        return false;
+
+    // Follow reloads of the monster database
+    if (MonsterClass *specy = monsterManager->getMonster(mSpecy->getId()))
+        mSpecy = specy;
+
+    Being *being = new Monster(mSpecy);
+
+    if (being->getModifiedAttribute(ATTR_MAX_HP) <= 0)
+    {
+        LOG_WARN("Refusing to spawn dead monster " << mSpecy->getId());
+        delete being;
+        return false;
     }
+
+    being->addListener(&mSpawnedListener);
+    being->setMap(map);
+    being->setPosition(position);
+    being->clearDestination();
+    GameState::enqueueInsert(being);
+
+    mNumBeings++;
+    return true;
 }
 
 void SpawnArea::decrease(Entity *t)
@@ -130,3 +211,8 @@ void SpawnArea::decrease(Entity *t)
     --mNumBeings;
     t->removeListener(&mSpawnedListener);
 }
+
+bool SpawnArea::isSpawned(const Entity *t)
+{
+    return t->hasListener(&spawnAreaEventDispatch);
+}
@@ -25,18 +25,29 @@
 #include "game-server/entity.h"
 #include "utils/point.h"
 
+#include <vector>
+
 class Being;
 class MonsterClass;
 
 /**
  * A spawn area, where monsters spawn. The area is a rectangular field and will
  * spawn a certain number of a given monster type.
+ *
+ * The tiles of the area that are not walls are collected up front, so that a
+ * spawn location is found without searching. The list is collected again
+ * when the walls of the map change.
  */
 class SpawnArea : public Entity
 {
     public:
+        /**
+         * Creates a spawn area on an active map. The monsters spawn in groups
+         * of up to batchSize at a time, still averaging spawnRate monsters
+         * per minute.
+         */
         SpawnArea(MapComposite *, MonsterClass *, const Rectangle &zone,
-            int maxBeings, int spawnRate);
+            int maxBeings, int spawnRate, int batchSize = 1);
 
         void update();
 
@@ -45,15 +56,31 @@ class SpawnArea : public Entity
          */
         void decrease(Entity *);
 
+        /**
+         * Checks whether the entity was spawned by a spawn area, which
+         * spawns another one once it is gone.
+         */
+        static bool isSpawned(const Entity *);
+
     private:
+        void collectWalkableTiles();
+
+        bool findSpawnLocation(Point &position) const;
+
+        bool spawn();
+
         MonsterClass *mSpecy; /**< Specy of monster that spawns in this area. */
         EventListener mSpawnedListener; /**< Tracking of spawned monsters. */
         Rectangle mZone;
         int mMaxBeings;    /**< Maximum population of this area. */
         int mSpawnRate;    /**< Number of beings spawning per minute. */
+        int mBatchSize;    /**< Maximum number of beings spawning at once. */
         int mNumBeings;    /**< Current population of this area. */
         int mNextSpawn;    /**< The time until next being spawn. */
 
+        std::vector<unsigned> mWalkableTiles; /**< Tile indexes of the area. */
+        unsigned mWallRevision; /**< Map walls the tiles were collected for. */
+
         friend struct SpawnAreaEventDispatch;
 };
 
@@ -95,10 +95,9 @@ void SpecialManager::initialize()
 {
     clear();
 
-    XML::Document doc(mSpecialFile);
-    xmlNodePtr rootNode = doc.rootNode();
+    XML::Reader reader(mSpecialFile);
 
-    if (!rootNode || !xmlStrEqual(rootNode->name, BAD_CAST "specials"))
+    if (!xmlStrEqual(reader.rootName(), BAD_CAST "specials"))
     {
         LOG_ERROR("Special Manager: " << mSpecialFile
                   << " is not a valid database file!");
@@ -107,7 +106,7 @@ void SpecialManager::initialize()
 
     LOG_INFO("Loading special reference: " << mSpecialFile);
 
-    for_each_xml_child_node(setNode, rootNode)
+    while (xmlNodePtr setNode = reader.nextChild())
     {
         // The server will prefix the core name with the set, so we need one.
         if (!xmlStrEqual(setNode->name, BAD_CAST "set"))
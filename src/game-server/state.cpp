@@ -38,8 +38,10 @@
 #include "scripting/scriptmanager.h"
 #include "utils/logger.h"
 #include "utils/point.h"
+#include "utils/rangecheck.h"
 #include "utils/speedconv.h"
 
+#include <algorithm>
 #include <cassert>
 
 enum
@@ -75,6 +77,8 @@ static DelayedEvents delayedEvents;
  */
 static std::map< std::string, std::string > mScriptVariables;
 
+Configuration::IntOption GameState::visualRangeOption("game_visualRange", 448);
+
 /**
  * Sets message fields describing character look.
  */
@@ -125,22 +129,77 @@ static void serializeLooks(Character *ch, MessageOut &msg)
     }
 }
 
+/**
+ * Beings of the zones around a character, with their old and new positions
+ * packed for the range tests, and the indices of those in range. The caller
+ * of informPlayer() owns it, so that the arrays are reused from a character
+ * to the next.
+ */
+struct AroundBeings
+{
+    std::vector< Being * > beings;
+    std::vector< int > oldX, oldY, x, y;
+    std::vector< unsigned > wereAround, willBeAround;
+};
+
 /**
  * Informs a player of what happened around the character.
  */
-static void informPlayer(MapComposite *map, Character *p)
+static void informPlayer(MapComposite *map, Character *p,
+                         AroundBeings &around)
 {
     MessageOut moveMsg(GPMSG_BEINGS_MOVE);
     MessageOut damageMsg(GPMSG_BEINGS_DAMAGE);
     const Point &pold = p->getOldPosition(), ppos = p->getPosition();
     int pid = p->getPublicID(), pflags = p->getUpdateFlags();
-    int visualRange = Configuration::getValue("game_visualRange", 448);
-
-    // Inform client about activities of other beings near its character
+    const int visualRange = GameState::visualRangeOption;
+
+    // Pack the positions of the beings of the zones around, then find those
+    // that were or will be in range of p by testing them all at once. Only
+    // those are looked at, in the order of the zones. The last entries of
+    // the lists are past the last being, to simplify merging them.
+    around.beings.clear();
+    around.oldX.clear();
+    around.oldY.clear();
+    around.x.clear();
+    around.y.clear();
     for (BeingIterator it(map->getAroundBeingIterator(p, visualRange));
          it; ++it)
     {
         Being *o = *it;
+        const Point &oold = o->getOldPosition(), &opos = o->getPosition();
+        around.beings.push_back(o);
+        around.oldX.push_back(oold.x);
+        around.oldY.push_back(oold.y);
+        around.x.push_back(opos.x);
+        around.y.push_back(opos.y);
+    }
+
+    // The character itself is always among them.
+    const unsigned count = around.beings.size();
+    std::vector< unsigned > &wereAround = around.wereAround;
+    std::vector< unsigned > &willBeAround = around.willBeAround;
+    wereAround.resize(count + 1);
+    willBeAround.resize(count + 1);
+    wereAround[utils::range::inRangeOf(pold, visualRange,
+                                       &around.oldX[0], &around.oldY[0],
+                                       count, &wereAround[0])] = count;
+    willBeAround[utils::range::inRangeOf(ppos, visualRange,
+                                         &around.x[0], &around.y[0],
+                                         count, &willBeAround[0])] = count;
+
+    // Inform client about activities of other beings near its character
+    for (unsigned were = 0, willBe = 0;
+         wereAround[were] < count || willBeAround[willBe] < count;)
+    {
+        const unsigned index = std::min(wereAround[were],
+                                        willBeAround[willBe]);
+        const bool wasAround = wereAround[were] == index;
+        const bool isAround = willBeAround[willBe] == index;
+        were += wasAround;
+        willBe += isAround;
+
+        Being *o = around.beings[index];
 
         const Point &oold = o->getOldPosition(), opos = o->getPosition();
         int otype = o->getType();
@@ -148,9 +207,9 @@ static void informPlayer(MapComposite *map, Character *p)
         int flags = 0;
 
         // Check if the character p and the moving object o are around.
-        bool wereInRange = pold.inRangeOf(oold, visualRange) &&
+        bool wereInRange = wasAround &&
                            !((pflags | oflags) & UPDATEFLAG_NEW_ON_MAP);
-        bool willBeInRange = ppos.inRangeOf(opos, visualRange);
+        bool willBeInRange = isAround;
 
         if (!wereInRange && !willBeInRange)
         {
@@ -426,20 +485,28 @@ void GameState::update(int tick)
 
     ScriptManager::currentState()->update();
 
+    AroundBeings around;
+
     // Update game state (update AI, etc.)
     const MapManager::Maps &maps = MapManager::getMaps();
     for (MapManager::Maps::const_iterator m = maps.begin(),
          m_end = maps.end(); m != m_end; ++m)
     {
         MapComposite *map = m->second;
-        if (!map->isActive())
+        if (!map->isActive() || map->isHibernating())
             continue;
 
         map->update();
 
+        // Make the script calls that were batched during the map update
+        Script *script = ScriptManager::currentState();
+        script->setMap(map);
+        script->flushBatchedCalls();
+        script->setMap(0);
+
         for (CharacterIterator p(map->getWholeMapIterator()); p; ++p)
         {
-            informPlayer(map, *p);
+            informPlayer(map, *p, around);
         }
 
         for (ActorIterator it(map->getWholeMapIterator()); it; ++it)
@@ -458,35 +525,46 @@ void GameState::update(int tick)
 #   endif
 
     // Take care of events that were delayed because of their side effects.
-    for (DelayedEvents::iterator it = delayedEvents.begin(),
-         it_end = delayedEvents.end(); it != it_end; ++it)
+    // Handling them may cause new ones, like a map waking up for a character
+    // and inserting its NPCs, so keep going until there are none left.
+    while (!delayedEvents.empty())
     {
-        const DelayedEvent &e = it->second;
-        Actor *o = it->first;
-        switch (e.type)
-        {
-            case EVENT_REMOVE:
-                remove(o);
-                if (o->getType() == OBJECT_CHARACTER)
-                {
-                    Character *ch = static_cast< Character * >(o);
-                    ch->disconnected();
-                    gameHandler->kill(ch);
-                }
-                delete o;
-                break;
-
-            case EVENT_INSERT:
-                insertOrDelete(o);
-                break;
+        DelayedEvents events;
+        events.swap(delayedEvents);
 
-            case EVENT_WARP:
-                assert(o->getType() == OBJECT_CHARACTER);
-                warp(static_cast< Character * >(o), e.map, e.x, e.y);
-                break;
+        for (DelayedEvents::iterator it = events.begin(),
+             it_end = events.end(); it != it_end; ++it)
+        {
+            const DelayedEvent &e = it->second;
+            Actor *o = it->first;
+            switch (e.type)
+            {
+                case EVENT_REMOVE:
+                    remove(o);
+                    if (o->getType() == OBJECT_CHARACTER)
+                    {
+                        Character *ch = static_cast< Character * >(o);
+                        ch->disconnected();
+                        gameHandler->kill(ch);
+                    }
+                    delete o;
+                    // Forget what was asked for it in the meantime
+                    delayedEvents.erase(o);
+                    break;
+
+                case EVENT_INSERT:
+                    insertOrDelete(o);
+                    break;
+
+                case EVENT_WARP:
+                    assert(o->getType() == OBJECT_CHARACTER);
+                    warp(static_cast< Character * >(o), e.map, e.x, e.y);
+                    break;
+            }
         }
     }
-    delayedEvents.clear();
+
+    MapManager::hibernateIdleMaps();
 }
 
 bool GameState::insert(Entity *ptr)
@@ -495,6 +573,9 @@ bool GameState::insert(Entity *ptr)
     MapComposite *map = ptr->getMap();
     assert(map && map->isActive());
 
+    if (map->isHibernating())
+        map->wakeUp();
+
     /* Non-visible objects have neither position nor public ID, so their
        insertion cannot fail. Take care of them first. */
     if (!ptr->isVisible())
@@ -596,7 +677,7 @@ void GameState::remove(Entity *ptr)
 {
     assert(!dbgLockObjects);
     MapComposite *map = ptr->getMap();
-    int visualRange = Configuration::getValue("game_visualRange", 448);
+    const int visualRange = GameState::visualRangeOption;
 
     ptr->removed();
 
@@ -757,7 +838,7 @@ void GameState::enqueueWarp(Character *ptr, MapComposite *m, int x, int y)
 void GameState::sayAround(Actor *obj, const std::string &text)
 {
     Point speakerPosition = obj->getPosition();
-    int visualRange = Configuration::getValue("game_visualRange", 448);
+    const int visualRange = GameState::visualRangeOption;
 
     for (CharacterIterator i(obj->getMap()->getAroundActorIterator(obj, visualRange)); i; ++i)
     {
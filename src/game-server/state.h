@@ -28,9 +28,19 @@ class Entity;
 class Actor;
 class Character;
 
+namespace Configuration
+{
+    class IntOption;
+}
 
 namespace GameState
 {
+    /**
+     * Distance up to which characters see the actors around them, the
+     * game_visualRange option.
+     */
+    extern Configuration::IntOption visualRangeOption;
+
     /**
      * Updates game state (contains core server logic).
      */
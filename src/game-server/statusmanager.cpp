@@ -44,10 +44,9 @@ void StatusManager::initialize(const std::string &file)
 
 void StatusManager::reload()
 {
-    XML::Document doc(statusReferenceFile);
-    xmlNodePtr rootNode = doc.rootNode();
+    XML::Reader reader(statusReferenceFile);
 
-    if (!rootNode || !xmlStrEqual(rootNode->name, BAD_CAST "status-effects"))
+    if (!xmlStrEqual(reader.rootName(), BAD_CAST "status-effects"))
     {
         LOG_ERROR("Status Manager: Error while parsing status database ("
                   << statusReferenceFile << ")!");
@@ -55,7 +54,7 @@ void StatusManager::reload()
     }
 
     LOG_INFO("Loading status reference: " << statusReferenceFile);
-    for_each_xml_child_node(node, rootNode)
+    while (xmlNodePtr node = reader.nextChild())
     {
         if (!xmlStrEqual(node->name, BAD_CAST "status-effect"))
             continue;
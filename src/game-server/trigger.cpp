@@ -27,6 +27,7 @@
 
 #include "utils/logger.h"
 
+#include <algorithm>
 #include <cassert>
 
 void WarpAction::process(Actor *obj)
@@ -58,26 +59,72 @@ void ScriptAction::process(Actor *obj)
 
 void TriggerArea::update()
 {
-    std::set<Actor*> insideNow;
-    for (BeingIterator i(getMap()->getInsideRectangleIterator(mZone)); i; ++i)
+    // The action may warp or remove beings, which then leave the area, so a
+    // copy is processed and the beings that left meanwhile are skipped.
+    std::vector<Actor *> actors;
+    if (mOnce)
+        actors.swap(mEntered);
+    else
+        actors = mInside;
+
+    for (size_t i = 0; i < actors.size(); ++i)
     {
-        // Don't deal with unitialized actors.
-        if (!(*i) || !(*i)->isPublicIdValid())
-            continue;
-
-        // The BeingIterator returns the mapZones in touch with the rectangle
-        // area. On the other hand, the beings contained in the map zones
-        // may not be within the rectangle area. Hence, this additional
-        // contains() condition.
-        if (mZone.contains((*i)->getPosition()))
+        if (std::find(mInside.begin(), mInside.end(), actors[i])
+                != mInside.end())
         {
-            insideNow.insert(*i);
-
-            if (!mOnce || mInside.find(*i) == mInside.end())
-            {
-                mAction->process(*i);
-            }
+            mAction->process(actors[i]);
         }
     }
-    mInside.swap(insideNow); //swapping is faster than assigning
+}
+
+void TriggerArea::inserted()
+{
+    Entity::inserted();
+    getMap()->addTrigger(this);
+}
+
+void TriggerArea::removed()
+{
+    getMap()->removeTrigger(this);
+    mInside.clear();
+    mEntered.clear();
+    Entity::removed();
+}
+
+void TriggerArea::enter(Actor *obj)
+{
+    // Don't deal with uninitialized actors.
+    if (!obj->isPublicIdValid())
+        return;
+
+    // A being that stopped keeps its old position, so the map may report
+    // the same entry more than once.
+    if (std::find(mInside.begin(), mInside.end(), obj) != mInside.end())
+        return;
+
+    mInside.push_back(obj);
+    if (mOnce)
+        mEntered.push_back(obj);
+}
+
+/**
+ * Removes the actor from the given list, when present. The order of the
+ * actors does not matter.
+ */
+static void removeActor(std::vector<Actor *> &actors, Actor *obj)
+{
+    std::vector<Actor *>::iterator i =
+            std::find(actors.begin(), actors.end(), obj);
+    if (i == actors.end())
+        return;
+
+    *i = actors.back();
+    actors.pop_back();
+}
+
+void TriggerArea::leave(Actor *obj)
+{
+    removeActor(mInside, obj);
+    if (mOnce)
+        removeActor(mEntered, obj);
 }
@@ -25,6 +25,8 @@
 #include "scripting/script.h"
 #include "utils/point.h"
 
+#include <vector>
+
 class Actor;
 
 class TriggerAction
@@ -60,6 +62,13 @@ class ScriptAction : public TriggerAction
         int mArg;               // Argument passed to script function (meaning is function-specific)
 };
 
+/**
+ * A rectangular area that performs an action on the beings inside of it.
+ *
+ * The area does not look for beings itself. Once inserted, it is registered
+ * with the zones of the map it overlaps, and the map tells it when a being
+ * enters or leaves it.
+ */
 class TriggerArea : public Entity
 {
     public:
@@ -71,11 +80,35 @@ class TriggerArea : public Entity
 
         virtual void update();
 
+        /**
+         * Registers the area with its map.
+         */
+        virtual void inserted();
+
+        /**
+         * Unregisters the area from its map.
+         */
+        virtual void removed();
+
+        const Rectangle &getZone() const
+        { return mZone; }
+
+        /**
+         * Called by the map when a being entered the area.
+         */
+        void enter(Actor *obj);
+
+        /**
+         * Called by the map when a being left the area, or the map.
+         */
+        void leave(Actor *obj);
+
     private:
         Rectangle mZone;
         TriggerAction *mAction;
         bool mOnce;
-        std::set<Actor *> mInside;
+        std::vector<Actor *> mInside;
+        std::vector<Actor *> mEntered;  /**< Entered since the last update. */
 };
 
 #endif
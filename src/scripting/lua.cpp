@@ -21,12 +21,15 @@
 
 
 #include <cassert>
+#include <cstdlib>
+#include <new>
 
 extern "C" {
 #include <lualib.h>
 #include <lauxlib.h>
 }
 
+#include "common/configuration.h"
 #include "common/defines.h"
 #include "common/resourcemanager.h"
 #include "game-server/accountconnection.h"
@@ -55,6 +58,7 @@ extern "C" {
 #include "scripting/luascript.h"
 #include "scripting/scriptmanager.h"
 #include "utils/logger.h"
+#include "utils/rangecheck.h"
 #include "utils/speedconv.h"
 
 #include <string.h>
@@ -113,6 +117,18 @@ static int on_update(lua_State *s)
     return 0;
 }
 
+/**
+ * on_batch_dispatch( function(function, int, table, table, table) ): void
+ * Sets the function making the calls of batched callbacks. It is passed the
+ * callback, the number of calls, and arrays with the arguments of each call.
+ */
+static int on_batch_dispatch(lua_State *s)
+{
+    luaL_checktype(s, 1, LUA_TFUNCTION);
+    Script::setBatchDispatchCallback(getScript(s));
+    return 0;
+}
+
 static int on_create_npc_delayed(lua_State *s)
 {
     luaL_checktype(s, 1, LUA_TFUNCTION);
@@ -347,7 +363,7 @@ static int npc_create(lua_State *s)
     }
 
     GameState::enqueueInsert(q);
-    lua_pushlightuserdata(s, q);
+    push(s, q);
     return 1;
 }
 
@@ -1258,11 +1274,32 @@ static int posY(lua_State *s)
     return 1;
 }
 
+/**
+ * being_get_position(Being*): int xcoord, int ycoord
+ * Function for getting the position of a being.
+ */
+static int being_get_position(lua_State *s)
+{
+    Being *being = checkBeing(s, 1);
+    const Point &position = being->getPosition();
+    lua_pushinteger(s, position.x);
+    lua_pushinteger(s, position.y);
+    return 2;
+}
+
+/**
+ * MonsterClass:on_update( function(Monster*) [, bool batched] ): void
+ * Sets the function called each tick for every monster of the class. When
+ * batched is true, the calls of a tick are made together after the map was
+ * updated, which is much cheaper when there are many monsters.
+ */
 static int monster_class_on_update(lua_State *s)
 {
     MonsterClass *monsterClass = LuaMonsterClass::check(s, 1);
     luaL_checktype(s, 2, LUA_TFUNCTION);
-    monsterClass->setUpdateCallback(getScript(s));
+    const bool batched = lua_toboolean(s, 3);
+    lua_settop(s, 2);
+    monsterClass->setUpdateCallback(getScript(s), batched);
     return 0;
 }
 
@@ -1274,12 +1311,20 @@ static int monster_class_on_damage(lua_State *s)
     return 0;
 }
 
+/**
+ * MonsterClass:on( string event, function(Monster*, Being*, int)
+ *                  [, bool batched] ): void
+ * Sets the function called when a monster of the class performs the attack
+ * with the given script event. See MonsterClass:on_update for batched.
+ */
 static int monster_class_on(lua_State *s)
 {
     MonsterClass *monsterClass = LuaMonsterClass::check(s, 1);
     const char *event = luaL_checkstring(s, 2);
     luaL_checktype(s, 3, LUA_TFUNCTION);
-    monsterClass->setEventCallback(event, getScript(s));
+    const bool batched = lua_toboolean(s, 4);
+    lua_settop(s, 3);
+    monsterClass->setEventCallback(event, getScript(s), batched);
     return 0;
 }
 
@@ -1299,7 +1344,7 @@ static int monster_create(lua_State *s)
     q->setPosition(Point(x, y));
     GameState::enqueueInsert(q);
 
-    lua_pushlightuserdata(s, q);
+    push(s, q);
     return 1;
 }
 
@@ -1518,7 +1563,7 @@ static int chat_message(lua_State *s)
 static int get_beings_in_circle(lua_State *s)
 {
     int x, y, r;
-    if (lua_islightuserdata(s, 1))
+    if (LuaEntity::getHandle(s, 1))
     {
         Being *b = checkBeing(s, 1);
         const Point &pos = b->getPosition();
@@ -1539,22 +1584,41 @@ static int get_beings_in_circle(lua_State *s)
     lua_newtable(s);
     int tableStackPosition = lua_gettop(s);
     int tableIndex = 1;
+
+    // Pack the positions and sizes of the beings of the zones around, then
+    // test them all at once.
+    std::vector< Being * > beings;
+    std::vector< int > beingX, beingY, sizes;
     for (BeingIterator i(m->getAroundPointIterator(Point(x, y), r)); i; ++i)
     {
         Being *b = *i;
         char t = b->getType();
         if (t == OBJECT_NPC || t == OBJECT_CHARACTER || t == OBJECT_MONSTER)
         {
-            if (Collision::circleWithCircle(b->getPosition(), b->getSize(),
-                                            Point(x, y), r))
-            {
-                lua_pushlightuserdata(s, b);
-                lua_rawseti(s, tableStackPosition, tableIndex);
-                tableIndex++;
-            }
+            const Point &pos = b->getPosition();
+            beings.push_back(b);
+            beingX.push_back(pos.x);
+            beingY.push_back(pos.y);
+            sizes.push_back(b->getSize());
         }
     }
 
+    const unsigned count = beings.size();
+    if (!count)
+        return 1;
+
+    std::vector< unsigned > inCircle(count);
+    const unsigned found = utils::range::circlesWithCircle(
+            Point(x, y), r, &beingX[0], &beingY[0], &sizes[0], count,
+            &inCircle[0]);
+
+    for (unsigned i = 0; i < found; ++i)
+    {
+        push(s, beings[inCircle[i]]);
+        lua_rawseti(s, tableStackPosition, tableIndex);
+        tableIndex++;
+    }
+
     return 1;
 }
 
@@ -1583,7 +1647,7 @@ static int get_beings_in_rectangle(lua_State *s)
         char t = b->getType();
         if (t == OBJECT_NPC || t == OBJECT_CHARACTER || t == OBJECT_MONSTER)
         {
-            lua_pushlightuserdata(s, b);
+            push(s, b);
             lua_rawseti(s, tableStackPosition, tableIndex);
             tableIndex++;
         }
@@ -1591,6 +1655,253 @@ static int get_beings_in_rectangle(lua_State *s)
      return 1;
  }
 
+/**
+ * Area and filters of a query made by the beings_in_* and count_beings_in_*
+ * functions, and the position of the query in the zones of the map.
+ */
+struct BeingQuery
+{
+    BeingQuery(const MapComposite *map, const ZoneIterator &zones):
+        map(map),
+        hibernations(map->getHibernationCount()),
+        zones(zones),
+        pos(0),
+        typeMask(1 << OBJECT_NPC | 1 << OBJECT_CHARACTER | 1 << OBJECT_MONSTER),
+        aliveOnly(false),
+        circle(false),
+        radius(0)
+    {}
+
+    /**
+     * Returns the next matching being, or 0 when there are none left. The
+     * zones are checked again on every call, so that changes to the map in
+     * between two calls cannot cause invalid accesses. A query kept while
+     * the map hibernated ends, as its zones are gone.
+     */
+    Being *next()
+    {
+        if (map->getHibernationCount() != hibernations)
+            zones = ZoneIterator();
+
+        while (zones)
+        {
+            MapZone *zone = *zones;
+            if (pos >= zone->nbMovingObjects)
+            {
+                ++zones;
+                pos = 0;
+                continue;
+            }
+
+            Being *b = static_cast<Being *>(zone->objects[pos++]);
+            if (matches(b))
+                return b;
+        }
+        return 0;
+    }
+
+    bool matches(Being *b) const
+    {
+        if (!(typeMask & 1 << b->getType()))
+            return false;
+        if (aliveOnly && b->getAction() == DEAD)
+            return false;
+        if (circle)
+            return Collision::circleWithCircle(b->getPosition(), b->getSize(),
+                                               center, radius);
+        return rectangle.contains(b->getPosition());
+    }
+
+    const MapComposite *map;
+    unsigned hibernations;  /**< Hibernations of the map when created. */
+    ZoneIterator zones;
+    unsigned pos;           /**< Next object of the current zone. */
+    int typeMask;           /**< Bit per accepted entity type. */
+    bool aliveOnly;
+    bool circle;            /**< Whether the area is a circle. */
+    Point center;
+    int radius;
+    Rectangle rectangle;
+};
+
+static char const *BEING_QUERY = "BeingQuery";
+
+/**
+ * Returns the bit of the type mask of a query for the entity type at \a index
+ * of the stack, which was given as argument \a arg.
+ */
+static int checkTypeBit(lua_State *s, int index, int arg)
+{
+    const lua_Integer type = lua_tointeger(s, index);
+    if (!lua_isnumber(s, index) || type < OBJECT_ITEM || type > OBJECT_OTHER)
+        luaL_argerror(s, arg, "invalid entity type");
+    return 1 << type;
+}
+
+/**
+ * Reads the optional type and alive filters of a query, starting at \a p.
+ * The type filter is either a single entity type or a table of them.
+ */
+static void checkBeingFilters(lua_State *s, int p, BeingQuery &query)
+{
+    if (lua_isnumber(s, p))
+    {
+        query.typeMask = checkTypeBit(s, p, p);
+    }
+    else if (lua_istable(s, p))
+    {
+        query.typeMask = 0;
+        const int count = lua_objlen(s, p);
+        for (int i = 1; i <= count; ++i)
+        {
+            lua_rawgeti(s, p, i);
+            query.typeMask |= checkTypeBit(s, -1, p);
+            lua_pop(s, 1);
+        }
+    }
+    else if (!lua_isnoneornil(s, p))
+    {
+        luaL_typerror(s, p, "entity type or table of entity types");
+    }
+
+    query.aliveOnly = lua_toboolean(s, p + 1);
+}
+
+/**
+ * Reads the arguments of a circle query, either a center being and a radius
+ * or a center position and a radius, followed by the optional filters.
+ */
+static BeingQuery checkCircleQuery(lua_State *s)
+{
+    Point center;
+    int radius, filters;
+    if (LuaEntity::getHandle(s, 1))
+    {
+        center = checkBeing(s, 1)->getPosition();
+        radius = luaL_checkint(s, 2);
+        filters = 3;
+    }
+    else
+    {
+        center.x = luaL_checkint(s, 1);
+        center.y = luaL_checkint(s, 2);
+        radius = luaL_checkint(s, 3);
+        filters = 4;
+    }
+
+    MapComposite *m = checkCurrentMap(s);
+    BeingQuery query(m, m->getAroundPointIterator(center, radius));
+    query.circle = true;
+    query.center = center;
+    query.radius = radius;
+    checkBeingFilters(s, filters, query);
+    return query;
+}
+
+static BeingQuery checkRectangleQuery(lua_State *s)
+{
+    Rectangle rect;
+    rect.x = luaL_checkint(s, 1);
+    rect.y = luaL_checkint(s, 2);
+    rect.w = luaL_checkint(s, 3);
+    rect.h = luaL_checkint(s, 4);
+
+    MapComposite *m = checkCurrentMap(s);
+    BeingQuery query(m, m->getInsideRectangleIterator(rect));
+    query.rectangle = rect;
+    checkBeingFilters(s, 5, query);
+    return query;
+}
+
+static int being_query_next(lua_State *s)
+{
+    BeingQuery *query =
+            static_cast<BeingQuery *>(luaL_checkudata(s, 1, BEING_QUERY));
+    if (Being *b = query->next())
+        push(s, b);
+    else
+        lua_pushnil(s);
+    return 1;
+}
+
+static int being_query_gc(lua_State *s)
+{
+    BeingQuery *query = static_cast<BeingQuery *>(lua_touserdata(s, 1));
+    query->~BeingQuery();
+    return 0;
+}
+
+/**
+ * Pushes the iterator function and state of a generic for loop over the
+ * results of the query.
+ */
+static int pushBeingQuery(lua_State *s, const BeingQuery &query)
+{
+    lua_pushcfunction(s, being_query_next);
+    void *userData = lua_newuserdata(s, sizeof(BeingQuery));
+    new (userData) BeingQuery(query);
+    luaL_getmetatable(s, BEING_QUERY);
+    lua_setmetatable(s, -2);
+    return 2;
+}
+
+static int countBeings(lua_State *s, BeingQuery query)
+{
+    int count = 0;
+    while (query.next())
+        ++count;
+    lua_pushinteger(s, count);
+    return 1;
+}
+
+/**
+ * beings_in_circle(int x, int y, int radius [, type [, bool alive]]): iterator
+ * beings_in_circle(handle centerBeing, int radius [, type [, bool alive]]):
+ *     iterator
+ * Iterates over the beings inside of a circular area of the current map,
+ * without creating a table: for being in beings_in_circle(x, y, r) do ...
+ * The optional type is an entity type or a table of entity types, and
+ * defaults to NPCs, characters and monsters. When alive is true, dead
+ * beings are skipped.
+ */
+static int beings_in_circle(lua_State *s)
+{
+    return pushBeingQuery(s, checkCircleQuery(s));
+}
+
+/**
+ * beings_in_rectangle(int x, int y, int width, int height
+ *                     [, type [, bool alive]]): iterator
+ * Iterates over the beings inside of a rectangular area of the current map.
+ * Takes the same filters as beings_in_circle.
+ */
+static int beings_in_rectangle(lua_State *s)
+{
+    return pushBeingQuery(s, checkRectangleQuery(s));
+}
+
+/**
+ * count_beings_in_circle(int x, int y, int radius [, type [, bool alive]]):
+ *     int
+ * count_beings_in_circle(handle centerBeing, int radius
+ *                        [, type [, bool alive]]): int
+ * Returns the number of beings beings_in_circle would iterate over.
+ */
+static int count_beings_in_circle(lua_State *s)
+{
+    return countBeings(s, checkCircleQuery(s));
+}
+
+/**
+ * count_beings_in_rectangle(int x, int y, int width, int height
+ *                           [, type [, bool alive]]): int
+ * Returns the number of beings beings_in_rectangle would iterate over.
+ */
+static int count_beings_in_rectangle(lua_State *s)
+{
+    return countBeings(s, checkRectangleQuery(s));
+}
+
 /**
  * get_character_by_name(string name): Character*
  * Returns the character handle or NULL if there is none
@@ -1603,7 +1914,7 @@ static int get_character_by_name(lua_State *s)
     if (!ch)
         lua_pushnil(s);
     else
-        lua_pushlightuserdata(s, ch);
+        push(s, ch);
 
     return 1;
 }
@@ -1920,7 +2231,7 @@ static int chr_get_special_mana(lua_State *s)
     SpecialMap::iterator it = c->findSpecial(special);
     luaL_argcheck(s, it != c->getSpecialEnd(), 2,
                   "character does not have special");
-    lua_pushinteger(s, it->second.currentMana);
+    lua_pushinteger(s, it->second.getCurrentMana());
     return 1;
 }
 
@@ -2316,12 +2627,20 @@ static int specialinfo_get_category(lua_State *s)
     return 1;
 }
 
+/**
+ * SpecialInfo:on_recharged( function(Character*, int) [, bool batched] ): void
+ * Sets the function called when a character recharged the special. See
+ * MonsterClass:on_update for batched.
+ */
 static int specialinfo_on_recharged(lua_State *s)
 {
     SpecialManager::SpecialInfo *info = LuaSpecialInfo::check(s, 1);
     Script *script = getScript(s);
     luaL_checktype(s, 2, LUA_TFUNCTION);
+    const bool batched = lua_toboolean(s, 3);
+    lua_settop(s, 2);
     script->assignCallback(info->rechargedCallback);
+    info->rechargedCallback.batched = batched;
     return 0;
 }
 
@@ -2341,20 +2660,49 @@ static int require_loader(lua_State *s)
     std::string filename = file;
     filename.append(".lua");
 
-    const std::string path = ResourceManager::resolve(filename);
-    if (!path.empty())
-        luaL_loadfile(s, path.c_str());
+    int size;
+    char *buffer = ResourceManager::loadFile(filename, size);
+    if (buffer)
+    {
+        const std::string name = "@" + ResourceManager::resolve(filename);
+        LuaScript *script = static_cast<LuaScript *>(getScript(s));
+        script->loadChunk(s, buffer, size, name.c_str());
+        free(buffer);
+    }
     else
+    {
         lua_pushstring(s, "File not found");
+    }
 
     return 1;
 }
 
 
 LuaScript::LuaScript():
-    nbArgs(-1)
-{
-    mRootState = luaL_newstate();
+    nbArgs(-1),
+    mThreadPoolSize(Configuration::getValue("script_threadPoolSize", 64)),
+    mCollectBetweenTicks(Configuration::getBoolValue("script_gcBetweenTicks",
+                                                     true)),
+    mCollecting(false),
+    mAutomaticCollection(false),
+    mCollectionPause(Configuration::getValue("script_gcPause", 200)),
+    mCollectionThreshold(0),
+    mCollections(0),
+    mCollectionTime(0)
+{
+    mBytecodeCache.setDirectory(
+            Configuration::getValue("script_bytecodeCache", std::string()));
+
+    mRootState = lua_newstate(LuaAllocator::allocate, &mAllocator);
+    mUsingAllocator = mRootState != 0;
+    if (!mUsingAllocator)
+    {
+        // LuaJIT only supports its own allocator on some platforms
+        LOG_INFO("Lua does not support custom allocators, memory usage "
+                 "will only be estimated.");
+        mRootState = luaL_newstate();
+    }
+    lua_atpanic(mRootState, panic);
     mCurrentState = mRootState;
     luaL_openlibs(mRootState);
 
@@ -2373,6 +2721,7 @@ LuaScript::LuaScript():
         { "on_being_death",                  &on_being_death                  },
         { "on_being_remove",                 &on_being_remove                 },
         { "on_update",                       &on_update                       },
+        { "on_batch_dispatch",               &on_batch_dispatch               },
         { "on_create_npc_delayed",           &on_create_npc_delayed           },
         { "on_map_initialize",               &on_map_initialize               },
         { "on_craft",                        &on_craft                        },
@@ -2454,11 +2803,16 @@ LuaScript::LuaScript():
         { "being_set_walkmask",              &being_set_walkmask              },
         { "being_get_walkmask",              &being_get_walkmask              },
         { "being_get_mapid",                 &being_get_mapid                 },
+        { "being_get_position",              &being_get_position              },
         { "posX",                            &posX                            },
         { "posY",                            &posY                            },
         { "trigger_create",                  &trigger_create                  },
         { "chat_message",                    &chat_message                    },
         { "get_beings_in_circle",            &get_beings_in_circle            },
+        { "beings_in_circle",                &beings_in_circle                },
+        { "beings_in_rectangle",             &beings_in_rectangle             },
+        { "count_beings_in_circle",          &count_beings_in_circle          },
+        { "count_beings_in_rectangle",       &count_beings_in_rectangle       },
         { "get_beings_in_rectangle",         &get_beings_in_rectangle         },
         { "get_character_by_name",           &get_character_by_name           },
         { "being_register",                  &being_register                  },
@@ -2519,12 +2873,111 @@ LuaScript::LuaScript():
         { NULL, NULL}
     };
 
+    static luaL_Reg const members_Entity[] = {
+        { NULL, NULL }
+    };
+
+    static luaL_Reg const members_Being[] = {
+        { "apply_status",                    &being_apply_status              },
+        { "remove_status",                   &being_remove_status             },
+        { "has_status",                      &being_has_status                },
+        { "set_status_time",                 &being_set_status_time           },
+        { "get_status_time",                 &being_get_status_time           },
+        { "get_gender",                      &being_get_gender                },
+        { "set_gender",                      &being_set_gender                },
+        { "type",                            &being_type                      },
+        { "walk",                            &being_walk                      },
+        { "say",                             &being_say                       },
+        { "damage",                          &being_damage                    },
+        { "heal",                            &being_heal                      },
+        { "get_name",                        &being_get_name                  },
+        { "get_action",                      &being_get_action                },
+        { "set_action",                      &being_set_action                },
+        { "get_direction",                   &being_get_direction             },
+        { "set_direction",                   &being_set_direction             },
+        { "apply_attribute_modifier",        &being_apply_attribute_modifier  },
+        { "remove_attribute_modifier",       &being_remove_attribute_modifier },
+        { "set_base_attribute",              &being_set_base_attribute        },
+        { "get_modified_attribute",          &being_get_modified_attribute    },
+        { "get_base_attribute",              &being_get_base_attribute        },
+        { "set_walkmask",                    &being_set_walkmask              },
+        { "get_walkmask",                    &being_get_walkmask              },
+        { "get_mapid",                       &being_get_mapid                 },
+        { "get_position",                    &being_get_position              },
+        { "register",                        &being_register                  },
+        { NULL, NULL }
+    };
+
+    static luaL_Reg const members_Character[] = {
+        { "warp",                            &chr_warp                        },
+        { "get_inventory",                   &chr_get_inventory               },
+        { "inv_change",                      &chr_inv_change                  },
+        { "inv_count",                       &chr_inv_count                   },
+        { "get_equipment",                   &chr_get_equipment               },
+        { "equip_slot",                      &chr_equip_slot                  },
+        { "equip_item",                      &chr_equip_item                  },
+        { "unequip_slot",                    &chr_unequip_slot                },
+        { "unequip_item",                    &chr_unequip_item                },
+        { "get_level",                       &chr_get_level                   },
+        { "get_quest",                       &chr_get_quest                   },
+        { "set_quest",                       &chr_set_quest                   },
+        { "get_post",                        &chr_get_post                    },
+        { "get_exp",                         &chr_get_exp                     },
+        { "give_exp",                        &chr_give_exp                    },
+        { "get_rights",                      &chr_get_rights                  },
+        { "set_hair_style",                  &chr_set_hair_style              },
+        { "get_hair_style",                  &chr_get_hair_style              },
+        { "set_hair_color",                  &chr_set_hair_color              },
+        { "get_hair_color",                  &chr_get_hair_color              },
+        { "get_kill_count",                  &chr_get_kill_count              },
+        { "give_special",                    &chr_give_special                },
+        { "has_special",                     &chr_has_special                 },
+        { "take_special",                    &chr_take_special                },
+        { "set_special_recharge_speed",      &chr_set_special_recharge_speed  },
+        { "get_special_recharge_speed",      &chr_get_special_recharge_speed  },
+        { "set_special_mana",                &chr_set_special_mana            },
+        { "get_special_mana",                &chr_get_special_mana            },
+        { "kick",                            &chr_kick                        },
+        { "shake_screen",                    &chr_shake_screen                },
+        { NULL, NULL }
+    };
+
+    static luaL_Reg const members_Monster[] = {
+        { "change_anger",                    &monster_change_anger            },
+        { "remove",                          &monster_remove                  },
+        { NULL, NULL }
+    };
+
+    static luaL_Reg const members_NPC[] = {
+        { "message",                         &npc_message                     },
+        { "choice",                          &npc_choice                      },
+        { "trade",                           &npc_trade                       },
+        { "post",                            &npc_post                        },
+        { "enable",                          &npc_enable                      },
+        { "disable",                         &npc_disable                     },
+        { "ask_integer",                     &npc_ask_integer                 },
+        { "ask_string",                      &npc_ask_string                  },
+        { NULL, NULL }
+    };
+
     LuaItemClass::registerType(mRootState, "ItemClass", members_ItemClass);
     LuaMapObject::registerType(mRootState, "MapObject", members_MapObject);
     LuaMonsterClass::registerType(mRootState, "MonsterClass", members_MonsterClass);
     LuaStatusEffect::registerType(mRootState, "StatusEffect", members_StatusEffect);
     LuaSpecialInfo::registerType(mRootState, "SpecialInfo", members_SpecialInfo);
 
+    LuaEntity::registerType(mRootState, "Entity", members_Entity);
+    LuaEntity::registerType(mRootState, "Being", members_Being, "Entity");
+    LuaEntity::registerType(mRootState, "Character", members_Character, "Being");
+    LuaEntity::registerType(mRootState, "Monster", members_Monster, "Being");
+    LuaEntity::registerType(mRootState, "NPC", members_NPC, "Being");
+
+    // The state of the beings_in_* iterators
+    luaL_newmetatable(mRootState, BEING_QUERY);
+    lua_pushcfunction(mRootState, being_query_gc);
+    lua_setfield(mRootState, -2, "__gc");
+    lua_pop(mRootState, 1);
+
     // Make script object available to callback functions.
     lua_pushlightuserdata(mRootState, const_cast<char *>(&registryKey));
     lua_pushlightuserdata(mRootState, this);
@@ -2536,4 +2989,10 @@ LuaScript::LuaScript():
     lua_remove(mRootState, 1);                  // remove the 'debug' table
 
     loadFile("scripts/lua/libmana.lua");
+
+    if (mCollectBetweenTicks)
+    {
+        lua_gc(mRootState, LUA_GCSTOP, 0);
+        mCollectionThreshold = getMemoryUsed() * mCollectionPause / 100;
+    }
 }
@@ -0,0 +1,154 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scripting/luaallocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+LuaAllocator::LuaAllocator():
+    mUsed(0),
+    mPeak(0),
+    mAllocated(0)
+{
+    std::fill(mFreeBlocks, mFreeBlocks + CLASS_COUNT, (FreeBlock *) 0);
+}
+
+LuaAllocator::~LuaAllocator()
+{
+    for (std::vector<char *>::iterator it = mPages.begin(),
+         it_end = mPages.end(); it != it_end; ++it)
+    {
+        free(*it);
+    }
+}
+
+void *LuaAllocator::allocate(void *allocator, void *ptr,
+                             size_t oldSize, size_t newSize)
+{
+    return static_cast<LuaAllocator *>(allocator)->reallocate(ptr, oldSize,
+                                                              newSize);
+}
+
+void *LuaAllocator::reallocate(void *ptr, size_t oldSize, size_t newSize)
+{
+    if (!ptr)
+        oldSize = 0;
+
+    if (newSize == 0)
+    {
+        if (ptr)
+        {
+            freeBlock(ptr, oldSize);
+            mUsed -= oldSize;
+        }
+        return 0;
+    }
+
+    void *result;
+
+    if (ptr && oldSize > MAX_POOLED_SIZE && newSize > MAX_POOLED_SIZE)
+    {
+        result = realloc(ptr, newSize);
+    }
+    else if (ptr && oldSize <= MAX_POOLED_SIZE && newSize <= MAX_POOLED_SIZE
+             && getSizeClass(oldSize) == getSizeClass(newSize))
+    {
+        result = ptr;
+    }
+    else
+    {
+        result = allocateBlock(newSize);
+        if (result && ptr)
+        {
+            memcpy(result, ptr, std::min(oldSize, newSize));
+            freeBlock(ptr, oldSize);
+        }
+    }
+
+    if (!result)
+    {
+        // Lua expects shrinking a block to always succeed. The old block is
+        // big enough, it will just be freed as if it had the new size.
+        if (ptr && newSize <= oldSize)
+            result = ptr;
+        else
+            return 0;
+    }
+
+    mUsed = mUsed - oldSize + newSize;
+    mPeak = std::max(mPeak, mUsed);
+    if (newSize > oldSize)
+        mAllocated += newSize - oldSize;
+
+    return result;
+}
+
+void *LuaAllocator::allocateBlock(size_t size)
+{
+    if (size > MAX_POOLED_SIZE)
+        return malloc(size);
+
+    const unsigned sizeClass = getSizeClass(size);
+    if (!mFreeBlocks[sizeClass] && !addPage(sizeClass))
+        return 0;
+
+    FreeBlock *block = mFreeBlocks[sizeClass];
+    mFreeBlocks[sizeClass] = block->next;
+    return block;
+}
+
+void LuaAllocator::freeBlock(void *ptr, size_t size)
+{
+    if (size > MAX_POOLED_SIZE)
+    {
+        free(ptr);
+        return;
+    }
+
+    const unsigned sizeClass = getSizeClass(size);
+    FreeBlock *block = static_cast<FreeBlock *>(ptr);
+    block->next = mFreeBlocks[sizeClass];
+    mFreeBlocks[sizeClass] = block;
+}
+
+/**
+ * Splits a new page into free blocks of the given size class.
+ */
+bool LuaAllocator::addPage(unsigned sizeClass)
+{
+    char *page = static_cast<char *>(malloc(PAGE_SIZE));
+    if (!page)
+        return false;
+
+    mPages.push_back(page);
+
+    const size_t blockSize = (sizeClass + 1) * GRANULARITY;
+    const size_t blockCount = PAGE_SIZE / blockSize;
+    for (size_t i = blockCount; i > 0; --i)
+    {
+        FreeBlock *block = reinterpret_cast<FreeBlock *>(
+                page + (i - 1) * blockSize);
+        block->next = mFreeBlocks[sizeClass];
+        mFreeBlocks[sizeClass] = block;
+    }
+    return true;
+}
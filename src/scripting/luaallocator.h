@@ -0,0 +1,110 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUAALLOCATOR_H
+#define LUAALLOCATOR_H
+
+#include <cstddef>
+#include <vector>
+
+#ifdef _MSC_VER
+   typedef unsigned __int64 uint64_t;
+#else
+   #include <stdint.h>
+#endif
+
+/**
+ * Memory allocator for a Lua state. Most of the blocks Lua allocates are
+ * small (strings, tables, closures, upvalues), so blocks up to
+ * MAX_POOLED_SIZE bytes are served from free lists of fixed size classes,
+ * carved out of larger pages. Bigger blocks go to the system allocator.
+ *
+ * The pages are only released when the allocator is destroyed, which has to
+ * happen after the Lua state using it was closed.
+ *
+ * Since Lua passes the size of a block when freeing or resizing it, the
+ * allocator also keeps track of the memory used by the state.
+ */
+class LuaAllocator
+{
+    public:
+        LuaAllocator();
+
+        ~LuaAllocator();
+
+        /**
+         * The lua_Alloc function, to be passed to lua_newstate along with
+         * a pointer to the allocator.
+         */
+        static void *allocate(void *allocator, void *ptr,
+                              size_t oldSize, size_t newSize);
+
+        /** Bytes currently allocated by Lua. */
+        size_t getUsed() const
+        { return mUsed; }
+
+        /** Highest number of bytes allocated at once. */
+        size_t getPeak() const
+        { return mPeak; }
+
+        /** Bytes allocated since creation, for measuring allocation rates. */
+        uint64_t getAllocated() const
+        { return mAllocated; }
+
+        /** Bytes of pages reserved for the small blocks. */
+        size_t getPooled() const
+        { return mPages.size() * PAGE_SIZE; }
+
+    private:
+        enum {
+            GRANULARITY = 16,
+            MAX_POOLED_SIZE = 256,
+            CLASS_COUNT = MAX_POOLED_SIZE / GRANULARITY,
+            PAGE_SIZE = 16 * 1024
+        };
+
+        struct FreeBlock
+        {
+            FreeBlock *next;
+        };
+
+        static unsigned getSizeClass(size_t size)
+        { return (size - 1) / GRANULARITY; }
+
+        void *reallocate(void *ptr, size_t oldSize, size_t newSize);
+
+        void *allocateBlock(size_t size);
+
+        void freeBlock(void *ptr, size_t size);
+
+        bool addPage(unsigned sizeClass);
+
+        LuaAllocator(const LuaAllocator &);
+        LuaAllocator &operator=(const LuaAllocator &);
+
+        FreeBlock *mFreeBlocks[CLASS_COUNT];
+        std::vector<char *> mPages;
+
+        size_t mUsed;
+        size_t mPeak;
+        uint64_t mAllocated;
+};
+
+#endif // LUAALLOCATOR_H
@@ -0,0 +1,154 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scripting/luabytecodecache.h"
+
+#include "common/resourcemanager.h"
+#include "utils/logger.h"
+#include "utils/sha256.h"
+
+extern "C" {
+#include <lauxlib.h>
+}
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+static int writeString(lua_State *, const void *p, size_t size, void *data)
+{
+    static_cast<std::string *>(data)->append(static_cast<const char *>(p),
+                                             size);
+    return 0;
+}
+
+LuaBytecodeCache::LuaBytecodeCache():
+    mWritable(false),
+    mHits(0),
+    mMisses(0),
+    mWrites(0)
+{
+}
+
+void LuaBytecodeCache::setDirectory(const std::string &directory)
+{
+    mDirectory = directory;
+    mWritable = false;
+
+    if (mDirectory.empty())
+        return;
+
+    mWritable = ResourceManager::createDirectory(mDirectory);
+    if (!mWritable)
+    {
+        LOG_WARN("Could not create the script bytecode cache directory "
+                 << mDirectory << ", only existing entries will be used.");
+    }
+}
+
+int LuaBytecodeCache::load(lua_State *s, const char *prog, size_t size,
+                           const char *name)
+{
+    if (!isEnabled())
+        return luaL_loadbuffer(s, prog, size, name);
+
+    const std::string path = getPath(s, prog, size, name);
+
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if (file)
+    {
+        const std::string bytecode((std::istreambuf_iterator<char>(file)),
+                                   std::istreambuf_iterator<char>());
+        file.close();
+
+        if (!bytecode.empty() &&
+            luaL_loadbuffer(s, bytecode.data(), bytecode.size(), name) == 0)
+        {
+            ++mHits;
+            return 0;
+        }
+
+        if (!bytecode.empty())
+            lua_pop(s, 1);  // The error message
+
+        LOG_WARN("Ignoring invalid cached bytecode " << path << " of "
+                 << name);
+        std::remove(path.c_str());
+    }
+
+    ++mMisses;
+
+    const int res = luaL_loadbuffer(s, prog, size, name);
+    if (res == 0 && mWritable)
+        store(s, path, name);
+
+    return res;
+}
+
+std::string LuaBytecodeCache::getPath(lua_State *s,
+                                      const char *prog, size_t size,
+                                      const char *name)
+{
+    // The dump of an empty chunk carries the header of the bytecode format,
+    // which depends on the Lua version and the platform.
+    if (mFormat.empty() && luaL_loadbuffer(s, "", 0, "=") == 0)
+    {
+        lua_dump(s, writeString, &mFormat);
+        lua_pop(s, 1);
+    }
+
+    std::string key = mFormat;
+    key += name;
+    key += '\0';
+    key.append(prog, size);
+
+    return mDirectory + "/" + sha256(key) + ".luac";
+}
+
+/**
+ * Writes the bytecode of the function on top of the stack. The file is
+ * written under a temporary name first, so that a server starting at the
+ * same time never reads a partial chunk.
+ */
+void LuaBytecodeCache::store(lua_State *s, const std::string &path,
+                             const char *name)
+{
+    std::string bytecode;
+    if (lua_dump(s, writeString, &bytecode) != 0 || bytecode.empty())
+        return;
+
+    const std::string temporaryPath = path + ".tmp";
+    std::ofstream file(temporaryPath.c_str(),
+                       std::ios::out | std::ios::binary | std::ios::trunc);
+    file.write(bytecode.data(), bytecode.size());
+    file.close();
+
+    if (!file || std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+    {
+        LOG_WARN("Could not write to the script bytecode cache "
+                 << mDirectory << ", disabling writes.");
+        std::remove(temporaryPath.c_str());
+        mWritable = false;
+        return;
+    }
+
+    ++mWrites;
+    LOG_DEBUG("Cached the bytecode of " << name);
+}
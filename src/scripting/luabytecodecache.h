@@ -0,0 +1,86 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUABYTECODECACHE_H
+#define LUABYTECODECACHE_H
+
+extern "C" {
+#include <lua.h>
+}
+
+#include <cstddef>
+#include <string>
+
+/**
+ * A directory of precompiled Lua chunks. Each chunk is stored in a file named
+ * after the SHA-256 hash of its source text, its chunk name and the bytecode
+ * format of the Lua library in use, so that a changed script or a different
+ * Lua version simply misses the cache.
+ *
+ * The files are loaded without any further check, so the directory should
+ * only be writable by the server.
+ */
+class LuaBytecodeCache
+{
+    public:
+        LuaBytecodeCache();
+
+        /**
+         * Sets the cache directory, which is created when it does not exist
+         * yet. An empty path disables the cache.
+         */
+        void setDirectory(const std::string &directory);
+
+        bool isEnabled() const
+        { return !mDirectory.empty(); }
+
+        /**
+         * Loads a chunk like luaL_loadbuffer, using the cached bytecode when
+         * there is one. Otherwise the source is compiled and the result is
+         * added to the cache.
+         */
+        int load(lua_State *s, const char *prog, size_t size,
+                 const char *name);
+
+        unsigned getHits() const
+        { return mHits; }
+
+        unsigned getMisses() const
+        { return mMisses; }
+
+        unsigned getWrites() const
+        { return mWrites; }
+
+    private:
+        std::string getPath(lua_State *s, const char *prog, size_t size,
+                            const char *name);
+
+        void store(lua_State *s, const std::string &path, const char *name);
+
+        std::string mDirectory;
+        std::string mFormat;    /**< Identifies the bytecode format. */
+        bool mWritable;
+
+        unsigned mHits;
+        unsigned mMisses;
+        unsigned mWrites;
+};
+
+#endif // LUABYTECODECACHE_H
@@ -0,0 +1,91 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scripting/luajitscript.h"
+
+#include "game-server/being.h"
+#include "utils/logger.h"
+
+/*
+ * Functions called by the scripts through the LuaJIT FFI. They are looked up
+ * by name in the game server executable, so they need to be exported. Their
+ * declarations are in scripts/lua/libmana-ffi.lua and both need to be kept
+ * in sync.
+ *
+ * The scripts pass the entity userdata, which the FFI turns into a pointer to
+ * its EntityHandle. Invalid arguments, including removed beings, are reported
+ * through the return value, so that the script can fall back to the classic
+ * binding for raising the error.
+ */
+#ifdef _WIN32
+#define FFI_EXPORT extern "C" __declspec(dllexport)
+#else
+#define FFI_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+static Being *getBeing(const void *handle)
+{
+    Entity *entity =
+            Entity::fromHandle(*static_cast<const EntityHandle *>(handle));
+    if (!entity)
+        return 0;
+
+    switch (entity->getType())
+    {
+    case OBJECT_CHARACTER:
+    case OBJECT_MONSTER:
+    case OBJECT_NPC:
+        return static_cast<Being *>(entity);
+    default:
+        return 0;
+    }
+}
+
+FFI_EXPORT int manaserv_being_get_position(const void *handle, int *x, int *y)
+{
+    Being *being = getBeing(handle);
+    if (!being)
+        return 0;
+
+    const Point &position = being->getPosition();
+    *x = position.x;
+    *y = position.y;
+    return 1;
+}
+
+FFI_EXPORT int manaserv_being_get_modified_attribute(const void *handle,
+                                                     int attr, int *value)
+{
+    Being *being = attr > 0 ? getBeing(handle) : 0;
+    if (!being)
+        return 0;
+
+    *value = being->getModifiedAttribute(attr);
+    return 1;
+}
+
+LuaJitScript::LuaJitScript()
+{
+    if (!loadFile("scripts/lua/libmana-ffi.lua"))
+    {
+        LOG_WARN("Could not load the LuaJIT FFI bindings, "
+                 "using the Lua bindings only.");
+    }
+}
@@ -0,0 +1,54 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUAJITSCRIPT_H
+#define LUAJITSCRIPT_H
+
+#include "scripting/luascript.h"
+
+/**
+ * Implementation of the Script class for LuaJIT. It provides the same API as
+ * the Lua engine, but replaces the hottest read-only bindings by functions
+ * going through the LuaJIT FFI, which the JIT compiler can inline into the
+ * calling script code.
+ */
+class LuaJitScript : public LuaScript
+{
+    public:
+        /**
+         * Constructor. Initializes the Lua state like the Lua engine does,
+         * then loads the FFI bindings from libmana-ffi.lua.
+         */
+        LuaJitScript();
+};
+
+static Script *LuaJitFactory()
+{
+    return new LuaJitScript();
+}
+
+struct LuaJitRegister
+{
+    LuaJitRegister() { Script::registerEngine("luajit", LuaJitFactory); }
+};
+
+static LuaJitRegister luaJitDummy;
+
+#endif // LUAJITSCRIPT_H
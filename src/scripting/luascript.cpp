@@ -27,8 +27,10 @@
 #include "game-server/character.h"
 #include "utils/logger.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <sstream>
 
 Script::Ref LuaScript::mDeathNotificationCallback;
 Script::Ref LuaScript::mRemoveNotificationCallback;
@@ -37,6 +39,13 @@ const char LuaScript::registryKey = 0;
 
 LuaScript::~LuaScript()
 {
+    if (mBytecodeCache.isEnabled())
+    {
+        LOG_INFO("Script bytecode cache: " << mBytecodeCache.getHits()
+                 << " hits, " << mBytecodeCache.getMisses() << " misses, "
+                 << mBytecodeCache.getWrites() << " written");
+    }
+
     lua_close(mRootState);
 }
 
@@ -89,10 +98,7 @@ void LuaScript::push(const std::string &v)
 void LuaScript::push(Entity *v)
 {
     assert(nbArgs >= 0);
-    if (v)
-        lua_pushlightuserdata(mCurrentState, v);
-    else
-        lua_pushnil(mCurrentState);
+    LuaEntity::push(mCurrentState, v);
     ++nbArgs;
 }
 
@@ -118,15 +124,80 @@ void LuaScript::push(const std::list<InventoryItem> &itemList)
     ++nbArgs;
 }
 
+/**
+ * Gets the name and chunk of the function on top of the stack, for the
+ * profiler, and pops it.
+ */
+static void describeFunction(lua_State *s, std::string &function,
+                             std::string &chunk)
+{
+    lua_Debug ar;
+    lua_getinfo(s, ">S", &ar);
+
+    std::ostringstream name;
+    name << ar.short_src << ':' << ar.linedefined;
+    function = name.str();
+    chunk = ar.short_src;
+}
+
+/**
+ * Gets the name and chunk of the main function of a thread, for the profiler.
+ */
+static void describeThread(lua_State *s, std::string &function,
+                           std::string &chunk)
+{
+    lua_Debug ar;
+    int level = 0;
+    while (lua_getstack(s, level + 1, &ar))
+        ++level;
+
+    if (lua_getstack(s, level, &ar))
+    {
+        lua_getinfo(s, "S", &ar);
+
+        std::ostringstream name;
+        name << ar.short_src << ':' << ar.linedefined;
+        function = name.str();
+        chunk = ar.short_src;
+    }
+    else
+    {
+        // The thread did not start yet, its function is at the bottom
+        lua_pushvalue(s, 1);
+        describeFunction(s, function, chunk);
+    }
+}
+
 int LuaScript::execute()
 {
     assert(nbArgs >= 0);
 
-
     const int tmpNbArgs = nbArgs;
     nbArgs = -1;
+
+    std::string function, chunk;
+    uint64_t start = 0;
+    if (mProfiler.isEnabled())
+    {
+        if (mProfiledFunction.isValid())
+            lua_rawgeti(mCurrentState, LUA_REGISTRYINDEX,
+                        mProfiledFunction.value);
+        else
+            lua_pushvalue(mCurrentState, -(tmpNbArgs + 1));
+        describeFunction(mCurrentState, function, chunk);
+        start = ScriptProfiler::getTime();
+    }
+    mProfiledFunction = Ref();
+    const uint64_t allocated = mAllocator.getAllocated();
+
     int res = lua_pcall(mCurrentState, tmpNbArgs, 1, 1);
 
+    if (start)
+    {
+        mProfiler.addCall(function, chunk, ScriptProfiler::getTime() - start,
+                          mAllocator.getAllocated() - allocated);
+    }
+
     if (res || !(lua_isnil(mCurrentState, -1) || lua_isnumber(mCurrentState, -1)))
     {
         const char *s = lua_tostring(mCurrentState, -1);
@@ -142,6 +213,87 @@ int LuaScript::execute()
     return res;
 }
 
+/**
+ * Pushes an array of entities, the same way single entities are pushed.
+ */
+static void pushEntities(lua_State *s, const std::vector<Entity *> &entities)
+{
+    const int size = entities.size();
+    lua_createtable(s, size, 0);
+    for (int i = 0; i < size; ++i)
+    {
+        if (entities[i])
+        {
+            LuaEntity::push(s, entities[i]);
+            lua_rawseti(s, -2, i + 1);
+        }
+    }
+}
+
+static void pushValues(lua_State *s, const std::vector<int> &values)
+{
+    const int size = values.size();
+    lua_createtable(s, size, 0);
+    for (int i = 0; i < size; ++i)
+    {
+        lua_pushinteger(s, values[i]);
+        lua_rawseti(s, -2, i + 1);
+    }
+}
+
+void LuaScript::flushBatchedCalls()
+{
+    assert(nbArgs == -1);
+    assert(!mCurrentThread);
+
+    for (CallBatches::iterator it = mCallBatches.begin(),
+         it_end = mCallBatches.end(); it != it_end; ++it)
+    {
+        CallBatch &batch = it->second;
+        if (batch.entities.empty())
+            continue;
+
+        // Calls queued by the callbacks themselves go into a new batch
+        CallBatch calls;
+        calls.arguments = batch.arguments;
+        calls.entities.swap(batch.entities);
+        calls.targets.swap(batch.targets);
+        calls.values.swap(batch.values);
+
+        if (!mBatchDispatchCallback.isValid())
+        {
+            // Without dispatcher, fall back to one call per entity
+            for (unsigned i = 0; i < calls.entities.size(); ++i)
+            {
+                prepare(Ref(it->first));
+                push(calls.entities[i]);
+                if (calls.arguments == 3)
+                    push(calls.targets[i]);
+                if (calls.arguments >= 2)
+                    push(calls.values[i]);
+                execute();
+            }
+            continue;
+        }
+
+        prepare(mBatchDispatchCallback);
+        lua_rawgeti(mCurrentState, LUA_REGISTRYINDEX, it->first);
+        lua_pushinteger(mCurrentState, calls.entities.size());
+        pushEntities(mCurrentState, calls.entities);
+        if (calls.arguments == 3)
+            pushEntities(mCurrentState, calls.targets);
+        else
+            lua_pushnil(mCurrentState);
+        if (calls.arguments >= 2)
+            pushValues(mCurrentState, calls.values);
+        else
+            lua_pushnil(mCurrentState);
+        nbArgs = 5;
+        mProfiledFunction = Ref(it->first);
+        execute();
+    }
+}
+
 bool LuaScript::resume()
 {
     assert(nbArgs >= 0);
@@ -150,9 +302,31 @@ bool LuaScript::resume()
     setMap(mCurrentThread->mMap);
     const int tmpNbArgs = nbArgs;
     nbArgs = -1;
+
+    std::string function, chunk;
+    uint64_t start = 0;
+    if (mProfiler.isEnabled())
+    {
+        // Threads created before the sampling was enabled lack the hook
+        if (mProfiler.isSampling() && lua_gethook(mCurrentState) != profilerHook)
+        {
+            lua_sethook(mCurrentState, profilerHook, LUA_MASKCOUNT,
+                        mProfiler.getSampleInterval());
+        }
+        describeThread(mCurrentState, function, chunk);
+        start = ScriptProfiler::getTime();
+    }
+    const uint64_t allocated = mAllocator.getAllocated();
+
     int result = lua_resume(mCurrentState, tmpNbArgs);
     setMap(0);
 
+    if (start)
+    {
+        mProfiler.addCall(function, chunk, ScriptProfiler::getTime() - start,
+                          mAllocator.getAllocated() - allocated);
+    }
+
     if (result == 0)                // Thread is done
     {
         if (lua_gettop(mCurrentState) > 0)
@@ -210,9 +384,124 @@ void LuaScript::unref(Ref &ref)
     }
 }
 
+void LuaScript::setProfiling(bool enabled, int sampleInterval)
+{
+    Script::setProfiling(enabled, sampleInterval);
+
+    // Threads created from now on inherit the hook of the root state
+    if (mProfiler.isSampling())
+        lua_sethook(mRootState, profilerHook, LUA_MASKCOUNT,
+                    mProfiler.getSampleInterval());
+    else
+        lua_sethook(mRootState, 0, 0, 0);
+}
+
+void LuaScript::profilerHook(lua_State *s, lua_Debug *ar)
+{
+    LuaScript *script = static_cast<LuaScript *>(getScript(s));
+    if (!script->mProfiler.isSampling())
+    {
+        // Left over in a thread after the sampling was disabled
+        lua_sethook(s, 0, 0, 0);
+        return;
+    }
+
+    if (lua_getinfo(s, "Sl", ar) && ar->currentline > 0)
+        script->mProfiler.addSample(ar->short_src, ar->currentline);
+}
+
+int LuaScript::panic(lua_State *s)
+{
+    LOG_FATAL("Unprotected error in call to Lua API: "
+              << lua_tostring(s, -1));
+    return 0;
+}
+
+size_t LuaScript::getMemoryUsed() const
+{
+    if (mUsingAllocator)
+        return mAllocator.getUsed();
+
+    return (size_t) lua_gc(mRootState, LUA_GCCOUNT, 0) * 1024 +
+            lua_gc(mRootState, LUA_GCCOUNTB, 0);
+}
+
+Script::MemoryStatistics LuaScript::getMemoryStatistics() const
+{
+    MemoryStatistics statistics;
+    statistics.used = getMemoryUsed();
+    statistics.peak = mUsingAllocator ? mAllocator.getPeak() : 0;
+    statistics.pooled = mAllocator.getPooled();
+    statistics.collections = mCollections;
+    statistics.collectionTime = mCollectionTime;
+    return statistics;
+}
+
+/**
+ * Makes incremental collection steps until the time left before the next tick
+ * runs out or the cycle is finished. At least one step is made per call, so
+ * that the collection goes on when the ticks take all of their time.
+ */
+void LuaScript::collectGarbage(int milliseconds)
+{
+    // Time kept free for waking up in time for the next tick
+    static const int margin = 2;
+
+    if (!mCollectBetweenTicks)
+        return;
+
+    if (!mCollecting)
+    {
+        if (getMemoryUsed() < mCollectionThreshold)
+            return;
+        mCollecting = true;
+    }
+
+    const uint64_t start = ScriptProfiler::getTime();
+    const uint64_t end = start + std::max(milliseconds - margin, 0) * 1000;
+    uint64_t now;
+
+    do
+    {
+        if (lua_gc(mRootState, LUA_GCSTEP, 0))
+        {
+            mCollecting = false;
+            ++mCollections;
+            mCollectionThreshold = getMemoryUsed() * mCollectionPause / 100;
+
+            if (mAutomaticCollection)
+            {
+                LOG_INFO("Caught up with the script garbage, collecting "
+                         "between ticks again.");
+                mAutomaticCollection = false;
+            }
+        }
+        now = ScriptProfiler::getTime();
+    }
+    while (mCollecting && now < end);
+
+    mCollectionTime += now - start;
+
+    // A step also enables the automatic collector again
+    if (mAutomaticCollection)
+        return;
+
+    lua_gc(mRootState, LUA_GCSTOP, 0);
+
+    // Let Lua collect during the ticks when the garbage is created faster
+    // than it can be collected in between
+    if (mCollecting && getMemoryUsed() > 2 * mCollectionThreshold)
+    {
+        LOG_WARN("Script garbage piles up faster than it is collected "
+                 "between ticks, collecting during the ticks.");
+        lua_gc(mRootState, LUA_GCRESTART, 0);
+        mAutomaticCollection = true;
+    }
+}
+
 void LuaScript::load(const char *prog, const char *name)
 {
-    int res = luaL_loadbuffer(mRootState, prog, std::strlen(prog), name);
+    int res = loadChunk(mRootState, prog, std::strlen(prog), name);
     if (res)
     {
         switch (res) {
@@ -299,12 +588,54 @@ void LuaScript::getPostCallback(Character *q,
 LuaScript::LuaThread::LuaThread(LuaScript *script) :
     Thread(script)
 {
+    ThreadStatistics &statistics = script->mThreadStatistics;
+
+    if (!script->mThreadPool.empty())
+    {
+        const PooledThread &pooled = script->mThreadPool.back();
+        mState = pooled.state;
+        mRef = pooled.ref;
+        script->mThreadPool.pop_back();
+
+        ++statistics.reused;
+        statistics.pooled = script->mThreadPool.size();
+        return;
+    }
+
     mState = lua_newthread(script->mRootState);
     mRef = luaL_ref(script->mRootState, LUA_REGISTRYINDEX);
+    ++statistics.created;
+}
+
+/**
+ * Returns whether the coroutine can run another function. This is only the
+ * case when its last function returned normally, since Lua 5.1 provides no
+ * way to reset a coroutine that is suspended or that raised an error.
+ */
+static bool isReusable(lua_State *s)
+{
+    lua_Debug ar;
+    return lua_status(s) == 0 && !lua_getstack(s, 0, &ar);
 }
 
 LuaScript::LuaThread::~LuaThread()
 {
     LuaScript *luaScript = static_cast<LuaScript*>(mScript);
+    ThreadStatistics &statistics = luaScript->mThreadStatistics;
+
+    if (luaScript->mThreadPool.size() < luaScript->mThreadPoolSize &&
+        isReusable(mState))
+    {
+        lua_settop(mState, 0);
+
+        PooledThread pooled;
+        pooled.state = mState;
+        pooled.ref = mRef;
+        luaScript->mThreadPool.push_back(pooled);
+        statistics.pooled = luaScript->mThreadPool.size();
+        return;
+    }
+
     luaL_unref(luaScript->mRootState, LUA_REGISTRYINDEX, mRef);
+    ++statistics.discarded;
 }
@@ -26,6 +26,8 @@ extern "C" {
 #include <lauxlib.h>
 }
 
+#include "scripting/luaallocator.h"
+#include "scripting/luabytecodecache.h"
 #include "scripting/script.h"
 
 /**
@@ -44,6 +46,14 @@ class LuaScript : public Script
 
         void load(const char *prog, const char *name);
 
+        /**
+         * Loads a chunk as a function on the stack of the given state,
+         * through the bytecode cache.
+         */
+        int loadChunk(lua_State *s, const char *prog, size_t size,
+                      const char *name)
+        { return mBytecodeCache.load(s, prog, size, name); }
+
         Thread *newThread();
 
         void prepare(Ref function);
@@ -62,10 +72,18 @@ class LuaScript : public Script
 
         bool resume();
 
+        void flushBatchedCalls();
+
         void assignCallback(Ref &function);
 
         void unref(Ref &ref);
 
+        void setProfiling(bool enabled, int sampleInterval = 0);
+
+        MemoryStatistics getMemoryStatistics() const;
+
+        void collectGarbage(int milliseconds);
+
         static void getQuestCallback(Character *,
                                      const std::string &value,
                                      Script *);
@@ -99,10 +117,49 @@ class LuaScript : public Script
                 int mRef;
         };
 
+        /**
+         * A coroutine of a finished thread, kept for running later threads.
+         */
+        struct PooledThread
+        {
+            lua_State *state;
+            int ref;            /**< Registry reference keeping it alive. */
+        };
+
+        static void profilerHook(lua_State *s, lua_Debug *ar);
+
+        static int panic(lua_State *s);
+
+        size_t getMemoryUsed() const;
+
+        LuaAllocator mAllocator;
+        bool mUsingAllocator;       /**< Whether Lua accepted mAllocator. */
+
         lua_State *mRootState;
         lua_State *mCurrentState;
         int nbArgs;
 
+        /** Function to profile the next call as, instead of the one called. */
+        Ref mProfiledFunction;
+
+        std::vector<PooledThread> mThreadPool;
+        unsigned mThreadPoolSize;   /**< Maximum number of pooled threads. */
+
+        LuaBytecodeCache mBytecodeCache;
+
+        /**
+         * When collecting between ticks, the automatic collector of Lua is
+         * stopped and a collection cycle is started once the memory in use
+         * grew by mCollectionPause percent since the end of the last one.
+         */
+        bool mCollectBetweenTicks;
+        bool mCollecting;           /**< Whether a cycle is in progress. */
+        bool mAutomaticCollection;  /**< Restarted since we fell behind. */
+        int mCollectionPause;
+        size_t mCollectionThreshold;
+        unsigned long mCollections;
+        uint64_t mCollectionTime;
+
         static Ref mDeathNotificationCallback;
         static Ref mRemoveNotificationCallback;
 
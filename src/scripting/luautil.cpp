@@ -115,6 +115,139 @@ void UserDataCache::insert(lua_State *s, void *object)
 }
 
 
+char LuaEntity::mRegistryKey;
+char LuaEntity::mCacheKey;
+
+void LuaEntity::registerType(lua_State *s,
+                             const char *typeName,
+                             const luaL_Reg *members,
+                             const char *baseTypeName)
+{
+    luaL_newmetatable(s, typeName);             // metatable
+    lua_pushstring(s, "__index");               // metatable, "__index"
+    luaL_register(s, typeName, members);        // metatable, "__index", {}
+
+    if (baseTypeName)
+    {
+        luaL_getmetatable(s, baseTypeName);     // ..., {}, base metatable
+        lua_getfield(s, -1, "__index");         // ..., {}, base metatable, base
+        lua_pushnil(s);
+        while (lua_next(s, -2))                 // ..., {}, bm, base, k, v
+        {
+            lua_pushvalue(s, -2);               // ..., {}, bm, base, k, v, k
+            lua_rawget(s, -6);                  // ..., {}, bm, base, k, v, v?
+            if (lua_isnil(s, -1))
+            {
+                lua_pop(s, 1);                  // ..., {}, bm, base, k, v
+                lua_pushvalue(s, -2);           // ..., {}, bm, base, k, v, k
+                lua_insert(s, -2);              // ..., {}, bm, base, k, k, v
+                lua_rawset(s, -6);              // ..., {}, bm, base, k
+            }
+            else
+            {
+                lua_pop(s, 2);                  // ..., {}, bm, base, k
+            }
+        }
+        lua_pop(s, 2);                          // metatable, "__index", {}
+    }
+
+    lua_rawset(s, -3);                          // metatable
+
+    // Marks the metatable as one of an entity type
+    lua_pushlightuserdata(s, &mRegistryKey);    // metatable, key
+    lua_pushboolean(s, 1);                      // metatable, key, true
+    lua_rawset(s, -3);                          // metatable
+    lua_pop(s, 1);                              // -empty-
+}
+
+static const char *getTypeName(EntityType type)
+{
+    switch (type)
+    {
+    case OBJECT_CHARACTER:
+        return "Character";
+    case OBJECT_MONSTER:
+        return "Monster";
+    case OBJECT_NPC:
+        return "NPC";
+    default:
+        return "Entity";
+    }
+}
+
+void LuaEntity::push(lua_State *s, Entity *entity)
+{
+    if (!entity)
+    {
+        lua_pushnil(s);
+        return;
+    }
+
+    const EntityHandle &handle = entity->getHandle();
+    const int key = handle.index + 1;
+
+    // Retrieve the cache table, indexed by handle slot
+    lua_pushlightuserdata(s, &mCacheKey);           // key
+    lua_rawget(s, LUA_REGISTRYINDEX);               // Cache?
+
+    if (lua_isnil(s, -1))
+    {
+        lua_pop(s, 1);                              // -empty-
+        lua_newtable(s);                            // Cache
+
+        // The metatable that makes the values in the table above weak
+        lua_newtable(s);                            // Cache, {}
+        lua_pushstring(s, "__mode");
+        lua_pushstring(s, "v");
+        lua_rawset(s, -3);                          // Cache, { __mode = "v" }
+        lua_setmetatable(s, -2);                    // Cache
+
+        lua_pushlightuserdata(s, &mCacheKey);       // Cache, key
+        lua_pushvalue(s, -2);                       // Cache, key, Cache
+        lua_rawset(s, LUA_REGISTRYINDEX);           // Cache
+    }
+    else
+    {
+        lua_rawgeti(s, -1, key);                    // Cache, UD?
+
+        // The slot may have been used by a deleted entity before
+        const EntityHandle *cached =
+                static_cast<const EntityHandle *>(lua_touserdata(s, -1));
+        if (cached && cached->generation == handle.generation)
+        {
+            lua_replace(s, -2);                     // UD
+            return;
+        }
+        lua_pop(s, 1);                              // Cache
+    }
+
+    void *userData = lua_newuserdata(s, sizeof(EntityHandle));
+    *static_cast<EntityHandle *>(userData) = handle;    // Cache, UD
+
+    luaL_getmetatable(s, getTypeName(entity->getType()));
+    lua_setmetatable(s, -2);
+
+    lua_pushvalue(s, -1);                           // Cache, UD, UD
+    lua_rawseti(s, -3, key);                        // Cache { key = UD }, UD
+    lua_replace(s, -2);                             // UD
+}
+
+const EntityHandle *LuaEntity::getHandle(lua_State *s, int narg)
+{
+    if (lua_type(s, narg) != LUA_TUSERDATA || !lua_getmetatable(s, narg))
+        return 0;
+
+    lua_pushlightuserdata(s, &mRegistryKey);
+    lua_rawget(s, -2);
+    const bool isEntity = lua_toboolean(s, -1);
+    lua_pop(s, 2);
+
+    if (!isEntity)
+        return 0;
+    return static_cast<const EntityHandle *>(lua_touserdata(s, narg));
+}
+
+
 Script *getScript(lua_State *s)
 {
     lua_pushlightuserdata(s, (void *)&LuaScript::registryKey);
@@ -125,27 +258,31 @@ Script *getScript(lua_State *s)
 }
 
 
-/* Functions below are unsafe, as they assume the script has passed pointers
-   to objects which have not yet been destroyed. If the script never keeps
-   pointers around, there will be no problem. In order to be safe, the engine
-   should replace pointers by local identifiers and store them in a map. By
-   listening to the death of objects, it could keep track of pointers still
-   valid in the map.
-   TODO: do it. */
+static bool isBeing(Entity *entity)
+{
+    switch (entity->getType())
+    {
+    case OBJECT_CHARACTER:
+    case OBJECT_MONSTER:
+    case OBJECT_NPC:
+        return true;
+    default:
+        return false;
+    }
+}
 
 Being *getBeing(lua_State *s, int p)
 {
-    if (!lua_islightuserdata(s, p))
+    Entity *t = LuaEntity::get(s, p);
+    if (!t || !isBeing(t))
         return 0;
-    return static_cast<Being *>(lua_touserdata(s, p));
+    return static_cast<Being *>(t);
 }
 
 Character *getCharacter(lua_State *s, int p)
 {
-    if (!lua_islightuserdata(s, p))
-        return 0;
-    Entity *t = static_cast<Entity *>(lua_touserdata(s, p));
-    if (t->getType() != OBJECT_CHARACTER)
+    Entity *t = LuaEntity::get(s, p);
+    if (!t || t->getType() != OBJECT_CHARACTER)
         return 0;
     return static_cast<Character *>(t);
 }
@@ -172,10 +309,8 @@ ItemClass *getItemClass(lua_State *s, int p)
 
 Monster *getMonster(lua_State *s, int p)
 {
-    if (!lua_islightuserdata(s, p))
-        return 0;
-    Entity *t = static_cast<Entity *>(lua_touserdata(s, p));
-    if (t->getType() != OBJECT_MONSTER)
+    Entity *t = LuaEntity::get(s, p);
+    if (!t || t->getType() != OBJECT_MONSTER)
         return 0;
     return static_cast<Monster *>(t);
 }
@@ -202,26 +337,40 @@ MonsterClass *getMonsterClass(lua_State *s, int p)
 
 NPC *getNPC(lua_State *s, int p)
 {
-    if (!lua_islightuserdata(s, p))
-        return 0;
-    Entity *t = static_cast<Entity *>(lua_touserdata(s, p));
-    if (t->getType() != OBJECT_NPC)
+    Entity *t = LuaEntity::get(s, p);
+    if (!t || t->getType() != OBJECT_NPC)
         return 0;
     return static_cast<NPC *>(t);
 }
 
 
+/**
+ * Raises the error for a missing entity argument, telling apart the entities
+ * that do not exist anymore.
+ */
+static void entityArgError(lua_State *s, int p, const char *expected)
+{
+    const EntityHandle *handle = LuaEntity::getHandle(s, p);
+    if (handle && !Entity::fromHandle(*handle))
+        lua_pushfstring(s, "%s expected, got a removed entity", expected);
+    else
+        lua_pushfstring(s, "%s expected", expected);
+    luaL_argerror(s, p, lua_tostring(s, -1));
+}
+
 Being *checkBeing(lua_State *s, int p)
 {
     Being *being = getBeing(s, p);
-    luaL_argcheck(s, being, p, "being expected");
+    if (!being)
+        entityArgError(s, p, "being");
     return being;
 }
 
 Character *checkCharacter(lua_State *s, int p)
 {
     Character *character = getCharacter(s, p);
-    luaL_argcheck(s, character, p, "character expected");
+    if (!character)
+        entityArgError(s, p, "character");
     return character;
 }
 
@@ -235,7 +384,8 @@ ItemClass *checkItemClass(lua_State *s, int p)
 Monster *checkMonster(lua_State *s, int p)
 {
     Monster *monster = getMonster(s, p);
-    luaL_argcheck(s, monster, p, "monster expected");
+    if (!monster)
+        entityArgError(s, p, "monster");
     return monster;
 }
 
@@ -249,7 +399,8 @@ MonsterClass *checkMonsterClass(lua_State *s, int p)
 NPC *checkNPC(lua_State *s, int p)
 {
     NPC *npc = getNPC(s, p);
-    luaL_argcheck(s, npc, p, "npc expected");
+    if (!npc)
+        entityArgError(s, p, "npc");
     return npc;
 }
 
@@ -311,7 +462,7 @@ void push(lua_State *s, const std::string &val)
 
 void push(lua_State *s, Entity *val)
 {
-    lua_pushlightuserdata(s, val);
+    LuaEntity::push(s, val);
 }
 
 void push(lua_State *s, double val)
@@ -34,6 +34,7 @@ extern "C" {
 #include <set>
 #include <vector>
 
+#include "game-server/entity.h"
 #include "game-server/specialmanager.h"
 
 class Being;
@@ -150,6 +151,58 @@ private:
 
 template <typename T> const char * LuaUserData<T>::mTypeName;
 
+/**
+ * A helper class for pushing and checking entities. The scripts get them as
+ * full userdata holding an EntityHandle, so that entities deleted while the
+ * script still refers to them are detected instead of being accessed.
+ *
+ * Each entity type has its own metatable, giving access to the methods of the
+ * type, like in being:say("Hello").
+ */
+class LuaEntity
+{
+public:
+    /**
+     * Creates the metatable for the entity type named \a typeName. Then,
+     * registers the \a members with a library of the same name, which also
+     * gets the members of \a baseTypeName when given, and sets the '__index'
+     * member of the metatable to this library.
+     */
+    static void registerType(lua_State *s,
+                             const char *typeName,
+                             const luaL_Reg *members,
+                             const char *baseTypeName = 0);
+
+    /**
+     * Pushes a userdata reference to the given entity on the stack. Either by
+     * creating one, or reusing an existing one. Like the UserDataCache, the
+     * cache of the entity references has weak values, but it is indexed by
+     * handle slot for faster lookups.
+     *
+     * When a null-pointer is passed for \a entity, the value 'nil' is pushed.
+     */
+    static void push(lua_State *s, Entity *entity);
+
+    /**
+     * Returns the handle at position \a narg, or 0 when it is no entity.
+     */
+    static const EntityHandle *getHandle(lua_State *s, int narg);
+
+    /**
+     * Returns the entity at position \a narg, or 0 when it is no entity or
+     * when the entity does not exist anymore.
+     */
+    static Entity *get(lua_State *s, int narg)
+    {
+        const EntityHandle *handle = getHandle(s, narg);
+        return handle ? Entity::fromHandle(*handle) : 0;
+    }
+
+private:
+    static char mRegistryKey;
+    static char mCacheKey;
+};
+
 typedef LuaUserData<ItemClass> LuaItemClass;
 typedef LuaUserData<MapObject> LuaMapObject;
 typedef LuaUserData<MonsterClass> LuaMonsterClass;
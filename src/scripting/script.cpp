@@ -37,17 +37,20 @@ static Engines *engines = NULL;
 
 Script::Ref Script::mCreateNpcDelayedCallback;
 Script::Ref Script::mUpdateCallback;
+Script::Ref Script::mBatchDispatchCallback;
 
 Script::Script():
     mCurrentThread(0),
     mMap(0),
-    mEventListener(&scriptEventDispatch)
+    mEventListener(&scriptEventDispatch),
+    mFirstThread(0),
+    mThreadCount(0)
 {}
 
 Script::~Script()
 {
     // There should be no remaining threads when the Script gets deleted
-    assert(mThreads.empty());
+    assert(!mFirstThread);
 }
 
 void Script::registerEngine(const std::string &name, Factory f)
@@ -88,6 +91,39 @@ void Script::update()
     execute();
 }
 
+void Script::queueCall(Ref function, Entity *entity)
+{
+    CallBatch &batch = mCallBatches[function.value];
+    batch.arguments = 1;
+    batch.entities.push_back(entity);
+}
+
+void Script::queueCall(Ref function, Entity *entity, int value)
+{
+    CallBatch &batch = mCallBatches[function.value];
+    batch.arguments = 2;
+    batch.entities.push_back(entity);
+    batch.values.push_back(value);
+}
+
+void Script::queueCall(Ref function, Entity *entity, Entity *target, int value)
+{
+    CallBatch &batch = mCallBatches[function.value];
+    batch.arguments = 3;
+    batch.entities.push_back(entity);
+    batch.targets.push_back(target);
+    batch.values.push_back(value);
+}
+
+void Script::setProfiling(bool enabled, int sampleInterval)
+{
+    if (enabled && !mProfiler.isEnabled())
+        mProfiler.reset();
+
+    mProfiler.setEnabled(enabled);
+    mProfiler.setSampleInterval(sampleInterval);
+}
+
 static char *skipPotentialBom(char *text)
 {
     // Based on the C version of bomstrip
@@ -134,33 +170,26 @@ void Script::loadNPC(const std::string &name,
 }
 
 
-/**
- * Removes one element matching the given value by overwriting it with the last
- * element and then popping the last element.
- */
-template<typename T>
-static void fastRemoveOne(std::vector<T> &vector, T value)
-{
-    for (size_t i = 0, size = vector.size(); i < size; ++i)
-    {
-        if (vector.at(i) == value)
-        {
-            vector.at(i) = vector.back();
-            vector.pop_back();
-            break;
-        }
-    }
-}
-
 Script::Thread::Thread(Script *script) :
     mScript(script),
     mState(ThreadPending),
-    mMap(0)
+    mMap(0),
+    mPrevious(0),
+    mNext(script->mFirstThread)
 {
-    script->mThreads.push_back(this);
+    if (mNext)
+        mNext->mPrevious = this;
+    script->mFirstThread = this;
+    ++script->mThreadCount;
 }
 
 Script::Thread::~Thread()
 {
-    fastRemoveOne(mScript->mThreads, this);
+    if (mPrevious)
+        mPrevious->mNext = mNext;
+    else
+        mScript->mFirstThread = mNext;
+    if (mNext)
+        mNext->mPrevious = mPrevious;
+    --mScript->mThreadCount;
 }
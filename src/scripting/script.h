@@ -24,8 +24,10 @@
 #include "common/inventorydata.h"
 #include "common/manaserv_protocol.h"
 #include "game-server/eventlistener.h"
+#include "scripting/scriptprofiler.h"
 
 #include <list>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -61,10 +63,16 @@ class Script
         class Ref
         {
             public:
-                Ref() : value(-1) {}
-                Ref(int value) : value(value) {}
+                Ref() : value(-1), batched(false) {}
+                Ref(int value) : value(value), batched(false) {}
                 bool isValid() const { return value != -1; }
                 int value;
+
+                /**
+                 * Whether the calls of this callback are queued with
+                 * queueCall() instead of being made right away.
+                 */
+                bool batched;
         };
 
         enum ThreadState {
@@ -88,6 +96,52 @@ class Script
                 Script * const mScript;
                 ThreadState mState;
                 MapComposite *mMap;
+
+            private:
+                /** Neighbours in the list of threads of the script. */
+                Thread *mPrevious;
+                Thread *mNext;
+        };
+
+        /**
+         * Statistics about the reuse of the resources of script threads, by
+         * engines that pool them.
+         */
+        struct ThreadStatistics
+        {
+            ThreadStatistics():
+                created(0),
+                reused(0),
+                discarded(0),
+                pooled(0)
+            {}
+
+            unsigned long created;      /**< Threads that needed new ones. */
+            unsigned long reused;       /**< Threads that got pooled ones. */
+            unsigned long discarded;    /**< Not returned to the pool. */
+            unsigned pooled;            /**< Currently in the pool. */
+        };
+
+        /**
+         * Statistics about the memory of the script state, by engines that
+         * keep track of it.
+         */
+        struct MemoryStatistics
+        {
+            MemoryStatistics():
+                used(0),
+                peak(0),
+                pooled(0),
+                collections(0),
+                collectionTime(0)
+            {}
+
+            size_t used;                /**< Bytes in use. */
+            size_t peak;                /**< Highest bytes in use. */
+            size_t pooled;              /**< Bytes reserved by the engine. */
+            unsigned long collections;  /**< Finished garbage collections. */
+            uint64_t collectionTime;    /**< Time collecting between ticks,
+                                             in microseconds. */
         };
 
         Script();
@@ -176,6 +230,24 @@ class Script
          */
         virtual int execute() = 0;
 
+        /**
+         * Queues a call of \a function, to be made by the next call to
+         * flushBatchedCalls() together with the other queued calls of the
+         * same function. All the calls of a function must be queued with the
+         * same kind of arguments.
+         */
+        void queueCall(Ref function, Entity *entity);
+        void queueCall(Ref function, Entity *entity, int value);
+        void queueCall(Ref function, Entity *entity, Entity *target,
+                       int value);
+
+        /**
+         * Makes the queued calls, with one call into the script engine for
+         * each queued function. Should be called while the entities the calls
+         * were queued for still exist.
+         */
+        virtual void flushBatchedCalls() = 0;
+
         /**
          * Starts or resumes the current thread. Deletes the thread when it is
          * done.
@@ -219,6 +291,40 @@ class Script
         EventListener *getScriptListener()
         { return &mEventListener; }
 
+        /**
+         * Returns the number of existing threads.
+         */
+        unsigned getThreadCount() const
+        { return mThreadCount; }
+
+        const ThreadStatistics &getThreadStatistics() const
+        { return mThreadStatistics; }
+
+        virtual MemoryStatistics getMemoryStatistics() const
+        { return MemoryStatistics(); }
+
+        /**
+         * Called after each world update with the number of milliseconds
+         * left until the next one, for engines that collect their garbage
+         * in that time rather than in the middle of a tick.
+         */
+        virtual void collectGarbage(int milliseconds)
+        {}
+
+        /**
+         * Enables or disables the profiling of the calls into the script.
+         * A positive \a sampleInterval additionally enables the sampling of
+         * the executed lines every that many instructions, when the engine
+         * supports it.
+         */
+        virtual void setProfiling(bool enabled, int sampleInterval = 0);
+
+        const ScriptProfiler &getProfiler() const
+        { return mProfiler; }
+
+        void resetProfiler()
+        { mProfiler.reset(); }
+
         virtual void processDeathEvent(Being *entity) = 0;
 
         virtual void processRemoveEvent(Entity *entity) = 0;
@@ -229,14 +335,45 @@ class Script
         static void setUpdateCallback(Script *script)
         { script->assignCallback(mUpdateCallback); }
 
+        static void setBatchDispatchCallback(Script *script)
+        { script->assignCallback(mBatchDispatchCallback); }
+
     protected:
+        /**
+         * The queued calls of a function. The targets and values are only
+         * filled when the calls take those arguments.
+         */
+        struct CallBatch
+        {
+            CallBatch() : arguments(0) {}
+
+            int arguments;      /**< Number of arguments of each call. */
+            std::vector<Entity *> entities;
+            std::vector<Entity *> targets;
+            std::vector<int> values;
+        };
+
+        /** Queued calls, by function reference. */
+        typedef std::map<int, CallBatch> CallBatches;
+
         std::string mScriptFile;
         Thread *mCurrentThread;
+        CallBatches mCallBatches;
+        ScriptProfiler mProfiler;
+        ThreadStatistics mThreadStatistics;
+
+        /**
+         * The function making the calls of a batch. It is passed the function
+         * to call, the number of calls, the entities and, depending on the
+         * arguments of the calls, the targets and the values.
+         */
+        static Ref mBatchDispatchCallback;
 
     private:
         MapComposite *mMap;
         EventListener mEventListener; /**< Tracking of being deaths. */
-        std::vector<Thread*> mThreads;
+        Thread *mFirstThread;       /**< List of the existing threads. */
+        unsigned mThreadCount;
 
         static Ref mCreateNpcDelayedCallback;
         static Ref mUpdateCallback;
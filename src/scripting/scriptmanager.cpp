@@ -31,8 +31,18 @@ static Script::Ref _getSpecialRechargeCostCallback;
 
 void ScriptManager::initialize()
 {
-    const std::string engine = Configuration::getValue("script_engine", "lua");
+    initialize(Configuration::getValue("script_engine", "lua"));
+}
+
+void ScriptManager::initialize(const std::string &engine)
+{
     _currentState = Script::create(engine);
+
+    if (_currentState && Configuration::getBoolValue("script_profiler", false))
+    {
+        _currentState->setProfiling(true,
+                Configuration::getValue("script_profilerSampleInterval", 0));
+    }
 }
 
 void ScriptManager::deinitialize()
@@ -51,6 +61,47 @@ Script *ScriptManager::currentState()
     return _currentState;
 }
 
+void ScriptManager::logStatistics()
+{
+    if (!_currentState)
+        return;
+
+    const Script::ThreadStatistics &threads =
+            _currentState->getThreadStatistics();
+    LOG_INFO("Script threads: " << _currentState->getThreadCount()
+             << " running, " << threads.pooled << " pooled, "
+             << threads.created << " created, " << threads.reused
+             << " reused, " << threads.discarded << " discarded");
+
+    const Script::MemoryStatistics memory =
+            _currentState->getMemoryStatistics();
+    if (memory.used)
+    {
+        LOG_INFO("Script memory: " << memory.used / 1024 << " KiB used, "
+                 << memory.peak / 1024 << " KiB peak, "
+                 << memory.pooled / 1024 << " KiB pooled, "
+                 << memory.collections << " collections taking "
+                 << memory.collectionTime / 1000 << " ms between ticks");
+    }
+
+    if (!_currentState->getProfiler().isEnabled())
+        return;
+
+    std::list<std::string> lines;
+    _currentState->getProfiler().report(lines, 10);
+    for (std::list<std::string>::const_iterator it = lines.begin(),
+         it_end = lines.end(); it != it_end; ++it)
+    {
+        LOG_INFO(*it);
+    }
+}
+
+void ScriptManager::collectGarbage(int milliseconds)
+{
+    if (_currentState)
+        _currentState->collectGarbage(milliseconds);
+}
+
 bool ScriptManager::performCraft(Being *crafter,
                                  const std::list<InventoryItem> &recipe)
 {
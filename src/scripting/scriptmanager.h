@@ -40,6 +40,12 @@ namespace ScriptManager {
  */
 void initialize();
 
+/**
+ * Initializes the script manager with the given script engine, instead of
+ * the one set by the script_engine option.
+ */
+void initialize(const std::string &engine);
+
 /**
  * Deinitializes the script manager by deleting the script state.
  */
@@ -55,6 +61,18 @@ bool loadMainScript(const std::string &file);
  */
 Script *currentState();
 
+/**
+ * Logs the statistics of the script threads and memory, and the report of the
+ * script profiler when it is enabled.
+ */
+void logStatistics();
+
+/**
+ * Lets the script engine collect garbage in the given number of milliseconds
+ * left until the next tick.
+ */
+void collectGarbage(int milliseconds);
+
 bool performCraft(Being *crafter, const std::list<InventoryItem> &recipe);
 
 void setCraftCallback(Script *script);
@@ -0,0 +1,157 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scripting/scriptprofiler.h"
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include <sys/time.h>
+
+ScriptProfiler::ScriptProfiler():
+    mEnabled(false),
+    mSampleInterval(0),
+    mSampleCount(0),
+    mStartTime(getTime())
+{
+}
+
+uint64_t ScriptProfiler::getTime()
+{
+    timeval time;
+    gettimeofday(&time, 0);
+    return (uint64_t)time.tv_sec * 1000000 + time.tv_usec;
+}
+
+void ScriptProfiler::addCall(const std::string &function,
+                             const std::string &chunk,
+                             uint64_t duration,
+                             uint64_t memory)
+{
+    Entry &entry = mFunctions[function];
+    ++entry.calls;
+    entry.time += duration;
+    entry.maxTime = std::max(entry.maxTime, duration);
+    entry.memory += memory;
+
+    Entry &chunkEntry = mChunks[chunk];
+    ++chunkEntry.calls;
+    chunkEntry.time += duration;
+    chunkEntry.maxTime = std::max(chunkEntry.maxTime, duration);
+    chunkEntry.memory += memory;
+}
+
+void ScriptProfiler::addSample(const std::string &chunk, int line)
+{
+    std::ostringstream location;
+    location << chunk << ':' << line;
+    ++mSamples[location.str()];
+    ++mSampleCount;
+}
+
+void ScriptProfiler::reset()
+{
+    mFunctions.clear();
+    mChunks.clear();
+    mSamples.clear();
+    mSampleCount = 0;
+    mStartTime = getTime();
+}
+
+template <class Iterator>
+static bool hasMoreTime(Iterator a, Iterator b)
+{
+    return a->second.time > b->second.time;
+}
+
+template <class Iterator>
+static bool hasMoreSamples(Iterator a, Iterator b)
+{
+    return a->second > b->second;
+}
+
+void ScriptProfiler::reportEntries(std::list<std::string> &lines,
+                                   const Entries &entries, unsigned count)
+{
+    std::vector<Entries::const_iterator> sorted;
+    for (Entries::const_iterator it = entries.begin(),
+         it_end = entries.end(); it != it_end; ++it)
+    {
+        sorted.push_back(it);
+    }
+
+    count = std::min<unsigned>(count, sorted.size());
+    std::partial_sort(sorted.begin(), sorted.begin() + count, sorted.end(),
+                      hasMoreTime<Entries::const_iterator>);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        const Entry &entry = sorted[i]->second;
+        std::ostringstream line;
+        line << sorted[i]->first << ": " << entry.calls << " calls, "
+             << entry.time / 1000 << " ms total, "
+             << entry.time / entry.calls << " us avg, "
+             << entry.maxTime << " us max";
+        if (entry.memory)
+            line << ", " << entry.memory / 1024 << " KiB allocated";
+        lines.push_back(line.str());
+    }
+}
+
+void ScriptProfiler::report(std::list<std::string> &lines,
+                            unsigned count) const
+{
+    std::ostringstream header;
+    header << "Script profile of the last "
+           << (getTime() - mStartTime) / 1000000 << " s"
+           << (mEnabled ? "" : " (disabled)");
+    lines.push_back(header.str());
+
+    lines.push_back("Functions:");
+    reportEntries(lines, mFunctions, count);
+    lines.push_back("Chunks:");
+    reportEntries(lines, mChunks, count);
+
+    if (mSamples.empty())
+        return;
+
+    std::vector<Samples::const_iterator> sorted;
+    for (Samples::const_iterator it = mSamples.begin(),
+         it_end = mSamples.end(); it != it_end; ++it)
+    {
+        sorted.push_back(it);
+    }
+
+    count = std::min<unsigned>(count, sorted.size());
+    std::partial_sort(sorted.begin(), sorted.begin() + count, sorted.end(),
+                      hasMoreSamples<Samples::const_iterator>);
+
+    std::ostringstream samples;
+    samples << "Lines (" << mSampleCount << " samples):";
+    lines.push_back(samples.str());
+    for (unsigned i = 0; i < count; ++i)
+    {
+        std::ostringstream line;
+        line << sorted[i]->first << ": " << sorted[i]->second << " samples ("
+             << sorted[i]->second * 100 / mSampleCount << "%)";
+        lines.push_back(line.str());
+    }
+}
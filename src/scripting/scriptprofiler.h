@@ -0,0 +1,125 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCRIPTPROFILER_H
+#define SCRIPTPROFILER_H
+
+#include <list>
+#include <map>
+#include <string>
+
+#ifdef _MSC_VER
+   typedef unsigned __int64 uint64_t;
+#else
+   #include <stdint.h>
+#endif
+
+/**
+ * Records where the time spent in scripts goes. The script engines report
+ * each call into the script with the function that was called, the chunk
+ * (file) the function comes from, the wall time it took and, when they can
+ * tell, the memory it allocated. Engines able to
+ * interrupt running scripts can additionally report samples of the currently
+ * executing line, for finding the hot spots inside of the functions.
+ *
+ * The profiler is disabled by default, in which case the engines skip all the
+ * measurements.
+ */
+class ScriptProfiler
+{
+    public:
+        ScriptProfiler();
+
+        void setEnabled(bool enabled)
+        { mEnabled = enabled; }
+
+        bool isEnabled() const
+        { return mEnabled; }
+
+        /**
+         * Sets the number of script instructions between two line samples,
+         * 0 disables the sampling.
+         */
+        void setSampleInterval(int instructions)
+        { mSampleInterval = instructions > 0 ? instructions : 0; }
+
+        int getSampleInterval() const
+        { return mSampleInterval; }
+
+        bool isSampling() const
+        { return mEnabled && mSampleInterval > 0; }
+
+        /**
+         * Returns the current wall time in microseconds, for measuring the
+         * duration of calls.
+         */
+        static uint64_t getTime();
+
+        /**
+         * Records a call of \a function, defined in \a chunk, which took
+         * \a duration microseconds and allocated \a memory bytes.
+         */
+        void addCall(const std::string &function, const std::string &chunk,
+                     uint64_t duration, uint64_t memory = 0);
+
+        /**
+         * Records that the script was executing the given line of \a chunk.
+         */
+        void addSample(const std::string &chunk, int line);
+
+        /**
+         * Forgets all the recorded calls and samples.
+         */
+        void reset();
+
+        /**
+         * Formats the \a count most expensive functions and chunks and the
+         * \a count most sampled lines, one line of text per entry.
+         */
+        void report(std::list<std::string> &lines, unsigned count) const;
+
+    private:
+        struct Entry
+        {
+            Entry(): calls(0), time(0), maxTime(0), memory(0) {}
+
+            unsigned long calls;
+            uint64_t time;          /**< Total time, in microseconds. */
+            uint64_t maxTime;       /**< Longest call, in microseconds. */
+            uint64_t memory;        /**< Total allocated bytes. */
+        };
+
+        typedef std::map<std::string, Entry> Entries;
+        typedef std::map<std::string, unsigned long> Samples;
+
+        static void reportEntries(std::list<std::string> &lines,
+                                  const Entries &entries, unsigned count);
+
+        bool mEnabled;
+        int mSampleInterval;
+
+        Entries mFunctions;     /**< By "chunk:line defined". */
+        Entries mChunks;
+        Samples mSamples;       /**< By "chunk:line". */
+        unsigned long mSampleCount;
+        uint64_t mStartTime;
+};
+
+#endif // SCRIPTPROFILER_H
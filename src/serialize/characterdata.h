@@ -65,9 +65,10 @@ void serializeCharacterData(const T &data, MessageOut &msg)
     }
 
     // status effects currently affecting the character
-    msg.writeInt16(data.getStatusEffectSize());
+    const std::map<int, int> &statusEffects = data.getStatusEffects();
+    msg.writeInt16(statusEffects.size());
     std::map<int, int>::const_iterator status_it;
-    for (status_it = data.getStatusEffectBegin(); status_it != data.getStatusEffectEnd(); status_it++)
+    for (status_it = statusEffects.begin(); status_it != statusEffects.end(); status_it++)
     {
         msg.writeInt16(status_it->first);
         msg.writeInt16(status_it->second);
@@ -94,7 +95,7 @@ void serializeCharacterData(const T &data, MessageOut &msg)
     for (special_it = data.getSpecialBegin(); special_it != data.getSpecialEnd() ; special_it++)
     {
         msg.writeInt32(special_it->first);
-        msg.writeInt32(special_it->second.currentMana);
+        msg.writeInt32(special_it->second.getCurrentMana());
     }
 
     // inventory - must be last because size isn't transmitted
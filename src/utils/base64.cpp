@@ -31,6 +31,27 @@ static char base64_table[] =
 };
 static char base64_pad = '=';
 
+/* the positions of the characters in base64_table, -1 for the others */
+static const short reverse_table[256] =
+{
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+    -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+    -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
 unsigned char *php_base64_encode(const unsigned char *str, int length, int *ret_length) {
     const unsigned char *current = str;
     int i = 0;
@@ -71,23 +92,8 @@ unsigned char *php_base64_encode(const unsigned char *str, int length, int *ret_
 unsigned char *php_base64_decode(const unsigned char *str, int length, int *ret_length) {
     const unsigned char *current = str;
     int ch, i = 0, j = 0, k;
-    /* this sucks for threaded environments */
-    static short reverse_table[256];
-    static int table_built;
     unsigned char *result;
 
-    if (++table_built == 1) {
-        char *chp;
-        for(ch = 0; ch < 256; ch++) {
-            chp = strchr(base64_table, ch);
-            if(chp) {
-                reverse_table[ch] = chp - base64_table;
-            } else {
-                reverse_table[ch] = -1;
-            }
-        }
-    }
-
     result = (unsigned char *)malloc(length + 1);
     if (result == NULL) {
         return NULL;
@@ -23,6 +23,7 @@
 #include "common/configuration.h"
 #include "common/resourcemanager.h"
 #include "utils/string.h"
+#include "utils/thread.h"
 #include "utils/time.h"
 
 #include <fstream>
@@ -50,6 +51,8 @@ bool Logger::mLogRotation = false;
 long Logger::mMaxFileSize = 1024; // 1 Mb
 /** Switch log file each day. */
 bool Logger::mSwitchLogEachDay = false;
+/** Serializes the output of messages logged by several threads. */
+static Mutex mOutputMutex;
 /** Last call date */
 static std::string mLastCallDate;
 /**
@@ -155,6 +158,7 @@ void Logger::output(const std::string &msg, Level atVerbosity)
 
     if (mVerbosity >= atVerbosity)
     {
+        MutexLocker lock(&mOutputMutex);
         bool open = mLogFile.is_open();
 
         if (open)
@@ -0,0 +1,175 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/objectpool.h"
+
+#include "utils/logger.h"
+#include "utils/string.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+namespace utils
+{
+
+bool ObjectPool::mPoisoning = false;
+
+/**
+ * The pools by name. Allocated on first use and never destroyed, since
+ * pooled objects may still be deleted while static objects are destroyed.
+ */
+typedef std::map<std::string, ObjectPool *> Pools;
+
+static Pools &pools()
+{
+    static Pools *pools = new Pools;
+    return *pools;
+}
+
+ObjectPool *ObjectPool::get(const std::string &name, size_t blockSize)
+{
+    ObjectPool *&pool = pools()[name];
+    if (!pool)
+        pool = new ObjectPool(name, blockSize);
+    return pool;
+}
+
+ObjectPool *ObjectPool::getForSize(size_t blockSize)
+{
+    blockSize = (blockSize + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    return get(toString(blockSize) + "-byte nodes", blockSize);
+}
+
+ObjectPool::ObjectPool(const std::string &name, size_t blockSize):
+    mName(name),
+    mFreeBlocks(0),
+    mUsed(0),
+    mPeak(0)
+{
+    blockSize = std::max(blockSize, sizeof(FreeBlock));
+    mBlockSize = (blockSize + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    mBlocksPerSlab = std::max<size_t>(SLAB_SIZE / mBlockSize, 1);
+}
+
+void *ObjectPool::allocate(size_t size)
+{
+    if (size > mBlockSize)
+        return ::operator new(size);
+
+    if (!mFreeBlocks && !addSlab())
+        throw std::bad_alloc();
+
+    FreeBlock *block = mFreeBlocks;
+    mFreeBlocks = block->next;
+
+    if (mPoisoning)
+        checkPoison(block);
+
+    ++mUsed;
+    mPeak = std::max(mPeak, mUsed);
+    return block;
+}
+
+void ObjectPool::deallocate(void *ptr, size_t size)
+{
+    if (!ptr)
+        return;
+
+    if (size > mBlockSize)
+    {
+        ::operator delete(ptr);
+        return;
+    }
+
+    if (mPoisoning)
+        memset(ptr, POISON, mBlockSize);
+
+    FreeBlock *block = static_cast<FreeBlock *>(ptr);
+    block->next = mFreeBlocks;
+    mFreeBlocks = block;
+    --mUsed;
+}
+
+/**
+ * Splits a new slab into free blocks.
+ */
+bool ObjectPool::addSlab()
+{
+    char *slab = static_cast<char *>(malloc(mBlocksPerSlab * mBlockSize));
+    if (!slab)
+        return false;
+
+    mSlabs.push_back(slab);
+
+    if (mPoisoning)
+        memset(slab, POISON, mBlocksPerSlab * mBlockSize);
+
+    for (size_t i = mBlocksPerSlab; i > 0; --i)
+    {
+        FreeBlock *block = reinterpret_cast<FreeBlock *>(
+                slab + (i - 1) * mBlockSize);
+        block->next = mFreeBlocks;
+        mFreeBlocks = block;
+    }
+    return true;
+}
+
+void ObjectPool::checkPoison(FreeBlock *block) const
+{
+    const unsigned char *bytes = reinterpret_cast<unsigned char *>(block);
+    for (size_t i = sizeof(FreeBlock); i < mBlockSize; ++i)
+    {
+        if (bytes[i] != POISON)
+        {
+            LOG_ERROR("Object pool " << mName << ": block " << block
+                      << " was written to at offset " << i
+                      << " after being freed!");
+            return;
+        }
+    }
+}
+
+void ObjectPool::setPoisoning(bool enabled)
+{
+    mPoisoning = enabled;
+}
+
+void ObjectPool::logStatistics()
+{
+    const Pools &all = pools();
+    for (Pools::const_iterator i = all.begin(), i_end = all.end();
+         i != i_end; ++i)
+    {
+        const ObjectPool *pool = i->second;
+        if (!pool->getCapacity())
+            continue;
+
+        LOG_INFO("Object pool " << pool->getName() << ": "
+                 << pool->getUsed() << " of " << pool->getCapacity()
+                 << " blocks of " << pool->getBlockSize() << " bytes used ("
+                 << pool->getUsed() * 100 / pool->getCapacity() << "%), "
+                 << pool->getPeak() << " peak, " << pool->mSlabs.size()
+                 << " slabs");
+    }
+}
+
+} // namespace utils
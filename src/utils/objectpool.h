@@ -0,0 +1,207 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTILS_OBJECTPOOL_H
+#define UTILS_OBJECTPOOL_H
+
+#include <cstddef>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace utils
+{
+
+/**
+ * A pool of fixed size blocks, for objects that are created and destroyed
+ * all the time, like monsters and floor items, and for the nodes of their
+ * containers. The blocks are carved out of slabs holding many of them, so
+ * that objects of a type stay close together and their churn does not
+ * fragment the heap.
+ *
+ * Pools are created on first use and live until the process exits, their
+ * slabs are never released. They are not thread safe: they are meant for the
+ * game world, which is only touched by the main thread.
+ */
+class ObjectPool
+{
+    public:
+        /**
+         * Returns the pool with the given name, creating it for blocks of
+         * the given size on the first call.
+         */
+        static ObjectPool *get(const std::string &name, size_t blockSize);
+
+        /**
+         * Returns the pool shared by all the users of blocks of the given
+         * size, see PoolAllocator.
+         */
+        static ObjectPool *getForSize(size_t blockSize);
+
+        /**
+         * Returns a block of at least the given size. Sizes larger than the
+         * block size of the pool, as requested by subclasses of a pooled
+         * class, are passed on to the global operator new.
+         *
+         * @throws std::bad_alloc when out of memory
+         */
+        void *allocate(size_t size);
+
+        /**
+         * Returns a block obtained from allocate() with the same size.
+         */
+        void deallocate(void *ptr, size_t size);
+
+        const std::string &getName() const
+        { return mName; }
+
+        size_t getBlockSize() const
+        { return mBlockSize; }
+
+        /** Blocks currently in use. */
+        size_t getUsed() const
+        { return mUsed; }
+
+        /** Highest number of blocks in use at once. */
+        size_t getPeak() const
+        { return mPeak; }
+
+        /** Blocks in the slabs, whether in use or not. */
+        size_t getCapacity() const
+        { return mSlabs.size() * mBlocksPerSlab; }
+
+        /**
+         * Makes the pools fill freed blocks with a pattern, and check that
+         * the pattern is intact when handing the block out again. A damaged
+         * pattern means that an object was written to after being deleted.
+         * Needs to be set before the first allocation.
+         */
+        static void setPoisoning(bool enabled);
+
+        /**
+         * Logs the occupancy of every pool.
+         */
+        static void logStatistics();
+
+    private:
+        enum {
+            ALIGNMENT = 16,
+            SLAB_SIZE = 16 * 1024,
+            POISON = 0xdd
+        };
+
+        struct FreeBlock
+        {
+            FreeBlock *next;
+        };
+
+        ObjectPool(const std::string &name, size_t blockSize);
+
+        ObjectPool(const ObjectPool &);
+        ObjectPool &operator=(const ObjectPool &);
+
+        bool addSlab();
+
+        void checkPoison(FreeBlock *block) const;
+
+        std::string mName;
+        size_t mBlockSize;
+        size_t mBlocksPerSlab;
+        FreeBlock *mFreeBlocks;
+        std::vector<char *> mSlabs;
+
+        size_t mUsed;
+        size_t mPeak;
+
+        static bool mPoisoning;
+};
+
+/**
+ * An STL allocator taking single elements from the pool shared by the
+ * blocks of their size, for the node based containers (map, set, list) of
+ * pooled objects. Arrays are left to the global operator new.
+ */
+template<typename T> class PoolAllocator
+{
+    public:
+        typedef T value_type;
+        typedef T *pointer;
+        typedef const T *const_pointer;
+        typedef T &reference;
+        typedef const T &const_reference;
+        typedef size_t size_type;
+        typedef ptrdiff_t difference_type;
+
+        template<typename U> struct rebind
+        { typedef PoolAllocator<U> other; };
+
+        PoolAllocator() {}
+        PoolAllocator(const PoolAllocator &) {}
+        template<typename U> PoolAllocator(const PoolAllocator<U> &) {}
+
+        pointer address(reference value) const
+        { return &value; }
+
+        const_pointer address(const_reference value) const
+        { return &value; }
+
+        pointer allocate(size_type n, const void * = 0)
+        {
+            if (n == 1)
+                return static_cast<pointer>(pool()->allocate(sizeof(T)));
+            return static_cast<pointer>(::operator new(n * sizeof(T)));
+        }
+
+        void deallocate(pointer ptr, size_type n)
+        {
+            if (n == 1)
+                pool()->deallocate(ptr, sizeof(T));
+            else
+                ::operator delete(ptr);
+        }
+
+        size_type max_size() const
+        { return size_t(-1) / sizeof(T); }
+
+        void construct(pointer ptr, const T &value)
+        { new (ptr) T(value); }
+
+        void destroy(pointer ptr)
+        { ptr->~T(); }
+
+    private:
+        static ObjectPool *pool()
+        {
+            static ObjectPool *pool = ObjectPool::getForSize(sizeof(T));
+            return pool;
+        }
+};
+
+template<typename T, typename U>
+inline bool operator==(const PoolAllocator<T> &, const PoolAllocator<U> &)
+{ return true; }
+
+template<typename T, typename U>
+inline bool operator!=(const PoolAllocator<T> &, const PoolAllocator<U> &)
+{ return false; }
+
+} // namespace utils
+
+#endif // UTILS_OBJECTPOOL_H
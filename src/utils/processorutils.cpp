@@ -21,10 +21,18 @@
 #include "utils/processorutils.h"
 
 bool utils::processor::isLittleEndian;
+bool utils::processor::hasSSE2;
+bool utils::processor::hasAVX2;
 
 void utils::processor::init()
 {
     utils::processor::isLittleEndian = utils::processor::littleEndianCheck();
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+    __builtin_cpu_init();
+    utils::processor::hasSSE2 = __builtin_cpu_supports("sse2");
+    utils::processor::hasAVX2 = __builtin_cpu_supports("avx2");
+#endif
 }
 
 bool utils::processor::littleEndianCheck()
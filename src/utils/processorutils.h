@@ -39,6 +39,16 @@ namespace utils
          */
         extern bool isLittleEndian;
 
+        /**
+         * True if the processor supports the SSE2 instructions.
+         */
+        extern bool hasSSE2;
+
+        /**
+         * True if the processor supports the AVX2 instructions.
+         */
+        extern bool hasAVX2;
+
         /**
          * Returns true if the processor is little-endian.
          */
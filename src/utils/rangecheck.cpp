@@ -0,0 +1,348 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/rangecheck.h"
+
+#include "utils/point.h"
+#include "utils/processorutils.h"
+
+#include <cstdlib>
+
+#include <stdint.h>
+
+/* The SSE2 and AVX2 versions are compiled for their instruction set whatever
+   the flags of the build, and only used when the processor supports them. */
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define RANGECHECK_X86
+#include <immintrin.h>
+#endif
+
+namespace utils {
+namespace range {
+
+/*
+ * The candidates may be anywhere on the map, so the squared distances would
+ * overflow an int. Candidates further than the touch distance along either
+ * axis are rejected first, after which the squares fit in an int as long as
+ * the touch distance does not exceed this. The kernels leave the candidates
+ * with larger touch distances to the scalar test.
+ */
+static const int MAX_VECTOR_TOUCH_DISTANCE = 32767;
+
+/**
+ * Tests one candidate for Collision::circleWithCircle(), without overflow.
+ */
+static inline bool circleWithCircle(const Point &center, int radius,
+                                    int x, int y, int candidateRadius)
+{
+    const int touchDistance = candidateRadius + radius;
+    const int distX = x - center.x;
+    const int distY = y - center.y;
+    if (std::abs(distX) > touchDistance || std::abs(distY) > touchDistance)
+        return false;
+
+    return (int64_t) distX * distX + (int64_t) distY * distY <
+           (int64_t) touchDistance * touchDistance;
+}
+
+#ifdef RANGECHECK_X86
+
+/**
+ * Corrects the candidates of a kernel mask whose touch distance was too
+ * large to be tested with vectors.
+ */
+static inline unsigned testLarge(unsigned mask, unsigned large,
+                                 const Point &center, int radius,
+                                 const int *x, const int *y,
+                                 const int *radii)
+{
+    while (large)
+    {
+        const unsigned i = __builtin_ctz(large);
+        large &= large - 1;
+        if (circleWithCircle(center, radius, x[i], y[i], radii[i]))
+            mask |= 1u << i;
+    }
+    return mask;
+}
+
+/**
+ * Absolute value of four integers, as SSE2 has no instruction for it.
+ */
+__attribute__((target("sse2")))
+static inline __m128i abs4(__m128i v)
+{
+    const __m128i sign = _mm_srai_epi32(v, 31);
+    return _mm_sub_epi32(_mm_xor_si128(v, sign), sign);
+}
+
+/**
+ * Low 32 bits of the products of four integers, as SSE2 only multiplies
+ * two at once.
+ */
+__attribute__((target("sse2")))
+static inline __m128i mul4(__m128i a, __m128i b)
+{
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4),
+                                      _mm_srli_si128(b, 4));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+/**
+ * Appends the indices of the candidates whose bit is set in the mask, the
+ * first bit standing for the given index.
+ */
+static inline unsigned addMatches(unsigned *matches, unsigned found,
+                                  unsigned first, unsigned mask)
+{
+    while (mask)
+    {
+        matches[found++] = first + __builtin_ctz(mask);
+        mask &= mask - 1;
+    }
+    return found;
+}
+
+/**
+ * Tests four candidates for Point::inRangeOf().
+ */
+__attribute__((target("sse2")))
+static inline __m128i inRangeOf4(const int *x, const int *y,
+                                 __m128i cx, __m128i cy, __m128i r)
+{
+    const __m128i dx = abs4(_mm_sub_epi32(
+            _mm_loadu_si128((const __m128i *) x), cx));
+    const __m128i dy = abs4(_mm_sub_epi32(
+            _mm_loadu_si128((const __m128i *) y), cy));
+    const __m128i outside = _mm_or_si128(_mm_cmpgt_epi32(dx, r),
+                                         _mm_cmpgt_epi32(dy, r));
+    return _mm_cmpeq_epi32(outside, _mm_setzero_si128());
+}
+
+/**
+ * Tests four candidates for Collision::circleWithCircle(). The candidates
+ * with a touch distance above MAX_VECTOR_TOUCH_DISTANCE are not matched but
+ * flagged in the last parameter.
+ */
+__attribute__((target("sse2")))
+static inline __m128i circleWithCircle4(const int *x, const int *y,
+                                        const int *radii,
+                                        __m128i cx, __m128i cy, __m128i r,
+                                        __m128i &large)
+{
+    const __m128i dx = _mm_sub_epi32(_mm_loadu_si128((const __m128i *) x), cx);
+    const __m128i dy = _mm_sub_epi32(_mm_loadu_si128((const __m128i *) y), cy);
+    const __m128i touch = _mm_add_epi32(
+            _mm_loadu_si128((const __m128i *) radii), r);
+    large = _mm_cmpgt_epi32(touch, _mm_set1_epi32(MAX_VECTOR_TOUCH_DISTANCE));
+    const __m128i outside = _mm_or_si128(
+            _mm_or_si128(_mm_cmpgt_epi32(abs4(dx), touch),
+                         _mm_cmpgt_epi32(abs4(dy), touch)), large);
+    const __m128i distSquared = _mm_add_epi32(mul4(dx, dx), mul4(dy, dy));
+    return _mm_andnot_si128(outside,
+                            _mm_cmplt_epi32(distSquared, mul4(touch, touch)));
+}
+
+/**
+ * The kernels below test the candidates eight at a time. They return the
+ * number of matches, and how many candidates they tested through the last
+ * parameter. The caller tests the remaining ones.
+ */
+__attribute__((target("sse2")))
+static unsigned inRangeOfSSE2(const Point &center, int radius,
+                              const int *x, const int *y, unsigned count,
+                              unsigned *matches, unsigned &tested)
+{
+    const __m128i cx = _mm_set1_epi32(center.x);
+    const __m128i cy = _mm_set1_epi32(center.y);
+    const __m128i r = _mm_set1_epi32(radius);
+
+    unsigned i = 0, found = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m128i low = inRangeOf4(x + i, y + i, cx, cy, r);
+        const __m128i high = inRangeOf4(x + i + 4, y + i + 4, cx, cy, r);
+        const unsigned mask = _mm_movemask_ps(_mm_castsi128_ps(low)) |
+                              _mm_movemask_ps(_mm_castsi128_ps(high)) << 4;
+        found = addMatches(matches, found, i, mask);
+    }
+    tested = i;
+    return found;
+}
+
+__attribute__((target("avx2")))
+static unsigned inRangeOfAVX2(const Point &center, int radius,
+                              const int *x, const int *y, unsigned count,
+                              unsigned *matches, unsigned &tested)
+{
+    const __m256i cx = _mm256_set1_epi32(center.x);
+    const __m256i cy = _mm256_set1_epi32(center.y);
+    const __m256i r = _mm256_set1_epi32(radius);
+
+    unsigned i = 0, found = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256i dx = _mm256_abs_epi32(_mm256_sub_epi32(
+                _mm256_loadu_si256((const __m256i *) (x + i)), cx));
+        const __m256i dy = _mm256_abs_epi32(_mm256_sub_epi32(
+                _mm256_loadu_si256((const __m256i *) (y + i)), cy));
+        const __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(dx, r),
+                                                _mm256_cmpgt_epi32(dy, r));
+        const unsigned mask =
+                ~_mm256_movemask_ps(_mm256_castsi256_ps(outside)) & 0xff;
+        found = addMatches(matches, found, i, mask);
+    }
+    tested = i;
+    return found;
+}
+
+__attribute__((target("sse2")))
+static unsigned circlesWithCircleSSE2(const Point &center, int radius,
+                                      const int *x, const int *y,
+                                      const int *radii, unsigned count,
+                                      unsigned *matches, unsigned &tested)
+{
+    const __m128i cx = _mm_set1_epi32(center.x);
+    const __m128i cy = _mm_set1_epi32(center.y);
+    const __m128i r = _mm_set1_epi32(radius);
+
+    unsigned i = 0, found = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i largeLow, largeHigh;
+        const __m128i low = circleWithCircle4(x + i, y + i, radii + i,
+                                              cx, cy, r, largeLow);
+        const __m128i high = circleWithCircle4(x + i + 4, y + i + 4,
+                                               radii + i + 4, cx, cy, r,
+                                               largeHigh);
+        unsigned mask = _mm_movemask_ps(_mm_castsi128_ps(low)) |
+                        _mm_movemask_ps(_mm_castsi128_ps(high)) << 4;
+        const unsigned large =
+                _mm_movemask_ps(_mm_castsi128_ps(largeLow)) |
+                _mm_movemask_ps(_mm_castsi128_ps(largeHigh)) << 4;
+        if (large)
+        {
+            mask = testLarge(mask, large, center, radius,
+                             x + i, y + i, radii + i);
+        }
+        found = addMatches(matches, found, i, mask);
+    }
+    tested = i;
+    return found;
+}
+
+__attribute__((target("avx2")))
+static unsigned circlesWithCircleAVX2(const Point &center, int radius,
+                                      const int *x, const int *y,
+                                      const int *radii, unsigned count,
+                                      unsigned *matches, unsigned &tested)
+{
+    const __m256i cx = _mm256_set1_epi32(center.x);
+    const __m256i cy = _mm256_set1_epi32(center.y);
+    const __m256i r = _mm256_set1_epi32(radius);
+    const __m256i maxTouch = _mm256_set1_epi32(MAX_VECTOR_TOUCH_DISTANCE);
+
+    unsigned i = 0, found = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256i dx = _mm256_sub_epi32(
+                _mm256_loadu_si256((const __m256i *) (x + i)), cx);
+        const __m256i dy = _mm256_sub_epi32(
+                _mm256_loadu_si256((const __m256i *) (y + i)), cy);
+        const __m256i touch = _mm256_add_epi32(
+                _mm256_loadu_si256((const __m256i *) (radii + i)), r);
+        const __m256i large = _mm256_cmpgt_epi32(touch, maxTouch);
+        const __m256i outside = _mm256_or_si256(
+                _mm256_or_si256(
+                        _mm256_cmpgt_epi32(_mm256_abs_epi32(dx), touch),
+                        _mm256_cmpgt_epi32(_mm256_abs_epi32(dy), touch)),
+                large);
+        const __m256i distSquared = _mm256_add_epi32(
+                _mm256_mullo_epi32(dx, dx), _mm256_mullo_epi32(dy, dy));
+        const __m256i hit = _mm256_andnot_si256(outside, _mm256_cmpgt_epi32(
+                _mm256_mullo_epi32(touch, touch), distSquared));
+        unsigned mask = _mm256_movemask_ps(_mm256_castsi256_ps(hit));
+        if (const unsigned largeMask =
+                _mm256_movemask_ps(_mm256_castsi256_ps(large)))
+        {
+            mask = testLarge(mask, largeMask, center, radius,
+                             x + i, y + i, radii + i);
+        }
+        found = addMatches(matches, found, i, mask);
+    }
+    tested = i;
+    return found;
+}
+
+#endif // RANGECHECK_X86
+
+unsigned inRangeOf(const Point &center, int radius,
+                   const int *x, const int *y, unsigned count,
+                   unsigned *matches)
+{
+    unsigned i = 0, found = 0;
+
+#ifdef RANGECHECK_X86
+    if (processor::hasAVX2)
+        found = inRangeOfAVX2(center, radius, x, y, count, matches, i);
+    else if (processor::hasSSE2)
+        found = inRangeOfSSE2(center, radius, x, y, count, matches, i);
+#endif
+
+    for (; i < count; ++i)
+    {
+        matches[found] = i;
+        found += std::abs(x[i] - center.x) <= radius &&
+                 std::abs(y[i] - center.y) <= radius;
+    }
+    return found;
+}
+
+unsigned circlesWithCircle(const Point &center, int radius,
+                           const int *x, const int *y, const int *radii,
+                           unsigned count, unsigned *matches)
+{
+    unsigned i = 0, found = 0;
+
+#ifdef RANGECHECK_X86
+    if (processor::hasAVX2)
+    {
+        found = circlesWithCircleAVX2(center, radius, x, y, radii, count,
+                                      matches, i);
+    }
+    else if (processor::hasSSE2)
+    {
+        found = circlesWithCircleSSE2(center, radius, x, y, radii, count,
+                                      matches, i);
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        matches[found] = i;
+        found += circleWithCircle(center, radius, x[i], y[i], radii[i]);
+    }
+    return found;
+}
+
+} // namespace range
+} // namespace utils
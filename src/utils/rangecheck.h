@@ -0,0 +1,63 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTILS_RANGECHECK_H
+#define UTILS_RANGECHECK_H
+
+class Point;
+
+namespace utils {
+
+/**
+ * Range tests of one center against many candidates, given as one array per
+ * coordinate. Callers pack the positions of the beings of the zones they
+ * visit into such arrays, which they own. The candidates are tested several
+ * at once with SSE2 or AVX2 when the processor supports them, see
+ * utils::processor::init(), and one by one otherwise.
+ */
+namespace range {
+
+/**
+ * Finds the candidates in range of the center, like Point::inRangeOf().
+ *
+ * @param matches receives the indices of the candidates in range, in
+ *                increasing order. It needs room for all the candidates.
+ * @return the number of candidates in range.
+ */
+unsigned inRangeOf(const Point &center, int radius,
+                   const int *x, const int *y, unsigned count,
+                   unsigned *matches);
+
+/**
+ * Finds the candidates whose circle intersects the given one, like
+ * Collision::circleWithCircle().
+ *
+ * @param matches receives the indices of the touching candidates, in
+ *                increasing order. It needs room for all the candidates.
+ * @return the number of touching candidates.
+ */
+unsigned circlesWithCircle(const Point &center, int radius,
+                           const int *x, const int *y, const int *radii,
+                           unsigned count, unsigned *matches);
+
+} // namespace range
+} // namespace utils
+
+#endif // UTILS_RANGECHECK_H
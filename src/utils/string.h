@@ -89,7 +89,11 @@ namespace utils
      */
     template<typename T> class NameMap
     {
+        typedef std::map<std::string, T> Map;
+
     public:
+        typedef typename Map::const_iterator const_iterator;
+
         NameMap()
             : mDefault()
         {}
@@ -115,14 +119,29 @@ namespace utils
             return mMap.find(toLower(name)) != mMap.end();
         }
 
+        void remove(const std::string &name)
+        {
+            mMap.erase(toLower(name));
+        }
+
         void clear()
         {
             mMap.clear();
         }
 
-    private:
-        typedef std::map<std::string, T> Map;
+        /**
+         * Iterates over the entries, with their names in lower case.
+         */
+        const_iterator begin() const
+        { return mMap.begin(); }
+
+        const_iterator end() const
+        { return mMap.end(); }
 
+        size_t size() const
+        { return mMap.size(); }
+
+    private:
         Map mMap;
         const T mDefault;
     };
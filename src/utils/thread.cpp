@@ -0,0 +1,127 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/thread.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace utils
+{
+
+#ifdef _WIN32
+
+Mutex::Mutex()
+{ InitializeCriticalSection(&mMutex); }
+
+Mutex::~Mutex()
+{ DeleteCriticalSection(&mMutex); }
+
+void Mutex::lock()
+{ EnterCriticalSection(&mMutex); }
+
+void Mutex::unlock()
+{ LeaveCriticalSection(&mMutex); }
+
+#else
+
+Mutex::Mutex()
+{ pthread_mutex_init(&mMutex, 0); }
+
+Mutex::~Mutex()
+{ pthread_mutex_destroy(&mMutex); }
+
+void Mutex::lock()
+{ pthread_mutex_lock(&mMutex); }
+
+void Mutex::unlock()
+{ pthread_mutex_unlock(&mMutex); }
+
+#endif
+
+
+Thread::Thread():
+    mRunning(false),
+    mFunction(0),
+    mData(0)
+{
+}
+
+Thread::~Thread()
+{
+    join();
+}
+
+bool Thread::start(Function function, void *data)
+{
+    if (mRunning)
+        return false;
+
+    mFunction = function;
+    mData = data;
+
+#ifdef _WIN32
+    mThread = CreateThread(0, 0, run, this, 0, 0);
+    mRunning = mThread != 0;
+#else
+    mRunning = pthread_create(&mThread, 0, run, this) == 0;
+#endif
+    return mRunning;
+}
+
+void Thread::join()
+{
+    if (!mRunning)
+        return;
+
+#ifdef _WIN32
+    WaitForSingleObject(mThread, INFINITE);
+    CloseHandle(mThread);
+#else
+    pthread_join(mThread, 0);
+#endif
+    mRunning = false;
+}
+
+#ifdef _WIN32
+DWORD WINAPI Thread::run(LPVOID thread)
+#else
+void *Thread::run(void *thread)
+#endif
+{
+    Thread *self = static_cast<Thread *>(thread);
+    self->mFunction(self->mData);
+    return 0;
+}
+
+int Thread::getProcessorCount()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const int count = info.dwNumberOfProcessors;
+#else
+    const int count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return count > 0 ? count : 1;
+}
+
+} // namespace utils
@@ -0,0 +1,128 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTILS_THREAD_H
+#define UTILS_THREAD_H
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+namespace utils
+{
+
+/**
+ * A mutual exclusion lock, to protect data shared between threads.
+ */
+class Mutex
+{
+    public:
+        Mutex();
+        ~Mutex();
+
+        void lock();
+        void unlock();
+
+    private:
+        Mutex(const Mutex &);
+        Mutex &operator=(const Mutex &);
+
+#ifdef _WIN32
+        CRITICAL_SECTION mMutex;
+#else
+        pthread_mutex_t mMutex;
+#endif
+};
+
+/**
+ * Holds a mutex locked for as long as it exists.
+ */
+class MutexLocker
+{
+    public:
+        MutexLocker(Mutex *mutex): mMutex(mutex)
+        { mMutex->lock(); }
+
+        ~MutexLocker()
+        { mMutex->unlock(); }
+
+    private:
+        MutexLocker(const MutexLocker &);
+        MutexLocker &operator=(const MutexLocker &);
+
+        Mutex *mMutex;
+};
+
+/**
+ * A thread of execution, running a function until it returns.
+ */
+class Thread
+{
+    public:
+        typedef void (*Function)(void *data);
+
+        Thread();
+
+        /**
+         * Joins the thread when it is still running.
+         */
+        ~Thread();
+
+        /**
+         * Starts running the function with the given data in a new thread.
+         *
+         * @return whether the thread could be created.
+         */
+        bool start(Function function, void *data);
+
+        /**
+         * Waits for the thread to finish.
+         */
+        void join();
+
+        /**
+         * Returns the number of processors available for running threads,
+         * at least 1.
+         */
+        static int getProcessorCount();
+
+    private:
+        Thread(const Thread &);
+        Thread &operator=(const Thread &);
+
+#ifdef _WIN32
+        static DWORD WINAPI run(LPVOID thread);
+
+        HANDLE mThread;
+#else
+        static void *run(void *thread);
+
+        pthread_t mThread;
+#endif
+        bool mRunning;
+        Function mFunction;
+        void *mData;
+};
+
+} // namespace utils
+
+#endif // UTILS_THREAD_H
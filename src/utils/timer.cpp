@@ -65,6 +65,14 @@ void Timer::sleep()
 #endif
 }
 
+int Timer::getTimeLeft() const
+{
+    if (!active) return 0;
+    uint64_t now = getTimeInMillisec();
+    if (now - lastpulse >= interval) return 0;
+    return interval - (now - lastpulse);
+}
+
 int Timer::poll()
 {
     int elapsed = 0;
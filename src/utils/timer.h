@@ -54,6 +54,11 @@ class Timer
          */
         void sleep();
 
+        /**
+         * Returns the number of milliseconds left until the next tick.
+         */
+        int getTimeLeft() const;
+
         /**
          * Activates the timer.
          */
@@ -66,6 +66,162 @@ namespace XML
         return mDoc ? xmlDocGetRootElement(mDoc) : 0;
     }
 
+    Reader::Reader(const std::string &fileName, bool useResman):
+        mReader(0),
+        mRootName(0),
+        mExpanded(false),
+        mFileName(fileName)
+    {
+        if (useResman)
+        {
+            mFileName = ResourceManager::resolve(fileName);
+
+            if (mFileName.empty())
+            {
+                LOG_ERROR("(XML::Reader) File not found in search path: "
+                          << fileName);
+                return;
+            }
+        }
+
+        mReader = xmlReaderForFile(mFileName.c_str(), 0,
+                                   XML_PARSE_NOBLANKS | XML_PARSE_COMPACT);
+        if (!mReader)
+        {
+            LOG_ERROR("(XML::Reader) Error opening XML file: " << mFileName);
+            return;
+        }
+
+        // Move to the root element
+        int ret;
+        while ((ret = xmlTextReaderRead(mReader)) == 1)
+        {
+            if (xmlTextReaderNodeType(mReader) == XML_READER_TYPE_ELEMENT)
+            {
+                mRootName = xmlTextReaderName(mReader);
+                break;
+            }
+        }
+
+        if (!mRootName)
+        {
+            LOG_ERROR("(XML::Reader) Error parsing XML file: " << mFileName);
+            xmlFreeTextReader(mReader);
+            mReader = 0;
+            return;
+        }
+
+        // Move to the first child of the root element, if any
+        if (xmlTextReaderIsEmptyElement(mReader) == 1 ||
+            (ret = xmlTextReaderRead(mReader)) != 1)
+        {
+            if (ret == -1)
+            {
+                LOG_ERROR("(XML::Reader) Error parsing XML file: "
+                          << mFileName);
+            }
+            xmlFreeTextReader(mReader);
+            mReader = 0;
+        }
+    }
+
+    Reader::~Reader()
+    {
+        if (mReader)
+            xmlFreeTextReader(mReader);
+        if (mRootName)
+            xmlFree(mRootName);
+    }
+
+    const xmlChar *Reader::rootName() const
+    {
+        return mRootName;
+    }
+
+    xmlNodePtr Reader::nextChild()
+    {
+        if (!mReader)
+            return 0;
+
+        int ret = 1;
+
+        // Skip past the element returned last time, which frees it
+        if (mExpanded)
+        {
+            ret = xmlTextReaderNext(mReader);
+            mExpanded = false;
+        }
+
+        while (ret == 1 && xmlTextReaderDepth(mReader) > 0)
+        {
+            if (xmlTextReaderDepth(mReader) == 1 &&
+                xmlTextReaderNodeType(mReader) == XML_READER_TYPE_ELEMENT)
+            {
+                xmlNodePtr node = xmlTextReaderExpand(mReader);
+                if (!node)
+                {
+                    ret = -1;
+                    break;
+                }
+                mExpanded = true;
+                return node;
+            }
+
+            ret = xmlTextReaderNext(mReader);
+        }
+
+        if (ret == -1)
+            LOG_ERROR("(XML::Reader) Error parsing XML file: " << mFileName);
+
+        xmlFreeTextReader(mReader);
+        mReader = 0;
+        return 0;
+    }
+
+    static void hashBytes(uint64_t &hash, const xmlChar *bytes)
+    {
+        // FNV-1a
+        if (bytes)
+        {
+            for (; *bytes; ++bytes)
+            {
+                hash ^= *bytes;
+                hash *= 1099511628211ULL;
+            }
+        }
+        // Separator, so that "ab" + "c" differs from "a" + "bc"
+        hash ^= 0xff;
+        hash *= 1099511628211ULL;
+    }
+
+    static void hashNode(uint64_t &hash, xmlNodePtr node)
+    {
+        hashBytes(hash, node->name);
+        if (node->type != XML_ELEMENT_NODE)
+        {
+            hashBytes(hash, node->content);
+            return;
+        }
+
+        for (xmlAttrPtr attr = node->properties; attr; attr = attr->next)
+        {
+            hashBytes(hash, attr->name);
+            if (attr->children)
+                hashBytes(hash, attr->children->content);
+        }
+
+        for_each_xml_child_node(child, node)
+            hashNode(hash, child);
+        hashBytes(hash, 0);
+    }
+
+    uint64_t getFingerprint(xmlNodePtr node)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        hashNode(hash, node);
+        return hash;
+    }
+
     bool hasProperty(xmlNodePtr node, const char *name)
     {
         xmlChar *prop = xmlGetProp(node, BAD_CAST name);
@@ -24,9 +24,16 @@
 #define XML_H
 
 #include <libxml/tree.h>
+#include <libxml/xmlreader.h>
 
 #include <string>
 
+#ifdef _MSC_VER
+   typedef unsigned __int64 uint64_t;
+#else
+   #include <stdint.h>
+#endif
+
 /**
  * XML helper functions.
  */
@@ -64,6 +71,61 @@ namespace XML
             xmlDocPtr mDoc;
     };
 
+    /**
+     * A helper class for reading a large XML document one top-level element
+     * at a time, without building a tree of the whole document. Suited for
+     * the definition databases, which are long lists of independent
+     * elements below the root.
+     */
+    class Reader
+    {
+        public:
+            /**
+             * Opens the given file for reading. Logs an error when the file
+             * cannot be found or when its root element cannot be read.
+             *
+             * @param fileName  the file name of the XML document
+             * @param useResman whether to resolve the full path to the file
+             *                  using the resource manager (true by default).
+             */
+            Reader(const std::string &fileName, bool useResman = true);
+
+            /**
+             * Destructor. Closes the file and frees the last read element.
+             */
+            ~Reader();
+
+            /**
+             * Returns the name of the root element (or NULL if there was a
+             * load error).
+             */
+            const xmlChar *rootName() const;
+
+            /**
+             * Returns the next element below the root, with all its
+             * children. The element stays valid until the next call.
+             * Returns NULL at the end of the document or on a parse error,
+             * which is logged.
+             */
+            xmlNodePtr nextChild();
+
+        private:
+            Reader(const Reader &);
+            Reader &operator=(const Reader &);
+
+            xmlTextReaderPtr mReader;
+            xmlChar *mRootName;
+            bool mExpanded;
+            std::string mFileName;
+    };
+
+    /**
+     * Computes a 64-bit hash of an element, its attributes and everything
+     * below it. Used to tell which definitions changed between two reads of
+     * a database.
+     */
+    uint64_t getFingerprint(xmlNodePtr node);
+
     /**
      * Tells if a property from an xmlNodePtr exists.
      */